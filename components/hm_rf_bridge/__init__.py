@@ -1,24 +1,49 @@
 import logging
 
 import esphome.codegen as cg
-from esphome.components import binary_sensor, output, socket, text_sensor, uart
+from esphome import automation
+from esphome.components import binary_sensor, output, sensor, socket, text_sensor, uart
+from esphome.components import web_server_base
+from esphome.components.web_server_base import CONF_WEB_SERVER_BASE_ID
 import esphome.config_validation as cv
 from esphome.const import (
+    CONF_HOST,
     CONF_ID,
+    CONF_PORT,
+    CONF_RX_BUFFER_SIZE,
+    CONF_SIZE,
     CONF_UART_ID,
     DEVICE_CLASS_CONNECTIVITY,
+    DEVICE_CLASS_PROBLEM,
+    DEVICE_CLASS_RUNNING,
     ENTITY_CATEGORY_DIAGNOSTIC,
+    STATE_CLASS_MEASUREMENT,
+    STATE_CLASS_TOTAL_INCREASING,
+    UNIT_MILLISECOND,
+    UNIT_PERCENT,
 )
+from esphome.core import CORE
 import esphome.final_validate as fv
 
 _LOGGER = logging.getLogger(__name__)
 
-AUTO_LOAD = ["binary_sensor", "text_sensor", "socket"]
+AUTO_LOAD = ["binary_sensor", "sensor", "text_sensor", "socket"]
 DEPENDENCIES = ["uart", "network"]
+MULTI_CONF = True
+
+DOMAIN = "hm_rf_bridge"
+DEFAULT_PORT = 3008
 
 # Namespace for the component
 hm_rf_bridge_ns = cg.esphome_ns.namespace("hm_rf_bridge")
 HmRFBridge = hm_rf_bridge_ns.class_("HmRFBridge", cg.PollingComponent)
+ResetLatencyAction = hm_rf_bridge_ns.class_("ResetLatencyAction", automation.Action)
+FreezeFlightRecorderAction = hm_rf_bridge_ns.class_(
+    "FreezeFlightRecorderAction", automation.Action
+)
+RearmFlightRecorderAction = hm_rf_bridge_ns.class_(
+    "RearmFlightRecorderAction", automation.Action
+)
 
 # Configuration options
 # CONF_UART_ID = "uart_id"
@@ -31,19 +56,200 @@ CONF_RADIO_MODULE_TYPE = "radio_module_type"
 CONF_FIRMWARE_VERSION = "firmware_version"
 CONF_SERIAL = "serial"
 CONF_SGTIN = "SGTIN"
+CONF_RX_PATTERN_DETECT = "rx_pattern_detect"
+CONF_LATENCY_PROFILE = "latency_profile"
+CONF_RX_FULL_THRESHOLD = "rx_full_threshold"
+CONF_RX_TIMEOUT = "rx_timeout"
+CONF_OVERFLOW_RECOVERY = "overflow_recovery"
+CONF_LED_TRAFFIC_BLINK = "led_traffic_blink"
+CONF_RESET_HOLD_TIME = "reset_hold_time"
+CONF_RESET_SETTLE_TIME = "reset_settle_time"
+CONF_FRAME_LOG = "frame_log"
+CONF_TRACE_LOG = "trace_log"
+CONF_STATIC_ALLOCATION = "static_allocation"
+CONF_QUEUE_SIZE = "queue_size"
+CONF_DETECTION_CACHE = "detection_cache"
+CONF_FLIGHT_RECORDER = "flight_recorder"
+CONF_SNAP_LENGTH = "snap_length"
+CONF_FREEZE_ON = "freeze_on"
+CONF_CAPTURE_MIRROR = "capture_mirror"
+CONF_UART_TO_UDP_FRAME_RATE = "uart_to_udp_frame_rate"
+CONF_UART_TO_UDP_BYTE_RATE = "uart_to_udp_byte_rate"
+CONF_UDP_TO_UART_FRAME_RATE = "udp_to_uart_frame_rate"
+CONF_UDP_TO_UART_BYTE_RATE = "udp_to_uart_byte_rate"
+CONF_KEEPALIVES_SENT = "keepalives_sent"
+CONF_KEEPALIVES_RECEIVED = "keepalives_received"
+CONF_DROPPED_OVERSIZED = "dropped_oversized"
+CONF_DROPPED_NOT_CONNECTED = "dropped_not_connected"
+CONF_DROPPED_CRC = "dropped_crc"
+CONF_DUTY_CYCLE = "duty_cycle"
+CONF_WARNING_THRESHOLD = "warning_threshold"
+CONF_USAGE = "usage"
+CONF_HMIP_USAGE = "hmip_usage"
+CONF_BIDCOS_USAGE = "bidcos_usage"
+CONF_WARNING = "warning"
+CONF_TX_SCHEDULER = "tx_scheduler"
+CONF_AGING_TIME = "aging_time"
+CONF_BULK_THRESHOLD = "bulk_threshold"
+CONF_BULK_TRANSFER = "bulk_transfer"
+CONF_BATCH_SIZE = "batch_size"
+CONF_IDLE_TIMEOUT = "idle_timeout"
+CONF_ACTIVE = "active"
+CONF_DROPPED_PIPELINE_FULL = "dropped_pipeline_full"
+CONF_PIPELINE = "pipeline"
+CONF_RING_SIZE = "ring_size"
+CONF_UART_CORE = "uart_core"
+CONF_NETWORK_CORE = "network_core"
+CONF_HIGH_WATER_MARK = "high_water_mark"
+CONF_SINGLE_TASK = "single_task"
+
+# Anomalies freezing the flight recorder, values match flight_recorder_trigger_t
+FLIGHT_RECORDER_TRIGGERS = {
+    "crc_error": 1,
+    "overflow": 2,
+    "connection_timeout": 3,
+    "parser_resync": 4,
+}
+
+# The ring is allocated at startup, keep it to a part of the heap of the smaller chips
+FLIGHT_RECORDER_SLOT_HEADER = 24  # sizeof(flight_recorder_slot_t)
+FLIGHT_RECORDER_MAX_MEMORY = 65536
+
+FLIGHT_RECORDER_ACTIONS = (
+    "hm_rf_bridge.freeze_flight_recorder",
+    "hm_rf_bridge.rearm_flight_recorder",
+)
+
+# Traffic statistics sensors, published on the update interval
+RATE_SENSORS = {
+    CONF_UART_TO_UDP_FRAME_RATE: "frames/s",
+    CONF_UART_TO_UDP_BYTE_RATE: "B/s",
+    CONF_UDP_TO_UART_FRAME_RATE: "frames/s",
+    CONF_UDP_TO_UART_BYTE_RATE: "B/s",
+}
+LATENCY_SENSORS = [
+    f"{direction}_latency_{statistic}"
+    for direction in ("uart_to_udp", "udp_to_uart")
+    for statistic in ("p50", "p99", "max")
+]
+COUNTER_SENSORS = [
+    CONF_KEEPALIVES_SENT,
+    CONF_KEEPALIVES_RECEIVED,
+    CONF_DROPPED_OVERSIZED,
+    CONF_DROPPED_NOT_CONNECTED,
+    CONF_DROPPED_CRC,
+    CONF_DROPPED_PIPELINE_FULL,
+]
+# Duty cycle estimate in percent of the budget of 1% per hour, option -> setter name
+DUTY_CYCLE_SENSORS = {
+    CONF_USAGE: "duty_cycle",
+    CONF_HMIP_USAGE: "hmip_duty_cycle",
+    CONF_BIDCOS_USAGE: "bidcos_duty_cycle",
+}
+# p99 of the time frames of a TX scheduler class waited for the UART
+TX_QUEUE_TIME_SENSORS = [
+    f"{tx_class}_queue_time" for tx_class in ("control", "interactive", "bulk")
+]
+
+# (RX FIFO full threshold in bytes, RX timeout in symbol times)
+LATENCY_PROFILES = {
+    "low_latency": (8, 1),
+    "balanced": (32, 3),
+    "low_cpu": (120, 10),
+}
 
 
 def _consume_sockets(config):
     """Register socket needs for this component."""
-    #  1 listening socket + 1 concurrent client connections
-    socket.consume_sockets(2, "HmRFBridge")(config)
+    #  1 listening socket + 1 concurrent client connections (+ 1 capture mirror) per instance
+    sockets = 3 if CONF_CAPTURE_MIRROR in config else 2
+    socket.consume_sockets(sockets, f"HmRFBridge {config[CONF_ID]}")(config)
+    return config
+
+
+def _validate_single_task(config):
+    if config[CONF_SINGLE_TASK] and CONF_PIPELINE in config:
+        raise cv.Invalid(
+            "The pipeline runs a task of its own, it cannot be used with single_task",
+            [CONF_PIPELINE],
+        )
+    return config
+
+
+def _validate_flight_recorder(config):
+    memory = config[CONF_SIZE] * (
+        config[CONF_SNAP_LENGTH] + FLIGHT_RECORDER_SLOT_HEADER
+    )
+    if memory > FLIGHT_RECORDER_MAX_MEMORY:
+        raise cv.Invalid(
+            f"size and snap_length need {memory} bytes of RAM, "
+            f"at most {FLIGHT_RECORDER_MAX_MEMORY} are allowed"
+        )
     return config
 
 
+def _flight_recorder_actions(value):
+    """Yield the flight recorder actions and the bridge they refer to."""
+    if isinstance(value, dict):
+        for key, item in value.items():
+            if key in FLIGHT_RECORDER_ACTIONS and isinstance(item, dict):
+                yield key, item[CONF_ID]
+            else:
+                yield from _flight_recorder_actions(item)
+    elif isinstance(value, list):
+        for item in value:
+            yield from _flight_recorder_actions(item)
+
+
+def _power_of_two(value):
+    value = cv.int_range(min=1024, max=32768)(value)
+    if value & (value - 1):
+        raise cv.Invalid("Has to be a power of two")
+    return value
+
+
+def _uart_rx_buffer_size(uart_id):
+    for uart_conf in CORE.config.get("uart", []):
+        if uart_conf[CONF_ID].id == uart_id.id:
+            return uart_conf[CONF_RX_BUFFER_SIZE]
+    return 256
+
+
 def _final_validate(config):
     full_config = fv.full_config.get()
     wifi_conf = full_config.get("wifi")
 
+    others = [
+        conf
+        for conf in full_config.get(DOMAIN, [])
+        if conf[CONF_ID] != config[CONF_ID]
+    ]
+    for other in others:
+        if other[CONF_PORT] == config[CONF_PORT]:
+            raise cv.Invalid(
+                f"UDP port {config[CONF_PORT]} is used by {other[CONF_ID]} already",
+                [CONF_PORT],
+            )
+        if other[CONF_UART_ID] == config[CONF_UART_ID]:
+            raise cv.Invalid(
+                f"UART {config[CONF_UART_ID]} is used by {other[CONF_ID]} already",
+                [CONF_UART_ID],
+            )
+        if other[CONF_STATIC_ALLOCATION] != config[CONF_STATIC_ALLOCATION]:
+            raise cv.Invalid(
+                "static_allocation is a build option and has to match on all instances",
+                [CONF_STATIC_ALLOCATION],
+            )
+
+    if CONF_FLIGHT_RECORDER not in config:
+        # the action classes only exist with the flight recorder compiled in
+        for action, bridge_id in _flight_recorder_actions(full_config):
+            if bridge_id.id == config[CONF_ID].id:
+                raise cv.Invalid(
+                    f"{action} requires flight_recorder to be configured "
+                    f"on {bridge_id}"
+                )
+
     if wifi_conf:
         _LOGGER.warning(
             "Because of latency requirements, it is not recommended to use this component with WiFi"
@@ -66,9 +272,17 @@ CONFIG_SCHEMA = cv.All(
             cv.GenerateID(): cv.declare_id(HmRFBridge),
             cv.Required(CONF_UART_ID): cv.use_id(uart.IDFUARTComponent),
             cv.Required(CONF_RESET_OUTPUT): cv.use_id(output.BinaryOutput),
+            cv.Optional(CONF_PORT, default=DEFAULT_PORT): cv.port,
+            cv.Optional(
+                CONF_RESET_HOLD_TIME, default="50ms"
+            ): cv.positive_time_period_milliseconds,
+            cv.Optional(
+                CONF_RESET_SETTLE_TIME, default="50ms"
+            ): cv.positive_time_period_milliseconds,
             cv.Optional(CONF_RED_LED): cv.use_id(output.BinaryOutput),
             cv.Optional(CONF_GREEN_LED): cv.use_id(output.BinaryOutput),
             cv.Optional(CONF_BLUE_LED): cv.use_id(output.BinaryOutput),
+            cv.Optional(CONF_LED_TRAFFIC_BLINK, default=False): cv.boolean,
             cv.Optional(CONF_CONNECTED): binary_sensor.binary_sensor_schema(
                 device_class=DEVICE_CLASS_CONNECTIVITY,
                 entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
@@ -85,10 +299,159 @@ CONFIG_SCHEMA = cv.All(
             cv.Optional(CONF_SGTIN): text_sensor.text_sensor_schema(
                 entity_category=ENTITY_CATEGORY_DIAGNOSTIC
             ),
+            **{
+                cv.Optional(key): sensor.sensor_schema(
+                    unit_of_measurement=unit,
+                    accuracy_decimals=1,
+                    state_class=STATE_CLASS_MEASUREMENT,
+                    entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+                )
+                for key, unit in RATE_SENSORS.items()
+            },
+            **{
+                cv.Optional(key): sensor.sensor_schema(
+                    accuracy_decimals=0,
+                    state_class=STATE_CLASS_TOTAL_INCREASING,
+                    entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+                )
+                for key in COUNTER_SENSORS
+            },
+            **{
+                cv.Optional(key): sensor.sensor_schema(
+                    unit_of_measurement=UNIT_MILLISECOND,
+                    accuracy_decimals=2,
+                    state_class=STATE_CLASS_MEASUREMENT,
+                    entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+                )
+                for key in LATENCY_SENSORS
+            },
+            cv.Optional(CONF_RX_PATTERN_DETECT, default=False): cv.boolean,
+            cv.Optional(CONF_LATENCY_PROFILE): cv.one_of(
+                *LATENCY_PROFILES, lower=True
+            ),
+            cv.Optional(CONF_RX_FULL_THRESHOLD): cv.int_range(min=1, max=120),
+            cv.Optional(CONF_RX_TIMEOUT): cv.int_range(min=0, max=126),
+            cv.Optional(CONF_OVERFLOW_RECOVERY, default=False): cv.boolean,
+            cv.Optional(CONF_DETECTION_CACHE, default=False): cv.boolean,
+            cv.Optional(CONF_STATIC_ALLOCATION, default=False): cv.boolean,
+            cv.Optional(CONF_SINGLE_TASK, default=False): cv.boolean,
+            cv.Optional(CONF_CAPTURE_MIRROR): cv.Schema(
+                {
+                    cv.Required(CONF_HOST): cv.ipv4address,
+                    cv.Optional(CONF_PORT, default=37008): cv.port,
+                    cv.Optional(CONF_QUEUE_SIZE, default=4096): cv.int_range(
+                        min=512, max=65536
+                    ),
+                }
+            ),
+            cv.Optional(CONF_FLIGHT_RECORDER): cv.All(
+                cv.Schema(
+                    {
+                        cv.GenerateID(CONF_WEB_SERVER_BASE_ID): cv.use_id(
+                            web_server_base.WebServerBase
+                        ),
+                        cv.Optional(CONF_SIZE, default=256): cv.int_range(
+                            min=16, max=4096
+                        ),
+                        cv.Optional(CONF_SNAP_LENGTH, default=64): cv.int_range(
+                            min=16, max=1024
+                        ),
+                        cv.Optional(
+                            CONF_FREEZE_ON, default=list(FLIGHT_RECORDER_TRIGGERS)
+                        ): cv.ensure_list(
+                            cv.one_of(*FLIGHT_RECORDER_TRIGGERS, lower=True)
+                        ),
+                    }
+                ),
+                _validate_flight_recorder,
+            ),
+            cv.Optional(CONF_DUTY_CYCLE): cv.Schema(
+                {
+                    cv.Optional(
+                        CONF_WARNING_THRESHOLD, default="80%"
+                    ): cv.percentage,
+                    **{
+                        cv.Optional(key): sensor.sensor_schema(
+                            unit_of_measurement=UNIT_PERCENT,
+                            accuracy_decimals=1,
+                            state_class=STATE_CLASS_MEASUREMENT,
+                            entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+                        )
+                        for key in DUTY_CYCLE_SENSORS
+                    },
+                    cv.Optional(CONF_WARNING): binary_sensor.binary_sensor_schema(
+                        device_class=DEVICE_CLASS_PROBLEM,
+                        entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+                    ),
+                }
+            ),
+            cv.Optional(CONF_TX_SCHEDULER): cv.Schema(
+                {
+                    cv.Optional(
+                        CONF_AGING_TIME, default="100ms"
+                    ): cv.positive_time_period_microseconds,
+                    cv.Optional(CONF_BULK_THRESHOLD, default=40): cv.int_range(
+                        min=1, max=1024
+                    ),
+                    **{
+                        cv.Optional(key): sensor.sensor_schema(
+                            unit_of_measurement=UNIT_MILLISECOND,
+                            accuracy_decimals=2,
+                            state_class=STATE_CLASS_MEASUREMENT,
+                            entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+                        )
+                        for key in TX_QUEUE_TIME_SENSORS
+                    },
+                }
+            ),
+            cv.Optional(CONF_BULK_TRANSFER): cv.Schema(
+                {
+                    cv.Optional(CONF_BATCH_SIZE, default=1024): cv.int_range(
+                        min=256, max=4096
+                    ),
+                    cv.Optional(
+                        CONF_IDLE_TIMEOUT, default="2s"
+                    ): cv.positive_time_period_microseconds,
+                    cv.Optional(CONF_ACTIVE): binary_sensor.binary_sensor_schema(
+                        device_class=DEVICE_CLASS_RUNNING,
+                        entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+                    ),
+                }
+            ),
+            cv.Optional(CONF_PIPELINE): cv.Schema(
+                {
+                    cv.Optional(CONF_RING_SIZE, default=4096): _power_of_two,
+                    cv.Optional(CONF_UART_CORE, default=1): cv.int_range(min=0, max=1),
+                    cv.Optional(CONF_NETWORK_CORE, default=0): cv.int_range(
+                        min=0, max=1
+                    ),
+                    cv.Optional(CONF_HIGH_WATER_MARK): sensor.sensor_schema(
+                        unit_of_measurement="B",
+                        accuracy_decimals=0,
+                        state_class=STATE_CLASS_MEASUREMENT,
+                        entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+                    ),
+                }
+            ),
+            cv.Optional(CONF_FRAME_LOG): cv.Schema(
+                {
+                    cv.Optional(CONF_QUEUE_SIZE, default=4096): cv.int_range(
+                        min=512, max=65536
+                    ),
+                }
+            ),
+            cv.Optional(CONF_TRACE_LOG): cv.Schema(
+                {
+                    cv.Optional(CONF_SIZE, default=256): cv.int_range(
+                        min=16, max=4096
+                    ),
+                }
+            ),
         }
     ).extend(
         cv.polling_component_schema("10s"),
     ),
+    _validate_single_task,
     _consume_sockets,
 )
 
@@ -101,6 +464,10 @@ async def to_code(config):
     reset_output = await cg.get_variable(config[CONF_RESET_OUTPUT])
     var = cg.new_Pvariable(config[CONF_ID], uart_component, reset_output)
 
+    cg.add(var.set_port(config[CONF_PORT]))
+    cg.add(var.set_reset_hold_time(config[CONF_RESET_HOLD_TIME]))
+    cg.add(var.set_reset_settle_time(config[CONF_RESET_SETTLE_TIME]))
+
     if CONF_RED_LED in config:
         red = await cg.get_variable(config[CONF_RED_LED])
         cg.add(var.set_red_led(red))
@@ -113,6 +480,8 @@ async def to_code(config):
         blue = await cg.get_variable(config[CONF_BLUE_LED])
         cg.add(var.set_blue_led(blue))
 
+    cg.add(var.set_led_traffic_blink(config[CONF_LED_TRAFFIC_BLINK]))
+
     if CONF_CONNECTED in config:
         connected_sensor = await binary_sensor.new_binary_sensor(config[CONF_CONNECTED])
         cg.add(var.set_connected_sensor(connected_sensor))
@@ -137,4 +506,152 @@ async def to_code(config):
         SGTIN_sensor = await text_sensor.new_text_sensor(config[CONF_SGTIN])
         cg.add(var.set_SGTIN_sensor(SGTIN_sensor))
 
+    for key in [*RATE_SENSORS, *COUNTER_SENSORS, *LATENCY_SENSORS]:
+        if key in config:
+            sens = await sensor.new_sensor(config[key])
+            cg.add(getattr(var, f"set_{key}_sensor")(sens))
+
+    cg.add(var.set_rx_pattern_detect(config[CONF_RX_PATTERN_DETECT]))
+
+    rx_full_threshold, rx_timeout = LATENCY_PROFILES.get(
+        config.get(CONF_LATENCY_PROFILE), (None, None)
+    )
+    rx_full_threshold = config.get(CONF_RX_FULL_THRESHOLD, rx_full_threshold)
+    rx_timeout = config.get(CONF_RX_TIMEOUT, rx_timeout)
+    if rx_full_threshold is not None:
+        cg.add(var.set_rx_full_threshold(rx_full_threshold))
+    if rx_timeout is not None:
+        cg.add(var.set_rx_timeout(rx_timeout))
+    cg.add(var.set_overflow_recovery(config[CONF_OVERFLOW_RECOVERY]))
+    cg.add(var.set_detection_cache(config[CONF_DETECTION_CACHE]))
+    cg.add(var.set_single_task(config[CONF_SINGLE_TASK]))
+
+    if config[CONF_STATIC_ALLOCATION]:
+        # tasks, queues and buffers are sized at compile time, for the largest instance
+        instances = CORE.config[DOMAIN]
+        cg.add_define("USE_HM_RF_BRIDGE_STATIC_ALLOCATION")
+        cg.add_define(
+            "HM_RF_BRIDGE_STATIC_RX_BUFFER_SIZE",
+            max(_uart_rx_buffer_size(conf[CONF_UART_ID]) for conf in instances),
+        )
+        batch_sizes = [
+            conf[CONF_BULK_TRANSFER][CONF_BATCH_SIZE]
+            for conf in instances
+            if CONF_BULK_TRANSFER in conf
+        ]
+        if batch_sizes:
+            cg.add_define("HM_RF_BRIDGE_STATIC_BULK_BATCH_SIZE", max(batch_sizes))
+        ring_sizes = [
+            conf[CONF_PIPELINE][CONF_RING_SIZE]
+            for conf in instances
+            if CONF_PIPELINE in conf
+        ]
+        if ring_sizes:
+            cg.add_define("HM_RF_BRIDGE_STATIC_PIPELINE_SIZE", max(ring_sizes))
+        if all(conf[CONF_SINGLE_TASK] for conf in instances):
+            # no instance runs a UDP task, its stack is left out
+            cg.add_define("HM_RF_BRIDGE_STATIC_SINGLE_TASK", 1)
+
+    if CONF_DUTY_CYCLE in config:
+        duty_cycle = config[CONF_DUTY_CYCLE]
+        cg.add(var.set_duty_cycle(duty_cycle[CONF_WARNING_THRESHOLD] * 100))
+        for key, name in DUTY_CYCLE_SENSORS.items():
+            if key in duty_cycle:
+                sens = await sensor.new_sensor(duty_cycle[key])
+                cg.add(getattr(var, f"set_{name}_sensor")(sens))
+        if CONF_WARNING in duty_cycle:
+            warning = await binary_sensor.new_binary_sensor(duty_cycle[CONF_WARNING])
+            cg.add(var.set_duty_cycle_warning_sensor(warning))
+
+    if CONF_TX_SCHEDULER in config:
+        tx_scheduler = config[CONF_TX_SCHEDULER]
+        cg.add(
+            var.set_tx_scheduler(
+                tx_scheduler[CONF_AGING_TIME], tx_scheduler[CONF_BULK_THRESHOLD]
+            )
+        )
+        for key in TX_QUEUE_TIME_SENSORS:
+            if key in tx_scheduler:
+                sens = await sensor.new_sensor(tx_scheduler[key])
+                cg.add(getattr(var, f"set_{key}_sensor")(sens))
+
+    if CONF_BULK_TRANSFER in config:
+        bulk_transfer = config[CONF_BULK_TRANSFER]
+        cg.add(
+            var.set_bulk_transfer(
+                bulk_transfer[CONF_BATCH_SIZE], bulk_transfer[CONF_IDLE_TIMEOUT]
+            )
+        )
+        if CONF_ACTIVE in bulk_transfer:
+            active = await binary_sensor.new_binary_sensor(bulk_transfer[CONF_ACTIVE])
+            cg.add(var.set_bulk_transfer_sensor(active))
+
+    if CONF_PIPELINE in config:
+        pipeline = config[CONF_PIPELINE]
+        cg.add(
+            var.set_pipeline(
+                pipeline[CONF_RING_SIZE],
+                pipeline[CONF_UART_CORE],
+                pipeline[CONF_NETWORK_CORE],
+            )
+        )
+        if CONF_HIGH_WATER_MARK in pipeline:
+            sens = await sensor.new_sensor(pipeline[CONF_HIGH_WATER_MARK])
+            cg.add(var.set_pipeline_high_water_mark_sensor(sens))
+
+    if CONF_FRAME_LOG in config:
+        cg.add(var.set_frame_log(config[CONF_FRAME_LOG][CONF_QUEUE_SIZE]))
+
+    if CONF_TRACE_LOG in config:
+        cg.add(var.set_trace_log(config[CONF_TRACE_LOG][CONF_SIZE]))
+
+    if CONF_CAPTURE_MIRROR in config:
+        mirror = config[CONF_CAPTURE_MIRROR]
+        cg.add(
+            var.set_capture_mirror(
+                str(mirror[CONF_HOST]), mirror[CONF_PORT], mirror[CONF_QUEUE_SIZE]
+            )
+        )
+
+    if CONF_FLIGHT_RECORDER in config:
+        recorder = config[CONF_FLIGHT_RECORDER]
+        cg.add_define("USE_HM_RF_BRIDGE_FLIGHT_RECORDER")
+        trigger_mask = 0
+        for trigger in recorder[CONF_FREEZE_ON]:
+            trigger_mask |= 1 << FLIGHT_RECORDER_TRIGGERS[trigger]
+        cg.add(
+            var.set_flight_recorder(
+                recorder[CONF_SIZE], recorder[CONF_SNAP_LENGTH], trigger_mask
+            )
+        )
+        base = await cg.get_variable(recorder[CONF_WEB_SERVER_BASE_ID])
+        cg.add(var.set_web_server_base(base))
+
     await cg.register_component(var, config)
+
+
+@automation.register_action(
+    "hm_rf_bridge.reset_latency",
+    ResetLatencyAction,
+    automation.maybe_simple_id({cv.GenerateID(): cv.use_id(HmRFBridge)}),
+)
+async def reset_latency_to_code(config, action_id, template_arg, args):
+    var = cg.new_Pvariable(action_id, template_arg)
+    await cg.register_parented(var, config[CONF_ID])
+    return var
+
+
+@automation.register_action(
+    "hm_rf_bridge.freeze_flight_recorder",
+    FreezeFlightRecorderAction,
+    automation.maybe_simple_id({cv.GenerateID(): cv.use_id(HmRFBridge)}),
+)
+@automation.register_action(
+    "hm_rf_bridge.rearm_flight_recorder",
+    RearmFlightRecorderAction,
+    automation.maybe_simple_id({cv.GenerateID(): cv.use_id(HmRFBridge)}),
+)
+async def flight_recorder_action_to_code(config, action_id, template_arg, args):
+    var = cg.new_Pvariable(action_id, template_arg)
+    await cg.register_parented(var, config[CONF_ID])
+    return var
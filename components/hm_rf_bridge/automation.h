@@ -0,0 +1,29 @@
+#pragma once
+
+#include "esphome/core/automation.h"
+#include "hm_rf_bridge.h"
+
+#ifdef USE_ESP32
+
+namespace esphome::hm_rf_bridge {
+
+template<typename... Ts> class ResetLatencyAction : public Action<Ts...>, public Parented<HmRFBridge> {
+ public:
+  void play(Ts... x) override { this->parent_->reset_latency(); }
+};
+
+#ifdef USE_HM_RF_BRIDGE_FLIGHT_RECORDER
+template<typename... Ts> class FreezeFlightRecorderAction : public Action<Ts...>, public Parented<HmRFBridge> {
+ public:
+  void play(Ts... x) override { this->parent_->freeze_flight_recorder(); }
+};
+
+template<typename... Ts> class RearmFlightRecorderAction : public Action<Ts...>, public Parented<HmRFBridge> {
+ public:
+  void play(Ts... x) override { this->parent_->rearm_flight_recorder(); }
+};
+#endif
+
+}  // namespace esphome::hm_rf_bridge
+
+#endif
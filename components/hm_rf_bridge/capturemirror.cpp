@@ -0,0 +1,61 @@
+#include "capturemirror.h"
+#include <string.h>
+#include "flightrecorder.h"
+#include "esphome/core/log.h"
+
+static const char *TAG = "CaptureMirror";
+
+#define TZSP_VERSION 1
+#define TZSP_TYPE_RECEIVED 0
+#define TZSP_TYPE_TRANSMIT 1
+#define TZSP_TAG_END 1
+#define TZSP_TAG_TIMESTAMP 13     // lower 32 bit of the esp_timer timestamp in us
+#define TZSP_TAG_PACKET_COUNT 40  // gaps show frames dropped by the tap or lost on the network
+
+static uint8_t *_putTag(uint8_t *pos, uint8_t tag, uint32_t value) {
+  *pos++ = tag;
+  *pos++ = 4;
+  value = htonl(value);
+  memcpy(pos, &value, 4);
+  return pos + 4;
+}
+
+CaptureMirrorTap::CaptureMirrorTap(const char *host, uint16_t port, size_t queueSize)
+    : FrameTap("hm_capture_mirror", queueSize, 2), _host(host), _port(port) {}
+
+void CaptureMirrorTap::processFrame(const tap_frame_header_t *header, const unsigned char *buffer) {
+  if (_socket < 0) {
+    memset(&_collector, 0, sizeof(_collector));
+    _collector.sin_family = AF_INET;
+    _collector.sin_port = htons(_port);
+    _collector.sin_addr.s_addr = inet_addr(_host);
+
+    _socket = socket(AF_INET, SOCK_DGRAM, 0);
+    if (_socket < 0) {
+      atomic_fetch_add_explicit(&_sendErrors, 1u, std::memory_order_relaxed);
+      return;
+    }
+    ESP_LOGD(TAG, "Mirroring frames to %s:%u", _host, _port);
+  }
+
+  uint8_t *pos = _packet;
+  *pos++ = TZSP_VERSION;
+  *pos++ = header->direction == FRAME_DIRECTION_RX ? TZSP_TYPE_RECEIVED : TZSP_TYPE_TRANSMIT;
+  *pos++ = FLIGHT_RECORDER_LINKTYPE >> 8;
+  *pos++ = FLIGHT_RECORDER_LINKTYPE & 0xff;
+  pos = _putTag(pos, TZSP_TAG_TIMESTAMP, (uint32_t) header->timestamp);
+  pos = _putTag(pos, TZSP_TAG_PACKET_COUNT, _packetCount++);
+  *pos++ = TZSP_TAG_END;
+
+  *pos++ = header->direction;
+  *pos++ = header->flags;
+
+  size_t len = header->len;
+  if (len > (size_t) (_packet + sizeof(_packet) - pos))
+    len = _packet + sizeof(_packet) - pos;
+  memcpy(pos, buffer, len);
+  pos += len;
+
+  if (sendto(_socket, _packet, pos - _packet, 0, (struct sockaddr *) &_collector, sizeof(_collector)) < 0)
+    atomic_fetch_add_explicit(&_sendErrors, 1u, std::memory_order_relaxed);
+}
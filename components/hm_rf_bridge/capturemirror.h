@@ -0,0 +1,30 @@
+#pragma once
+
+#include "frametap.h"
+#include <stdint.h>
+#include <atomic>
+#include "lwip/sockets.h"
+
+#define CAPTURE_MIRROR_DEFAULT_PORT 37008
+#define CAPTURE_MIRROR_MAX_PACKET 1472  // UDP payload of a non fragmented packet
+
+// Streams every frame to a collector as TZSP packet. The encapsulated packet is the same as in the flight recorder
+// pcap: direction, flags and the frame starting with 0xfd.
+class CaptureMirrorTap : public FrameTap {
+ private:
+  const char *_host;
+  uint16_t _port;
+  int _socket{-1};
+  struct sockaddr_in _collector;
+  uint32_t _packetCount{0};
+  std::atomic<uint32_t> _sendErrors{0};
+  uint8_t _packet[CAPTURE_MIRROR_MAX_PACKET];
+
+ protected:
+  void processFrame(const tap_frame_header_t *header, const unsigned char *buffer) override;
+
+ public:
+  CaptureMirrorTap(const char *host, uint16_t port, size_t queueSize);
+
+  uint32_t getSendErrors() { return atomic_load(&_sendErrors); }
+};
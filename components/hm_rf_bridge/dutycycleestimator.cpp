@@ -0,0 +1,78 @@
+#include "dutycycleestimator.h"
+#include "hmframe.h"
+
+// Over the air each radio frame is wrapped in preamble, sync word, length byte and CRC. The data rates and overheads
+// are estimates, the commands to the module carry a few parameter bytes more than the radio frame itself, so the
+// result errs on the high side.
+#define HMIP_BITRATE 10000
+#define HMIP_OVERHEAD 11
+#define BIDCOS_BITRATE 10000
+#define BIDCOS_OVERHEAD 11
+
+#define MINUTE_US 60000000ll
+
+DutyCycleEstimator::DutyCycleEstimator() {
+  for (duty_cycle_bucket_t &bucket : _buckets) {
+    atomic_init(&bucket.minute, 0u);
+    for (int protocol = 0; protocol < DUTY_CYCLE_PROTOCOLS; protocol++)
+      atomic_init(&bucket.airtime[protocol], 0u);
+  }
+  for (int protocol = 0; protocol < DUTY_CYCLE_PROTOCOLS; protocol++)
+    atomic_init(&_frames[protocol], 0u);
+}
+
+uint32_t DutyCycleEstimator::estimateAirtime(duty_cycle_protocol_t protocol, uint16_t dataLen) {
+  if (protocol == DUTY_CYCLE_PROTOCOL_HMIP)
+    return (uint64_t) (dataLen + HMIP_OVERHEAD) * 8 * 1000000 / HMIP_BITRATE;
+  return (uint64_t) (dataLen + BIDCOS_OVERHEAD) * 8 * 1000000 / BIDCOS_BITRATE;
+}
+
+void DutyCycleEstimator::record(const unsigned char *buffer, uint16_t len, int64_t now) {
+  HMFrame frame;
+  if (!HMFrame::TryParseHeader(buffer, len, &frame))
+    return;
+
+  duty_cycle_protocol_t protocol;
+  if (frame.destination == HM_DST_HMIP && frame.command == HM_CMD_HMIP_SEND) {
+    protocol = DUTY_CYCLE_PROTOCOL_HMIP;
+  } else if (frame.destination == HM_DST_LLMAC && frame.data_len >= HM_LLMAC_MIN_RADIO_FRAME_LEN) {
+    protocol = DUTY_CYCLE_PROTOCOL_BIDCOS;
+  } else {
+    return;
+  }
+
+  // bucket minutes start at 1, so 0 marks a bucket never written
+  uint32_t minute = now / MINUTE_US + 1;
+  duty_cycle_bucket_t &bucket = _buckets[minute % DUTY_CYCLE_WINDOW_MINUTES];
+  if (atomic_load_explicit(&bucket.minute, std::memory_order_relaxed) != minute) {
+    for (int i = 0; i < DUTY_CYCLE_PROTOCOLS; i++)
+      atomic_store_explicit(&bucket.airtime[i], 0u, std::memory_order_relaxed);
+    atomic_store_explicit(&bucket.minute, minute, std::memory_order_release);
+  }
+
+  atomic_fetch_add_explicit(&bucket.airtime[protocol], estimateAirtime(protocol, frame.data_len), std::memory_order_relaxed);
+  atomic_fetch_add_explicit(&_frames[protocol], 1u, std::memory_order_relaxed);
+}
+
+uint32_t DutyCycleEstimator::getAirtime(duty_cycle_protocol_t protocol, int64_t now) {
+  uint32_t minute = now / MINUTE_US + 1;
+  uint32_t airtime = 0;
+
+  for (duty_cycle_bucket_t &bucket : _buckets) {
+    uint32_t bucketMinute = atomic_load_explicit(&bucket.minute, std::memory_order_acquire);
+    if (bucketMinute && minute - bucketMinute < DUTY_CYCLE_WINDOW_MINUTES)
+      airtime += atomic_load_explicit(&bucket.airtime[protocol], std::memory_order_relaxed);
+  }
+  return airtime;
+}
+
+float DutyCycleEstimator::getUsage(duty_cycle_protocol_t protocol, int64_t now) {
+  return getAirtime(protocol, now) * 100.0f / DUTY_CYCLE_BUDGET_US;
+}
+
+float DutyCycleEstimator::getUsage(int64_t now) {
+  float usage = 0;
+  for (int protocol = 0; protocol < DUTY_CYCLE_PROTOCOLS; protocol++)
+    usage += getUsage((duty_cycle_protocol_t) protocol, now);
+  return usage;
+}
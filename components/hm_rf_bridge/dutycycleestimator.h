@@ -0,0 +1,44 @@
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+
+#define DUTY_CYCLE_WINDOW_MINUTES 60
+#define DUTY_CYCLE_BUDGET_US 36000000ull  // 1% of an hour
+
+typedef enum {
+  DUTY_CYCLE_PROTOCOL_HMIP = 0,
+  DUTY_CYCLE_PROTOCOL_BIDCOS = 1,
+  DUTY_CYCLE_PROTOCOLS = 2,
+} duty_cycle_protocol_t;
+
+typedef struct {
+  std::atomic<uint32_t> minute;
+  std::atomic<uint32_t> airtime[DUTY_CYCLE_PROTOCOLS];  // us
+} duty_cycle_bucket_t;
+
+// Estimates the transmit airtime of the radio module over the last hour from the frames sent to it. The airtime of a
+// frame is derived from its length and the data rate of its protocol and summed up in a ring of per minute buckets.
+// The module enforces the duty cycle itself, the estimate shows the limit coming before frames get delayed.
+// record() is called from the bridge task, the usage is evaluated from the ESPHome loop.
+class DutyCycleEstimator {
+ private:
+  duty_cycle_bucket_t _buckets[DUTY_CYCLE_WINDOW_MINUTES];
+  std::atomic<uint32_t> _frames[DUTY_CYCLE_PROTOCOLS];
+
+ public:
+  DutyCycleEstimator();
+
+  // Accounts a frame as sent to the radio module (escaped, starting with 0xfd), commands without radio
+  // transmission are ignored
+  void record(const unsigned char *buffer, uint16_t len, int64_t now);
+
+  // Airtime in us within the window ending at now
+  uint32_t getAirtime(duty_cycle_protocol_t protocol, int64_t now);
+  // Used duty cycle in percent of the budget of 1% per hour, over all protocols
+  float getUsage(int64_t now);
+  float getUsage(duty_cycle_protocol_t protocol, int64_t now);
+  uint32_t getFrames(duty_cycle_protocol_t protocol) { return atomic_load(&_frames[protocol]); }
+
+  static uint32_t estimateAirtime(duty_cycle_protocol_t protocol, uint16_t dataLen);
+};
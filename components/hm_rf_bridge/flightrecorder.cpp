@@ -0,0 +1,170 @@
+#include "flightrecorder.h"
+#include <string.h>
+#include <stdlib.h>
+#include <sys/time.h>
+#include <esp_timer.h>
+#include "esphome/core/log.h"
+
+static const char *TAG = "FlightRecorder";
+
+#define PCAP_MAGIC 0xa1b2c3d4
+#define PCAP_RECORD_PREFIX 2  // direction, flags
+#define WALL_CLOCK_VALID 1577836800  // 2020-01-01, anything before means the time was never set
+
+typedef struct {
+  uint32_t magic;
+  uint16_t versionMajor;
+  uint16_t versionMinor;
+  int32_t thisZone;
+  uint32_t sigFigs;
+  uint32_t snapLength;
+  uint32_t linkType;
+} pcap_header_t;
+
+typedef struct {
+  uint32_t seconds;
+  uint32_t microseconds;
+  uint32_t capturedLength;
+  uint32_t originalLength;
+} pcap_record_header_t;
+
+FlightRecorder::FlightRecorder(uint16_t slotCount, uint16_t snapLength)
+    : _slotCount(slotCount), _snapLength(snapLength), _triggerMask(0xffffffff) {
+  _slotSize = (sizeof(flight_recorder_slot_t) + snapLength + alignof(flight_recorder_slot_t) - 1) &
+              ~(alignof(flight_recorder_slot_t) - 1);
+  _slots = (uint8_t *) calloc(slotCount, _slotSize);
+  if (!_slots)
+    ESP_LOGE(TAG, "Could not allocate %u slots", slotCount);
+}
+
+FlightRecorder::~FlightRecorder() { free(_slots); }
+
+void FlightRecorder::_write(uint8_t direction, uint8_t flags, const unsigned char *buffer, uint16_t len) {
+  if (!_slots)
+    return;
+
+  uint32_t index = atomic_fetch_add(&_head, 1u);
+  flight_recorder_slot_t *slot = _slot(index);
+
+  atomic_store_explicit(&slot->sequence, 0u, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  uint16_t captured = len;
+  if (captured > _snapLength) {
+    captured = _snapLength;
+    flags |= FLIGHT_RECORDER_FLAG_TRUNCATED;
+  }
+
+  slot->timestamp = esp_timer_get_time();
+  slot->len = len;
+  slot->direction = direction;
+  slot->flags = flags;
+  if (captured)
+    memcpy((uint8_t *) (slot + 1), buffer, captured);
+
+  atomic_store_explicit(&slot->sequence, index + 1, std::memory_order_release);
+}
+
+void FlightRecorder::record(frame_direction_t direction, const unsigned char *buffer, uint16_t len, uint8_t flags) {
+  if (atomic_load_explicit(&_frozen, std::memory_order_acquire))
+    return;
+
+  _write(direction, flags, buffer, len);
+}
+
+void FlightRecorder::trigger(flight_recorder_trigger_t reason) {
+  if (atomic_load(&_triggerMask) & (1u << reason))
+    freeze(reason);
+}
+
+void FlightRecorder::freeze(flight_recorder_trigger_t reason) {
+  if (atomic_load(&_frozen))
+    return;
+
+  // the event record marks the position of the anomaly in the capture
+  _write(FLIGHT_RECORDER_DIRECTION_EVENT, reason, NULL, 0);
+  _freezeReason = reason;
+  if (!atomic_exchange(&_frozen, true))
+    ESP_LOGW(TAG, "Frozen by %s", getTriggerName(reason));
+}
+
+void FlightRecorder::rearm() {
+  // the ring is not cleared, the frames before the last freeze are overwritten as new frames arrive
+  atomic_store(&_frozen, false);
+}
+
+const char *FlightRecorder::getTriggerName(flight_recorder_trigger_t reason) {
+  switch (reason) {
+    case FLIGHT_RECORDER_TRIGGER_MANUAL:
+      return "manual";
+    case FLIGHT_RECORDER_TRIGGER_CRC_ERROR:
+      return "crc_error";
+    case FLIGHT_RECORDER_TRIGGER_OVERFLOW:
+      return "overflow";
+    case FLIGHT_RECORDER_TRIGGER_CONNECTION_TIMEOUT:
+      return "connection_timeout";
+    case FLIGHT_RECORDER_TRIGGER_PARSER_RESYNC:
+      return "parser_resync";
+    default:
+      return "unknown";
+  }
+}
+
+void FlightRecorder::exportPcap(std::function<void(const uint8_t *data, size_t len)> writer) {
+  pcap_header_t header = {
+      .magic = PCAP_MAGIC,
+      .versionMajor = 2,
+      .versionMinor = 4,
+      .thisZone = 0,
+      .sigFigs = 0,
+      .snapLength = (uint32_t) _snapLength + PCAP_RECORD_PREFIX,
+      .linkType = FLIGHT_RECORDER_LINKTYPE,
+  };
+  writer((const uint8_t *) &header, sizeof(header));
+
+  // timestamps are taken from esp_timer, shift them to wall clock time if it is known
+  int64_t offset = 0;
+  struct timeval now;
+  gettimeofday(&now, NULL);
+  if (now.tv_sec > WALL_CLOCK_VALID)
+    offset = (int64_t) now.tv_sec * 1000000 + now.tv_usec - esp_timer_get_time();
+
+  if (!_slots)
+    return;
+
+  uint8_t *record = (uint8_t *) malloc(sizeof(pcap_record_header_t) + PCAP_RECORD_PREFIX + _snapLength);
+  if (!record)
+    return;
+
+  uint32_t head = atomic_load(&_head);
+  uint32_t first = head > _slotCount ? head - _slotCount : 0;
+
+  for (uint32_t index = first; index < head; index++) {
+    flight_recorder_slot_t *slot = _slot(index);
+    if (atomic_load_explicit(&slot->sequence, std::memory_order_acquire) != index + 1)
+      continue;  // overwritten or still being written
+
+    uint16_t captured = slot->len < _snapLength ? slot->len : _snapLength;
+    int64_t timestamp = slot->timestamp + offset;
+
+    pcap_record_header_t *recordHeader = (pcap_record_header_t *) record;
+    recordHeader->seconds = timestamp / 1000000;
+    recordHeader->microseconds = timestamp % 1000000;
+    recordHeader->capturedLength = captured + PCAP_RECORD_PREFIX;
+    recordHeader->originalLength = slot->len + PCAP_RECORD_PREFIX;
+
+    uint8_t *data = record + sizeof(pcap_record_header_t);
+    data[0] = slot->direction;
+    data[1] = slot->flags;
+    memcpy(data + PCAP_RECORD_PREFIX, (const uint8_t *) (slot + 1), captured);
+
+    // the slot may have been reused while it was copied if the recorder is not frozen
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (atomic_load_explicit(&slot->sequence, std::memory_order_relaxed) != index + 1)
+      continue;
+
+    writer(record, sizeof(pcap_record_header_t) + PCAP_RECORD_PREFIX + captured);
+  }
+
+  free(record);
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <functional>
+#include "frametap.h"
+
+#define FLIGHT_RECORDER_LINKTYPE 147  // LINKTYPE_USER0
+
+// pseudo direction of event records, written next to the frames of the radio module
+#define FLIGHT_RECORDER_DIRECTION_EVENT 2  // flags hold the flight_recorder_trigger_t
+
+#define FLIGHT_RECORDER_FLAG_TRUNCATED 0x01  // frame was longer than the snap length
+#define FLIGHT_RECORDER_FLAG_DROPPED 0x02    // frame was dropped by the bridge (module in reset)
+
+typedef enum {
+  FLIGHT_RECORDER_TRIGGER_MANUAL = 0,
+  FLIGHT_RECORDER_TRIGGER_CRC_ERROR = 1,
+  FLIGHT_RECORDER_TRIGGER_OVERFLOW = 2,
+  FLIGHT_RECORDER_TRIGGER_CONNECTION_TIMEOUT = 3,
+  FLIGHT_RECORDER_TRIGGER_PARSER_RESYNC = 4,
+} flight_recorder_trigger_t;
+
+typedef struct {
+  std::atomic<uint32_t> sequence;  // index + 1 of the record in this slot, 0 while being written
+  int64_t timestamp;
+  uint16_t len;  // original length of the frame
+  uint8_t direction;
+  uint8_t flags;
+} flight_recorder_slot_t;
+
+// Fixed size ring of the most recent frames in both directions. Recording does not allocate and does not block, it
+// stops when the recorder is frozen by an anomaly or on demand, so the frames leading up to it can be exported as
+// pcap file afterwards.
+class FlightRecorder {
+ private:
+  uint16_t _slotCount;
+  uint16_t _snapLength;
+  size_t _slotSize;
+  uint8_t *_slots;
+  std::atomic<uint32_t> _head{0};
+  std::atomic<bool> _frozen{false};
+  std::atomic<uint32_t> _triggerMask;
+  flight_recorder_trigger_t _freezeReason{FLIGHT_RECORDER_TRIGGER_MANUAL};
+
+  flight_recorder_slot_t *_slot(uint32_t index) {
+    return (flight_recorder_slot_t *) (_slots + (index % _slotCount) * _slotSize);
+  }
+  void _write(uint8_t direction, uint8_t flags, const unsigned char *buffer, uint16_t len);
+
+ public:
+  FlightRecorder(uint16_t slotCount, uint16_t snapLength);
+  ~FlightRecorder();
+
+  // Called from the bridge tasks
+  void record(frame_direction_t direction, const unsigned char *buffer, uint16_t len, uint8_t flags = 0);
+  // Freezes the recorder if the anomaly is enabled in the trigger mask
+  void trigger(flight_recorder_trigger_t reason);
+
+  void freeze(flight_recorder_trigger_t reason = FLIGHT_RECORDER_TRIGGER_MANUAL);
+  void rearm();
+  bool isFrozen() { return atomic_load(&_frozen); }
+  flight_recorder_trigger_t getFreezeReason() { return _freezeReason; }
+  static const char *getTriggerName(flight_recorder_trigger_t reason);
+
+  void setTriggerMask(uint32_t triggerMask) { atomic_store(&_triggerMask, triggerMask); }
+  uint16_t getSlotCount() { return _slotCount; }
+  uint16_t getSnapLength() { return _snapLength; }
+
+  // Writes the recorded frames as pcap file with LINKTYPE_USER0, each packet is prefixed with direction and flags
+  // Safe while recording, frames overwritten during the export are left out
+  void exportPcap(std::function<void(const uint8_t *data, size_t len)> writer);
+};
@@ -0,0 +1,75 @@
+#include "framering.h"
+#include <string.h>
+
+#define FRAME_RING_RECORD_SIZE(__len) \
+  ((sizeof(frame_ring_header_t) + (__len) + FRAME_RING_ALIGNMENT - 1) & ~(uint32_t) (FRAME_RING_ALIGNMENT - 1))
+
+FrameRing::FrameRing(uint8_t *buffer, size_t size) : _buffer(buffer) {
+  _size = FRAME_RING_ALIGNMENT;
+  while (_size * 2 <= size)
+    _size <<= 1;
+}
+
+bool FrameRing::push(const unsigned char *buffer, uint16_t len, uint32_t receiveTime) {
+  uint32_t needed = FRAME_RING_RECORD_SIZE(len);
+  uint32_t head = atomic_load_explicit(&_head, std::memory_order_relaxed);
+  uint32_t tail = atomic_load_explicit(&_tail, std::memory_order_acquire);
+
+  // a frame never wraps around, the rest of the buffer is skipped instead
+  uint32_t offset = head & (_size - 1);
+  uint32_t skip = _size - offset < needed ? _size - offset : 0;
+  uint32_t used = head - tail + skip + needed;
+
+  if (used > _size) {
+    atomic_fetch_add_explicit(&_dropped, 1u, std::memory_order_relaxed);
+    return false;
+  }
+
+  if (skip) {
+    ((frame_ring_header_t *) (_buffer + offset))->len = FRAME_RING_WRAP;
+    offset = 0;
+  }
+
+  frame_ring_header_t *header = (frame_ring_header_t *) (_buffer + offset);
+  header->len = len;
+  header->receiveTime = receiveTime;
+  memcpy(header + 1, buffer, len);
+
+  if (used > atomic_load_explicit(&_highWaterMark, std::memory_order_relaxed))
+    atomic_store_explicit(&_highWaterMark, used, std::memory_order_relaxed);
+
+  atomic_store_explicit(&_head, head + skip + needed, std::memory_order_release);
+  return true;
+}
+
+const unsigned char *FrameRing::front(uint16_t *len, uint32_t *receiveTime) {
+  uint32_t tail = atomic_load_explicit(&_tail, std::memory_order_relaxed);
+  uint32_t head = atomic_load_explicit(&_head, std::memory_order_acquire);
+
+  if (tail == head)
+    return NULL;
+
+  frame_ring_header_t *header = (frame_ring_header_t *) (_buffer + (tail & (_size - 1)));
+  if (header->len == FRAME_RING_WRAP) {
+    tail += _size - (tail & (_size - 1));
+    atomic_store_explicit(&_tail, tail, std::memory_order_release);
+    if (tail == head)
+      return NULL;
+    header = (frame_ring_header_t *) _buffer;
+  }
+
+  *len = header->len;
+  *receiveTime = header->receiveTime;
+  return (const unsigned char *) (header + 1);
+}
+
+void FrameRing::pop() {
+  uint32_t tail = atomic_load_explicit(&_tail, std::memory_order_relaxed);
+  frame_ring_header_t *header = (frame_ring_header_t *) (_buffer + (tail & (_size - 1)));
+  atomic_store_explicit(&_tail, tail + FRAME_RING_RECORD_SIZE(header->len), std::memory_order_release);
+}
+
+uint32_t FrameRing::getUsed() {
+  uint32_t tail = atomic_load_explicit(&_tail, std::memory_order_acquire);
+  return atomic_load_explicit(&_head, std::memory_order_acquire) - tail;
+}
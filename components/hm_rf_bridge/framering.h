@@ -0,0 +1,46 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+
+#define FRAME_RING_ALIGNMENT 8  // records start aligned, so a header always fits in front of the end of the buffer
+
+typedef struct {
+  uint16_t len;          // FRAME_RING_WRAP marks the unused end of the buffer
+  uint16_t reserved;
+  uint32_t receiveTime;  // lower 32 bits of esp_timer_get_time(), enough for latencies
+} frame_ring_header_t;
+
+#define FRAME_RING_WRAP 0xffff
+
+// Lock-free single producer / single consumer ring of frames in a caller provided buffer. Frames are stored
+// contiguously behind a small header, so the consumer can hand them on without copying them out first. The producer
+// never blocks, frames are dropped and counted when the ring is full. The fill level is tracked as high-water mark.
+class FrameRing {
+ private:
+  uint8_t *_buffer;
+  uint32_t _size;  // power of two
+  std::atomic<uint32_t> _head{0};  // written by the producer only
+  std::atomic<uint32_t> _tail{0};  // written by the consumer only
+  std::atomic<uint32_t> _highWaterMark{0};
+  std::atomic<uint32_t> _dropped{0};
+
+ public:
+  // Uses the largest power of two of size bytes from buffer
+  FrameRing(uint8_t *buffer, size_t size);
+
+  // Producer side
+  bool push(const unsigned char *buffer, uint16_t len, uint32_t receiveTime);
+
+  // Consumer side: the oldest frame or NULL, it stays valid until pop()
+  const unsigned char *front(uint16_t *len, uint32_t *receiveTime);
+  void pop();
+
+  uint32_t getSize() { return _size; }
+  // Bytes in use including headers and alignment
+  uint32_t getUsed();
+  uint32_t getHighWaterMark() { return atomic_load_explicit(&_highWaterMark, std::memory_order_relaxed); }
+  void resetHighWaterMark() { atomic_store_explicit(&_highWaterMark, 0u, std::memory_order_relaxed); }
+  uint32_t getDropped() { return atomic_load_explicit(&_dropped, std::memory_order_relaxed); }
+};
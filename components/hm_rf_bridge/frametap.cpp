@@ -0,0 +1,65 @@
+#include "frametap.h"
+#include <string.h>
+#include <esp_timer.h>
+#include "esphome/core/log.h"
+#include "esphome/core/helpers.h"
+
+static const char *TAG = "FrameTap";
+
+void _frameTapQueueHandlerTask(void *parameter) { ((FrameTap *) parameter)->_tapQueueHandler(); }
+
+FrameTap::FrameTap(const char *name, size_t queueSize, UBaseType_t priority)
+    : _name(name), _queueSize(queueSize), _priority(priority) {}
+
+void FrameTap::start() {
+  _ringbuf = xRingbufferCreate(_queueSize, RINGBUF_TYPE_NOSPLIT);
+  xTaskCreate(_frameTapQueueHandlerTask, _name, 3072, this, _priority, &_tHandle);
+}
+
+void FrameTap::stop() {
+  if (_tHandle) {
+    vTaskDelete(_tHandle);
+    _tHandle = nullptr;
+  }
+  if (_ringbuf) {
+    vRingbufferDelete(_ringbuf);
+    _ringbuf = nullptr;
+  }
+}
+
+void FrameTap::offer(frame_direction_t direction, const unsigned char *buffer, uint16_t len) {
+  void *item;
+
+  if (xRingbufferSendAcquire(_ringbuf, &item, sizeof(tap_frame_header_t) + len, 0) != pdTRUE) {
+    atomic_fetch_add_explicit(&_dropped, 1u, std::memory_order_relaxed);
+    return;
+  }
+
+  tap_frame_header_t *header = (tap_frame_header_t *) item;
+  header->timestamp = esp_timer_get_time();
+  header->len = len;
+  header->direction = direction;
+  header->flags = 0;
+  memcpy(header + 1, buffer, len);
+
+  xRingbufferSendComplete(_ringbuf, item);
+}
+
+void FrameTap::_tapQueueHandler() {
+  size_t size;
+
+  for (;;) {
+    tap_frame_header_t *header = (tap_frame_header_t *) xRingbufferReceive(_ringbuf, &size, portMAX_DELAY);
+    if (header) {
+      processFrame(header, (const unsigned char *) (header + 1));
+      vRingbufferReturnItem(_ringbuf, header);
+    }
+  }
+
+  vTaskDelete(NULL);
+}
+
+void LoggingFrameTap::processFrame(const tap_frame_header_t *header, const unsigned char *buffer) {
+  ESP_LOGD(TAG, "%s %lld: %s", header->direction == FRAME_DIRECTION_RX ? "RX" : "TX", (long long) header->timestamp,
+           esphome::format_hex_pretty(buffer, header->len).c_str());
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/ringbuf.h"
+#include <stdint.h>
+#include <atomic>
+
+typedef enum {
+  FRAME_DIRECTION_RX = 0,  // radio module -> bridge
+  FRAME_DIRECTION_TX = 1,  // bridge -> radio module
+} frame_direction_t;
+
+typedef struct {
+  int64_t timestamp;
+  uint16_t len;
+  uint8_t direction;
+  uint8_t flags;
+} tap_frame_header_t;
+
+// Low priority frame consumer next to the primary FrameHandler. Frames are copied into a bounded ring buffer and
+// processed by an own task, frames are dropped if the ring buffer is full.
+class FrameTap {
+ private:
+  const char *_name;
+  size_t _queueSize;
+  UBaseType_t _priority;
+  RingbufHandle_t _ringbuf{nullptr};
+  TaskHandle_t _tHandle{nullptr};
+  std::atomic<uint32_t> _dropped{0};
+
+ protected:
+  bool _pausedInBulkTransfer{false};
+
+  virtual void processFrame(const tap_frame_header_t *header, const unsigned char *buffer) = 0;
+
+ public:
+  FrameTap(const char *name, size_t queueSize, UBaseType_t priority = 5);
+  virtual ~FrameTap() = default;
+
+  void start();
+  void stop();
+
+  // Called from the bridge tasks, never blocks
+  void offer(frame_direction_t direction, const unsigned char *buffer, uint16_t len);
+
+  uint32_t getDropped() { return atomic_load(&_dropped); }
+  // Taps that only produce log output get no frames during firmware updates
+  bool isPausedInBulkTransfer() { return _pausedInBulkTransfer; }
+
+  void _tapQueueHandler();
+};
+
+// Writes all frames to the debug log without slowing down the bridge tasks
+class LoggingFrameTap : public FrameTap {
+ protected:
+  void processFrame(const tap_frame_header_t *header, const unsigned char *buffer) override;
+
+ public:
+  LoggingFrameTap(size_t queueSize) : FrameTap("hm_frame_log", queueSize) { _pausedInBulkTransfer = true; }
+};
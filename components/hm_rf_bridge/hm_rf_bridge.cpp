@@ -1,30 +1,123 @@
 #include "hm_rf_bridge.h"
 #include "esphome/core/log.h"
 #include "esphome/core/application.h"
+#include "esphome/core/hal.h"
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <new>
 
 #ifdef USE_ESP32
 #include "radiomoduledetector.h"
 
 static const char *const TAG = "HmRFBridge";
 
+#define FLIGHT_RECORDER_CHUNK_SIZE 1024  // bytes per chunk of the pcap download
+
+// single core chips run the tasks without affinity
+static const char *core_name(BaseType_t core) { return core == 0 ? "0" : (core == 1 ? "1" : "any"); }
+
 namespace esphome::hm_rf_bridge {
 
 void HmRFBridge::setup() {
   ESP_LOGD(TAG, "setup started");
+#ifdef USE_HM_RF_BRIDGE_STATIC_ALLOCATION
+  this->radioModuleConnector_ = new (this->radio_module_connector_storage_)
+      RadioModuleConnector(this->reset_, this->uart_->get_uart_event_queue(),
+                           static_cast<uart_port_t>(this->uart_->get_hw_serial_number()),
+                           this->uart_->get_rx_buffer_size());
+#else
   this->radioModuleConnector_ = new RadioModuleConnector(this->reset_, this->uart_->get_uart_event_queue(),
                                                          static_cast<uart_port_t>(this->uart_->get_hw_serial_number()),
                                                          this->uart_->get_rx_buffer_size());
+#endif
 
   radioModuleConnector_->addLed(this->red_, this->green_, this->blue_);
+  radioModuleConnector_->setTrafficBlink(this->led_traffic_blink_);
+  radioModuleConnector_->setPatternDetect(this->rx_pattern_detect_);
+  radioModuleConnector_->setRxTuning(this->rx_full_threshold_, this->rx_timeout_);
+  radioModuleConnector_->setOverflowRecovery(this->overflow_recovery_);
+  radioModuleConnector_->setResetTimes(this->reset_hold_time_, this->reset_settle_time_);
+  radioModuleConnector_->setSingleTask(this->single_task_);
+  if (this->pipeline_ring_size_) {
+    // the UART stage gets its own core, the network stage shares the other one with the tcpip thread
+    radioModuleConnector_->setCore(this->pipeline_uart_core_);
+  }
+
+  if (this->duty_cycle_enabled_) {
+    this->duty_cycle_estimator_ = new DutyCycleEstimator();
+    this->radioModuleConnector_->setDutyCycleEstimator(this->duty_cycle_estimator_);
+  }
+
+  if (this->trace_log_size_) {
+    this->trace_log_ = new TraceLog(this->trace_log_size_);
+    this->radioModuleConnector_->setTraceLog(this->trace_log_);
+    // the bridge tasks only store the records, they are formatted in small portions to keep the loop short
+    this->set_interval("trace_log", 20, [this]() { this->trace_log_->flush(16); });
+  }
+
+  // the bridge on the default port keeps the names of a single instance, further ones add their UDP port
+  std::string instance = this->port_ == RAW_UART_DEFAULT_PORT ? "" : str_sprintf("_%u", this->port_);
+
+#ifdef USE_HM_RF_BRIDGE_FLIGHT_RECORDER
+  // the define is set once any instance has a flight recorder, the others leave it unconfigured
+  if (this->flight_recorder_slots_ && this->web_server_base_) {
+    this->flight_recorder_ = new FlightRecorder(this->flight_recorder_slots_, this->flight_recorder_snap_length_);
+    this->flight_recorder_->setTriggerMask(this->flight_recorder_trigger_mask_);
+    this->radioModuleConnector_->setFlightRecorder(this->flight_recorder_);
+    this->web_server_base_->init();
+    this->web_server_base_->add_handler(
+        new FlightRecorderHandler(this->flight_recorder_, "/hm_rf_bridge" + instance + "/flight_recorder.pcap"));
+  }
+#endif
+
+  if (this->detection_cache_) {
+    this->detection_pref_ = global_preferences->make_preference<radio_module_info_t>(
+        fnv1_hash("hm_rf_bridge_detection" + instance));
+    this->detection_cached_ = this->detection_pref_.load(&this->cached_info_) &&
+                              this->cached_info_.radioModuleType != RADIO_MODULE_NONE &&
+                              this->cached_info_.identify[0] != 0;
+    // the strings of the blob are compared and logged, a damaged one must not run past its field
+    this->cached_info_.identify[sizeof(this->cached_info_.identify) - 1] = 0;
+    this->cached_info_.serial[sizeof(this->cached_info_.serial) - 1] = 0;
+    this->cached_info_.sgtin[sizeof(this->cached_info_.sgtin) - 1] = 0;
+  }
 
   ESP_LOGD(TAG, "RadioModuleConnector started");
-  this->radioModuleConnector_->start();
+  // a module known from the last boot is probed first, it is only reset if it does not answer as expected
+  this->radioModuleConnector_->start(!this->detection_cached_);
 
   ESP_LOGD(TAG, "HM Modul detecting started");
-  RadioModuleDetector radio_module_detector;
-  radio_module_detector.detectRadioModule(radioModuleConnector_);
+  // detection takes up to several seconds, run it in the background so the rest of the node boots meanwhile
+  xTaskCreate(HmRFBridge::detection_task_, "HmRFBridge_Detection", 4096, this, 5, nullptr);
+}
+
+void HmRFBridge::detection_task_(void *parameter) {
+  auto *bridge = static_cast<HmRFBridge *>(parameter);
+
+  if (bridge->detection_cached_ &&
+      bridge->radio_module_detector_.verifyRadioModule(bridge->radioModuleConnector_, &bridge->cached_info_)) {
+    ESP_LOGD(TAG, "Radio module %s verified against detection cache", bridge->cached_info_.identify);
+  } else {
+    if (bridge->detection_cached_) {
+      ESP_LOGD(TAG, "Detection cache does not match, running full detection");
+      bridge->detection_cached_ = false;
+      bridge->radioModuleConnector_->resetModule();
+    }
+    bridge->radio_module_detector_.detectRadioModule(bridge->radioModuleConnector_);
+  }
+
+  bridge->detection_finished_.store(true);
+  vTaskDelete(nullptr);
+}
+
+void HmRFBridge::loop() {
+  if (!this->detection_finished_.load())
+    return;
 
-  auto radio_module_type = radio_module_detector.getRadioModuleType();
+  this->disable_loop();
+
+  auto radio_module_type = this->radio_module_detector_.getRadioModuleType();
 
   std::string type;
   if (radio_module_type != RADIO_MODULE_NONE) {
@@ -43,7 +136,7 @@ void HmRFBridge::setup() {
         break;
     }
 
-    auto firmware_version = radio_module_detector.getFirmwareVersion();
+    auto firmware_version = this->radio_module_detector_.getFirmwareVersion();
 
     auto firmware_str = esphome::str_sprintf("%u.%u.%u", firmware_version[0], firmware_version[1], firmware_version[2]);
     ESP_LOGD(TAG, "Firmware Version: %s", firmware_str.c_str());
@@ -51,29 +144,74 @@ void HmRFBridge::setup() {
       this->firmware_sensor_->publish_state(firmware_str);
     }
 
-    auto serial = radio_module_detector.getSerial();
+    auto serial = this->radio_module_detector_.getSerial();
     ESP_LOGD(TAG, "Serial %s", serial);
     if (this->serial_sensor_) {
       this->serial_sensor_->publish_state(serial);
     }
 
-    auto sgtin = radio_module_detector.getSGTIN();
+    auto sgtin = this->radio_module_detector_.getSGTIN();
     ESP_LOGD(TAG, " SGTIN: %s", sgtin);
     if (this->SGTIN_sensor_) {
       this->SGTIN_sensor_->publish_state(sgtin);
     }
 
+    if (this->red_ || this->green_ || this->blue_) {
+      // the bridge tasks only publish the LED state, the outputs are driven from the main loop
+      this->set_interval("led", 50, [this]() { this->radioModuleConnector_->updateLED(); });
+    }
+
+    if (this->frame_log_queue_size_) {
+      this->frame_log_ = new LoggingFrameTap(this->frame_log_queue_size_);
+      this->frame_log_->start();
+      this->radioModuleConnector_->addFrameTap(this->frame_log_);
+    }
+
+    if (this->capture_mirror_queue_size_) {
+      this->capture_mirror_ = new CaptureMirrorTap(this->capture_mirror_host_.c_str(), this->capture_mirror_port_,
+                                                   this->capture_mirror_queue_size_);
+      this->capture_mirror_->start();
+      this->radioModuleConnector_->addFrameTap(this->capture_mirror_);
+    }
+
+    // a verified module may report a new firmware version after a coprocessor update, the cache follows it
+    if (this->detection_cache_ && this->radio_module_detector_.isDetectionComplete()) {
+      radio_module_info_t info;
+      this->radio_module_detector_.getRadioModuleInfo(&info);
+      if (info.identify[0] != 0 && memcmp(&info, &this->cached_info_, sizeof(info)) != 0) {
+        this->detection_pref_.save(&info);
+        ESP_LOGD(TAG, "Detection result stored");
+      }
+    }
+
     ESP_LOGD(TAG, "Starting Raw Uart Udp Listener");
+#ifdef USE_HM_RF_BRIDGE_STATIC_ALLOCATION
+    this->rawUartUdpListener_ =
+        new (this->raw_uart_udp_listener_storage_) RawUartUdpListener(this->radioModuleConnector_);
+#else
     this->rawUartUdpListener_ = new RawUartUdpListener(this->radioModuleConnector_);
+#endif
+    if (this->tx_scheduler_enabled_) {
+      this->tx_scheduler_ = new TxScheduler(this->tx_scheduler_aging_time_, this->tx_scheduler_bulk_threshold_);
+      this->rawUartUdpListener_->setTxScheduler(this->tx_scheduler_);
+    }
+    this->rawUartUdpListener_->setBulkTransfer(this->bulk_transfer_batch_size_, this->bulk_transfer_idle_timeout_);
+    this->rawUartUdpListener_->setPipeline(this->pipeline_ring_size_, this->pipeline_network_core_);
+    this->rawUartUdpListener_->setPort(this->port_);
     this->rawUartUdpListener_->start();
 
-    this->disable_loop();
-
   } else {
-    ESP_LOGE(TAG, "Radio module could not be detected.");
+    ESP_LOGE(TAG, "Radio module for UDP port %u could not be detected.", this->port_);
     type = "No Radio Module";
     this->radioModuleConnector_->stop();
+    // records of the connector point to its tag, they are written out before it is deleted
+    if (this->trace_log_)
+      this->trace_log_->flush(this->trace_log_->getCapacity());
+#ifdef USE_HM_RF_BRIDGE_STATIC_ALLOCATION
+    this->radioModuleConnector_->~RadioModuleConnector();
+#else
     delete this->radioModuleConnector_;
+#endif
     this->radioModuleConnector_ = nullptr;
     this->mark_failed();
   }
@@ -84,16 +222,286 @@ void HmRFBridge::setup() {
 }
 
 void HmRFBridge::update() {
-  if (this->connected_) {
+  if (this->connected_ && this->rawUartUdpListener_) {
     if (bool new_state = this->rawUartUdpListener_->isConnected(); new_state != this->connected_->state) {
       this->connected_->publish_state(new_state);
     }
   }
+  if (this->rawUartUdpListener_) {
+    this->publish_statistics_();
+  }
+  if (this->bulk_transfer_ && this->rawUartUdpListener_) {
+    if (bool new_state = this->rawUartUdpListener_->isBulkTransfer(); new_state != this->bulk_transfer_->state) {
+      this->bulk_transfer_->publish_state(new_state);
+    }
+  }
+  if (this->duty_cycle_estimator_) {
+    this->publish_duty_cycle_();
+  }
+}
+
+void HmRFBridge::publish_duty_cycle_() {
+  int64_t now = esp_timer_get_time();
+  float usage = this->duty_cycle_estimator_->getUsage(now);
+
+  if (this->duty_cycle_)
+    this->duty_cycle_->publish_state(usage);
+  if (this->hmip_duty_cycle_)
+    this->hmip_duty_cycle_->publish_state(this->duty_cycle_estimator_->getUsage(DUTY_CYCLE_PROTOCOL_HMIP, now));
+  if (this->bidcos_duty_cycle_)
+    this->bidcos_duty_cycle_->publish_state(this->duty_cycle_estimator_->getUsage(DUTY_CYCLE_PROTOCOL_BIDCOS, now));
+
+  bool warning = usage >= this->duty_cycle_warning_threshold_;
+  if (warning != this->duty_cycle_warning_active_) {
+    if (warning) {
+      ESP_LOGW(TAG, "Estimated duty cycle at %.1f%% of the budget, the radio module will start delaying frames soon",
+               usage);
+    } else {
+      ESP_LOGI(TAG, "Estimated duty cycle back at %.1f%% of the budget", usage);
+    }
+    this->duty_cycle_warning_active_ = warning;
+  }
+  if (this->duty_cycle_warning_ && warning != this->duty_cycle_warning_->state)
+    this->duty_cycle_warning_->publish_state(warning);
 }
 
+void HmRFBridge::publish_statistics_() {
+  const raw_uart_statistics_t &stats = this->rawUartUdpListener_->getStatistics();
+  uint32_t now = millis();
+  uint32_t frames_to_udp = stats.framesToUdp.load(std::memory_order_relaxed);
+  uint32_t bytes_to_udp = stats.bytesToUdp.load(std::memory_order_relaxed);
+  uint32_t frames_to_uart = stats.framesToUart.load(std::memory_order_relaxed);
+  uint32_t bytes_to_uart = stats.bytesToUart.load(std::memory_order_relaxed);
+
+  // The first update after start only establishes the baseline for the rates
+  if (this->last_statistics_time_ != 0 && now != this->last_statistics_time_) {
+    float seconds = (now - this->last_statistics_time_) / 1000.0f;
+    if (this->uart_to_udp_frame_rate_)
+      this->uart_to_udp_frame_rate_->publish_state((frames_to_udp - this->last_frames_to_udp_) / seconds);
+    if (this->uart_to_udp_byte_rate_)
+      this->uart_to_udp_byte_rate_->publish_state((bytes_to_udp - this->last_bytes_to_udp_) / seconds);
+    if (this->udp_to_uart_frame_rate_)
+      this->udp_to_uart_frame_rate_->publish_state((frames_to_uart - this->last_frames_to_uart_) / seconds);
+    if (this->udp_to_uart_byte_rate_)
+      this->udp_to_uart_byte_rate_->publish_state((bytes_to_uart - this->last_bytes_to_uart_) / seconds);
+  }
+  this->last_statistics_time_ = now;
+  this->last_frames_to_udp_ = frames_to_udp;
+  this->last_bytes_to_udp_ = bytes_to_udp;
+  this->last_frames_to_uart_ = frames_to_uart;
+  this->last_bytes_to_uart_ = bytes_to_uart;
+
+  if (this->keepalives_sent_)
+    this->keepalives_sent_->publish_state(stats.keepAlivesSent.load(std::memory_order_relaxed));
+  if (this->keepalives_received_)
+    this->keepalives_received_->publish_state(stats.keepAlivesReceived.load(std::memory_order_relaxed));
+  if (this->dropped_oversized_)
+    this->dropped_oversized_->publish_state(stats.droppedOversized.load(std::memory_order_relaxed));
+  if (this->dropped_not_connected_)
+    this->dropped_not_connected_->publish_state(stats.droppedNotConnected.load(std::memory_order_relaxed));
+  if (this->dropped_crc_)
+    this->dropped_crc_->publish_state(stats.droppedCrc.load(std::memory_order_relaxed));
+  if (this->dropped_pipeline_full_)
+    this->dropped_pipeline_full_->publish_state(stats.droppedPipelineFull.load(std::memory_order_relaxed));
+  if (this->pipeline_high_water_mark_ && this->rawUartUdpListener_->getPipeline())
+    this->pipeline_high_water_mark_->publish_state(this->rawUartUdpListener_->getPipeline()->getHighWaterMark());
+
+  this->publish_latency_(this->rawUartUdpListener_->getUartToUdpLatency(), this->uart_to_udp_latency_p50_,
+                         this->uart_to_udp_latency_p99_, this->uart_to_udp_latency_max_);
+  this->publish_latency_(this->rawUartUdpListener_->getUdpToUartLatency(), this->udp_to_uart_latency_p50_,
+                         this->udp_to_uart_latency_p99_, this->udp_to_uart_latency_max_);
+
+  if (this->tx_scheduler_) {
+    for (int tx_class = 0; tx_class < TX_CLASSES; tx_class++) {
+      this->publish_latency_(this->tx_scheduler_->getQueueTime((tx_class_t) tx_class), nullptr,
+                             this->tx_queue_time_[tx_class], nullptr);
+    }
+  }
+}
+
+void HmRFBridge::publish_latency_(LatencyHistogram &histogram, sensor::Sensor *p50, sensor::Sensor *p99,
+                                  sensor::Sensor *max) {
+  // published in ms, recorded in us
+  if (p50)
+    p50->publish_state(histogram.getPercentile(50) / 1000.0f);
+  if (p99)
+    p99->publish_state(histogram.getPercentile(99) / 1000.0f);
+  if (max)
+    max->publish_state(histogram.getMax() / 1000.0f);
+}
+
+void HmRFBridge::reset_latency() {
+  if (this->rawUartUdpListener_) {
+    this->rawUartUdpListener_->resetLatency();
+    ESP_LOGI(TAG, "Latency statistics reset");
+  }
+}
+
+#ifdef USE_HM_RF_BRIDGE_FLIGHT_RECORDER
+void HmRFBridge::freeze_flight_recorder() {
+  if (this->flight_recorder_)
+    this->flight_recorder_->freeze();
+}
+
+void HmRFBridge::rearm_flight_recorder() {
+  if (this->flight_recorder_) {
+    this->flight_recorder_->rearm();
+    ESP_LOGI(TAG, "Flight recorder rearmed");
+  }
+}
+
+bool FlightRecorderHandler::canHandle(AsyncWebServerRequest *request) const {
+  return request->method() == HTTP_GET && request->url() == this->url_.c_str();
+}
+
+void FlightRecorderHandler::handleRequest(AsyncWebServerRequest *request) {
+  // the recorder keeps running during the download, slots overwritten while they are read are left out of the
+  // capture, so an anomaly during a download freezes it as usual
+  std::unique_ptr<uint8_t[]> chunk(new (std::nothrow) uint8_t[FLIGHT_RECORDER_CHUNK_SIZE]);
+  if (!chunk) {
+    request->send(500, "text/plain", "Out of memory");
+    return;
+  }
+
+  httpd_req_t *req = *request;
+  httpd_resp_set_type(req, "application/vnd.tcpdump.pcap");
+  httpd_resp_set_hdr(req, "Content-Disposition", "attachment; filename=\"hm_rf_bridge.pcap\"");
+
+  // records are collected into chunks, a chunk per record would be a socket write per frame
+  size_t used = 0;
+  esp_err_t err = ESP_OK;
+  this->flight_recorder_->exportPcap([req, &chunk, &used, &err](const uint8_t *data, size_t len) {
+    while (len > 0 && err == ESP_OK) {
+      size_t part = std::min(len, (size_t) FLIGHT_RECORDER_CHUNK_SIZE - used);
+      memcpy(chunk.get() + used, data, part);
+      used += part;
+      data += part;
+      len -= part;
+      if (used == FLIGHT_RECORDER_CHUNK_SIZE) {
+        err = httpd_resp_send_chunk(req, (const char *) chunk.get(), used);
+        used = 0;
+      }
+    }
+  });
+
+  if (err == ESP_OK && used > 0)
+    err = httpd_resp_send_chunk(req, (const char *) chunk.get(), used);
+  if (err == ESP_OK)
+    httpd_resp_send_chunk(req, NULL, 0);
+}
+#endif
+
 void HmRFBridge::dump_config() {
   ESP_LOGCONFIG(TAG, "hm_rf_brigde Component Configuration:");
   ESP_LOGCONFIG(TAG, "uart number %i", this->uart_->get_hw_serial_number());
+  ESP_LOGCONFIG(TAG, "  UDP port: %u", this->port_);
+  ESP_LOGCONFIG(TAG, "  RX pattern detect: %s", this->rx_pattern_detect_ ? "on" : "off");
+  if (this->rx_full_threshold_ >= 0) {
+    ESP_LOGCONFIG(TAG, "  RX full threshold: %i bytes", this->rx_full_threshold_);
+  }
+  if (this->rx_timeout_ >= 0) {
+    ESP_LOGCONFIG(TAG, "  RX timeout: %i symbols", this->rx_timeout_);
+  }
+  ESP_LOGCONFIG(TAG, "  Overflow recovery: %s", this->overflow_recovery_ ? "on" : "off");
+  ESP_LOGCONFIG(TAG, "  Detection cache: %s", this->detection_cache_ ? "on" : "off");
+  if (this->single_task_) {
+    // falls back to two tasks without memory for the queue set
+    bool active = this->radioModuleConnector_ && this->radioModuleConnector_->isSingleTask();
+    ESP_LOGCONFIG(TAG, "  Single task: %s", active ? "on" : "off, UDP task of its own");
+  }
+#ifdef USE_HM_RF_BRIDGE_STATIC_ALLOCATION
+  ESP_LOGCONFIG(TAG, "  Static allocation: connector %u bytes, listener %u bytes",
+                (unsigned) sizeof(RadioModuleConnector), (unsigned) sizeof(RawUartUdpListener));
+#endif
+  if (this->frame_log_) {
+    ESP_LOGCONFIG(TAG, "  Frame log: queue %u bytes, %u frames dropped", this->frame_log_queue_size_,
+                  this->frame_log_->getDropped());
+  }
+#ifdef USE_HM_RF_BRIDGE_FLIGHT_RECORDER
+  if (this->flight_recorder_) {
+    ESP_LOGCONFIG(TAG, "  Flight recorder: %u frames, snap length %u bytes, %s", this->flight_recorder_->getSlotCount(),
+                  this->flight_recorder_->getSnapLength(),
+                  this->flight_recorder_->isFrozen()
+                      ? FlightRecorder::getTriggerName(this->flight_recorder_->getFreezeReason())
+                      : "recording");
+  }
+#endif
+  if (this->capture_mirror_) {
+    ESP_LOGCONFIG(TAG, "  Capture mirror: %s:%u, queue %u bytes, %u frames dropped, %u send errors",
+                  this->capture_mirror_host_.c_str(), this->capture_mirror_port_, this->capture_mirror_queue_size_,
+                  this->capture_mirror_->getDropped(), this->capture_mirror_->getSendErrors());
+  }
+  if (this->trace_log_) {
+    ESP_LOGCONFIG(TAG, "  Trace log: %u records, %u dropped", this->trace_log_->getCapacity(),
+                  this->trace_log_->getDropped());
+  }
+  if (this->duty_cycle_estimator_) {
+    int64_t now = esp_timer_get_time();
+    ESP_LOGCONFIG(TAG, "  Duty cycle: %.1f%% of the budget, warning at %.0f%%",
+                  this->duty_cycle_estimator_->getUsage(now), this->duty_cycle_warning_threshold_);
+    ESP_LOGCONFIG(TAG, "  Airtime last hour: HmIP %u ms, BidCoS %u ms (%u / %u frames since boot)",
+                  this->duty_cycle_estimator_->getAirtime(DUTY_CYCLE_PROTOCOL_HMIP, now) / 1000,
+                  this->duty_cycle_estimator_->getAirtime(DUTY_CYCLE_PROTOCOL_BIDCOS, now) / 1000,
+                  this->duty_cycle_estimator_->getFrames(DUTY_CYCLE_PROTOCOL_HMIP),
+                  this->duty_cycle_estimator_->getFrames(DUTY_CYCLE_PROTOCOL_BIDCOS));
+  }
+  ESP_LOGCONFIG(TAG, "  Reset hold time: %u ms, settle time: %u ms", this->reset_hold_time_, this->reset_settle_time_);
+  if (this->radioModuleConnector_ && this->radioModuleConnector_->getResetToFirstFrameTime()) {
+    ESP_LOGCONFIG(TAG, "  Reset to first frame: %u us", this->radioModuleConnector_->getResetToFirstFrameTime());
+  }
+  if (this->radioModuleConnector_ && this->radioModuleConnector_->getOverflowCount()) {
+    ESP_LOGCONFIG(TAG, "  UART overflows: %u, lost %u bytes in %u frames",
+                  this->radioModuleConnector_->getOverflowCount(), this->radioModuleConnector_->getOverflowBytesLost(),
+                  this->radioModuleConnector_->getOverflowFramesLost());
+  }
+  if (this->rawUartUdpListener_) {
+    const raw_uart_statistics_t &stats = this->rawUartUdpListener_->getStatistics();
+    ESP_LOGCONFIG(TAG, "  UART->UDP: %u frames, %u bytes; UDP->UART: %u frames, %u bytes",
+                  stats.framesToUdp.load(), stats.bytesToUdp.load(), stats.framesToUart.load(),
+                  stats.bytesToUart.load());
+    ESP_LOGCONFIG(TAG, "  Dropped: %u oversized, %u not connected, %u CRC, %u pipeline full",
+                  stats.droppedOversized.load(), stats.droppedNotConnected.load(), stats.droppedCrc.load(),
+                  stats.droppedPipelineFull.load());
+    ESP_LOGCONFIG(TAG, "  Latency UART->UDP: p50 %u us, p99 %u us, max %u us",
+                  this->rawUartUdpListener_->getUartToUdpLatency().getPercentile(50),
+                  this->rawUartUdpListener_->getUartToUdpLatency().getPercentile(99),
+                  this->rawUartUdpListener_->getUartToUdpLatency().getMax());
+    ESP_LOGCONFIG(TAG, "  Latency UDP send: p50 %u us, p99 %u us, max %u us",
+                  this->rawUartUdpListener_->getUdpSendLatency().getPercentile(50),
+                  this->rawUartUdpListener_->getUdpSendLatency().getPercentile(99),
+                  this->rawUartUdpListener_->getUdpSendLatency().getMax());
+    ESP_LOGCONFIG(TAG, "  Latency UDP->UART: p50 %u us, p99 %u us, max %u us",
+                  this->rawUartUdpListener_->getUdpToUartLatency().getPercentile(50),
+                  this->rawUartUdpListener_->getUdpToUartLatency().getPercentile(99),
+                  this->rawUartUdpListener_->getUdpToUartLatency().getMax());
+  }
+  if (this->rawUartUdpListener_ && this->rawUartUdpListener_->getBulkBatchSize()) {
+    const bulk_transfer_statistics_t &stats = this->rawUartUdpListener_->getBulkTransferStatistics();
+    ESP_LOGCONFIG(TAG, "  Bulk transfer: batch %u bytes, idle timeout %u ms, %s",
+                  this->rawUartUdpListener_->getBulkBatchSize(), this->rawUartUdpListener_->getBulkIdleTimeout() / 1000,
+                  this->rawUartUdpListener_->isBulkTransfer() ? "streaming" : "idle");
+    ESP_LOGCONFIG(TAG, "    %u sessions, last %u ms, %u frames / %u bytes in %u UART writes", stats.sessions.load(),
+                  stats.lastDuration.load(), stats.frames.load(), stats.bytes.load(), stats.batches.load());
+  }
+  if (this->rawUartUdpListener_ && this->rawUartUdpListener_->getPipeline()) {
+    FrameRing *pipeline = this->rawUartUdpListener_->getPipeline();
+    ESP_LOGCONFIG(TAG, "  Pipeline: ring %u bytes, UART task on core %s, network task on core %s",
+                  pipeline->getSize(), core_name(this->radioModuleConnector_->getCore()),
+                  core_name(this->rawUartUdpListener_->getPipelineCore()));
+    ESP_LOGCONFIG(TAG, "    high-water mark %u bytes, %u used", pipeline->getHighWaterMark(), pipeline->getUsed());
+  }
+  if (this->tx_scheduler_) {
+    ESP_LOGCONFIG(TAG, "  TX scheduler: aging time %u us, bulk from %u bytes", this->tx_scheduler_->getAgingTime(),
+                  this->tx_scheduler_->getBulkThreshold());
+    for (int tx_class = 0; tx_class < TX_CLASSES; tx_class++) {
+      const tx_class_statistics_t &stats = this->tx_scheduler_->getStatistics((tx_class_t) tx_class);
+      LatencyHistogram &queue_time = this->tx_scheduler_->getQueueTime((tx_class_t) tx_class);
+      ESP_LOGCONFIG(TAG, "    %s: %u frames, %u aged, depth %u (max %u), queued p50 %u us, p99 %u us, max %u us",
+                    TxScheduler::getClassName((tx_class_t) tx_class), stats.frames.load(), stats.aged.load(),
+                    stats.depth.load(), stats.maxDepth.load(), queue_time.getPercentile(50),
+                    queue_time.getPercentile(99), queue_time.getMax());
+    }
+  }
 
   if (this->red_) {
     ESP_LOGCONFIG(TAG, "  Red LED: Configured");
@@ -104,6 +512,7 @@ void HmRFBridge::dump_config() {
   if (this->blue_) {
     ESP_LOGCONFIG(TAG, "  Blue LED: Configured");
   }
+  ESP_LOGCONFIG(TAG, "  LED traffic blink: %s", this->led_traffic_blink_ ? "on" : "off");
 }
 
 }  // namespace esphome::hm_rf_bridge
@@ -1,22 +1,52 @@
 #pragma once
 
 #include "esphome/core/component.h"
+#include "esphome/core/preferences.h"
 #include "esphome/components/output/binary_output.h"
 #include "esphome/components/text_sensor/text_sensor.h"
 #include "esphome/components/binary_sensor/binary_sensor.h"
+#include "esphome/components/sensor/sensor.h"
 
 #ifdef USE_ESP32
 #include "radiomoduleconnector.h"
 #include "rawuartudplistener.h"
+#include "radiomoduledetector.h"
+#include "capturemirror.h"
+#include "tracelog.h"
+#include <atomic>
+#include <string>
 #include "esphome/components/uart/uart_component_esp_idf.h"
+#ifdef USE_HM_RF_BRIDGE_FLIGHT_RECORDER
+#include "flightrecorder.h"
+#include "esphome/components/web_server_base/web_server_base.h"
+#include <esp_http_server.h>
+#endif
 
 namespace esphome::hm_rf_bridge {
 
+#ifdef USE_HM_RF_BRIDGE_FLIGHT_RECORDER
+// Streams the flight recorder as pcap file in chunks, recording goes on during the download
+class FlightRecorderHandler : public AsyncWebHandler {
+ public:
+  FlightRecorderHandler(FlightRecorder *flight_recorder, std::string url)
+      : flight_recorder_(flight_recorder), url_(std::move(url)) {}
+
+  bool canHandle(AsyncWebServerRequest *request) const override;
+  void handleRequest(AsyncWebServerRequest *request) override;
+  bool isRequestHandlerTrivial() const override { return true; }
+
+ protected:
+  FlightRecorder *flight_recorder_;
+  std::string url_;
+};
+#endif
+
 class HmRFBridge : public PollingComponent {
  public:
   HmRFBridge(uart::IDFUARTComponent *uart, output::BinaryOutput *reset) : uart_(uart), reset_(reset) {}
 
   void setup() override;
+  void loop() override;
   void update() override;
   void dump_config() override;
 
@@ -31,12 +61,108 @@ class HmRFBridge : public PollingComponent {
 
   void set_connected_sensor(binary_sensor::BinarySensor *sensor) { connected_ = sensor; }
 
+  void set_uart_to_udp_frame_rate_sensor(sensor::Sensor *sensor) { uart_to_udp_frame_rate_ = sensor; }
+  void set_uart_to_udp_byte_rate_sensor(sensor::Sensor *sensor) { uart_to_udp_byte_rate_ = sensor; }
+  void set_udp_to_uart_frame_rate_sensor(sensor::Sensor *sensor) { udp_to_uart_frame_rate_ = sensor; }
+  void set_udp_to_uart_byte_rate_sensor(sensor::Sensor *sensor) { udp_to_uart_byte_rate_ = sensor; }
+  void set_keepalives_sent_sensor(sensor::Sensor *sensor) { keepalives_sent_ = sensor; }
+  void set_keepalives_received_sensor(sensor::Sensor *sensor) { keepalives_received_ = sensor; }
+  void set_dropped_oversized_sensor(sensor::Sensor *sensor) { dropped_oversized_ = sensor; }
+  void set_dropped_not_connected_sensor(sensor::Sensor *sensor) { dropped_not_connected_ = sensor; }
+  void set_dropped_crc_sensor(sensor::Sensor *sensor) { dropped_crc_ = sensor; }
+  void set_dropped_pipeline_full_sensor(sensor::Sensor *sensor) { dropped_pipeline_full_ = sensor; }
+  void set_uart_to_udp_latency_p50_sensor(sensor::Sensor *sensor) { uart_to_udp_latency_p50_ = sensor; }
+  void set_uart_to_udp_latency_p99_sensor(sensor::Sensor *sensor) { uart_to_udp_latency_p99_ = sensor; }
+  void set_uart_to_udp_latency_max_sensor(sensor::Sensor *sensor) { uart_to_udp_latency_max_ = sensor; }
+  void set_udp_to_uart_latency_p50_sensor(sensor::Sensor *sensor) { udp_to_uart_latency_p50_ = sensor; }
+  void set_udp_to_uart_latency_p99_sensor(sensor::Sensor *sensor) { udp_to_uart_latency_p99_ = sensor; }
+  void set_udp_to_uart_latency_max_sensor(sensor::Sensor *sensor) { udp_to_uart_latency_max_ = sensor; }
+
+  void reset_latency();
+
+  void set_duty_cycle(float warning_threshold) {
+    duty_cycle_enabled_ = true;
+    duty_cycle_warning_threshold_ = warning_threshold;
+  }
+  void set_duty_cycle_sensor(sensor::Sensor *sensor) { duty_cycle_ = sensor; }
+  void set_hmip_duty_cycle_sensor(sensor::Sensor *sensor) { hmip_duty_cycle_ = sensor; }
+  void set_bidcos_duty_cycle_sensor(sensor::Sensor *sensor) { bidcos_duty_cycle_ = sensor; }
+  void set_duty_cycle_warning_sensor(binary_sensor::BinarySensor *sensor) { duty_cycle_warning_ = sensor; }
+
+  void set_tx_scheduler(uint32_t aging_time, uint16_t bulk_threshold) {
+    tx_scheduler_enabled_ = true;
+    tx_scheduler_aging_time_ = aging_time;
+    tx_scheduler_bulk_threshold_ = bulk_threshold;
+  }
+  void set_control_queue_time_sensor(sensor::Sensor *sensor) { tx_queue_time_[TX_CLASS_CONTROL] = sensor; }
+  void set_interactive_queue_time_sensor(sensor::Sensor *sensor) { tx_queue_time_[TX_CLASS_INTERACTIVE] = sensor; }
+  void set_bulk_queue_time_sensor(sensor::Sensor *sensor) { tx_queue_time_[TX_CLASS_BULK] = sensor; }
+
+  void set_bulk_transfer(size_t batch_size, uint32_t idle_timeout) {
+    bulk_transfer_batch_size_ = batch_size;
+    bulk_transfer_idle_timeout_ = idle_timeout;
+  }
+  void set_bulk_transfer_sensor(binary_sensor::BinarySensor *sensor) { bulk_transfer_ = sensor; }
+
+  void set_pipeline(size_t ring_size, int8_t uart_core, int8_t network_core) {
+    pipeline_ring_size_ = ring_size;
+    pipeline_uart_core_ = uart_core;
+    pipeline_network_core_ = network_core;
+  }
+  void set_pipeline_high_water_mark_sensor(sensor::Sensor *sensor) { pipeline_high_water_mark_ = sensor; }
+  void set_single_task(bool single_task) { single_task_ = single_task; }
+
+#ifdef USE_HM_RF_BRIDGE_FLIGHT_RECORDER
+  void set_flight_recorder(uint16_t slots, uint16_t snap_length, uint32_t trigger_mask) {
+    flight_recorder_slots_ = slots;
+    flight_recorder_snap_length_ = snap_length;
+    flight_recorder_trigger_mask_ = trigger_mask;
+  }
+  void set_web_server_base(web_server_base::WebServerBase *base) { web_server_base_ = base; }
+  void freeze_flight_recorder();
+  void rearm_flight_recorder();
+#endif
+
+  void set_rx_pattern_detect(bool rx_pattern_detect) { rx_pattern_detect_ = rx_pattern_detect; }
+  void set_rx_full_threshold(uint8_t rx_full_threshold) { rx_full_threshold_ = rx_full_threshold; }
+  void set_rx_timeout(uint8_t rx_timeout) { rx_timeout_ = rx_timeout; }
+  void set_overflow_recovery(bool overflow_recovery) { overflow_recovery_ = overflow_recovery; }
+  void set_led_traffic_blink(bool led_traffic_blink) { led_traffic_blink_ = led_traffic_blink; }
+  void set_reset_hold_time(uint32_t reset_hold_time) { reset_hold_time_ = reset_hold_time; }
+  void set_reset_settle_time(uint32_t reset_settle_time) { reset_settle_time_ = reset_settle_time; }
+  void set_port(uint16_t port) { port_ = port; }
+  void set_frame_log(size_t queue_size) { frame_log_queue_size_ = queue_size; }
+  void set_trace_log(uint32_t size) { trace_log_size_ = size; }
+  void set_detection_cache(bool detection_cache) { detection_cache_ = detection_cache; }
+  void set_capture_mirror(const std::string &host, uint16_t port, size_t queue_size) {
+    capture_mirror_host_ = host;
+    capture_mirror_port_ = port;
+    capture_mirror_queue_size_ = queue_size;
+  }
+
   float get_setup_priority() const override { return esphome::setup_priority::ETHERNET; }
 
  protected:
+  static void detection_task_(void *parameter);
+  void publish_statistics_();
+  void publish_duty_cycle_();
+  void publish_latency_(LatencyHistogram &histogram, sensor::Sensor *p50, sensor::Sensor *p99, sensor::Sensor *max);
+
   uart::IDFUARTComponent *uart_;
   RadioModuleConnector *radioModuleConnector_{nullptr};
   RawUartUdpListener *rawUartUdpListener_{nullptr};
+#ifdef USE_HM_RF_BRIDGE_STATIC_ALLOCATION
+  // the bridge core is constructed in place, so its memory is part of the component
+  alignas(RadioModuleConnector) uint8_t radio_module_connector_storage_[sizeof(RadioModuleConnector)];
+  alignas(RawUartUdpListener) uint8_t raw_uart_udp_listener_storage_[sizeof(RawUartUdpListener)];
+#endif
+  RadioModuleDetector radio_module_detector_;
+  std::atomic<bool> detection_finished_{false};
+  bool detection_cache_{false};
+  bool detection_cached_{false};
+  radio_module_info_t cached_info_{};
+  ESPPreferenceObject detection_pref_;
+  LoggingFrameTap *frame_log_{nullptr};
   output::BinaryOutput *reset_;
   output::BinaryOutput *red_{nullptr};
   output::BinaryOutput *green_{nullptr};
@@ -46,6 +172,70 @@ class HmRFBridge : public PollingComponent {
   text_sensor::TextSensor *firmware_sensor_{nullptr};
   text_sensor::TextSensor *serial_sensor_{nullptr};
   text_sensor::TextSensor *SGTIN_sensor_{nullptr};
+  sensor::Sensor *uart_to_udp_frame_rate_{nullptr};
+  sensor::Sensor *uart_to_udp_byte_rate_{nullptr};
+  sensor::Sensor *udp_to_uart_frame_rate_{nullptr};
+  sensor::Sensor *udp_to_uart_byte_rate_{nullptr};
+  sensor::Sensor *keepalives_sent_{nullptr};
+  sensor::Sensor *keepalives_received_{nullptr};
+  sensor::Sensor *dropped_oversized_{nullptr};
+  sensor::Sensor *dropped_not_connected_{nullptr};
+  sensor::Sensor *dropped_crc_{nullptr};
+  sensor::Sensor *dropped_pipeline_full_{nullptr};
+  sensor::Sensor *uart_to_udp_latency_p50_{nullptr};
+  sensor::Sensor *uart_to_udp_latency_p99_{nullptr};
+  sensor::Sensor *uart_to_udp_latency_max_{nullptr};
+  sensor::Sensor *udp_to_uart_latency_p50_{nullptr};
+  sensor::Sensor *udp_to_uart_latency_p99_{nullptr};
+  sensor::Sensor *udp_to_uart_latency_max_{nullptr};
+  bool duty_cycle_enabled_{false};
+  float duty_cycle_warning_threshold_{80.0f};
+  bool duty_cycle_warning_active_{false};
+  DutyCycleEstimator *duty_cycle_estimator_{nullptr};
+  sensor::Sensor *duty_cycle_{nullptr};
+  sensor::Sensor *hmip_duty_cycle_{nullptr};
+  sensor::Sensor *bidcos_duty_cycle_{nullptr};
+  binary_sensor::BinarySensor *duty_cycle_warning_{nullptr};
+  bool tx_scheduler_enabled_{false};
+  uint32_t tx_scheduler_aging_time_{TX_SCHEDULER_DEFAULT_AGING_TIME};
+  uint16_t tx_scheduler_bulk_threshold_{TX_SCHEDULER_DEFAULT_BULK_THRESHOLD};
+  TxScheduler *tx_scheduler_{nullptr};
+  sensor::Sensor *tx_queue_time_[TX_CLASSES]{};
+  size_t bulk_transfer_batch_size_{0};
+  uint32_t bulk_transfer_idle_timeout_{BULK_TRANSFER_DEFAULT_IDLE_TIMEOUT};
+  binary_sensor::BinarySensor *bulk_transfer_{nullptr};
+  size_t pipeline_ring_size_{0};
+  int8_t pipeline_uart_core_{1};
+  int8_t pipeline_network_core_{0};
+  sensor::Sensor *pipeline_high_water_mark_{nullptr};
+  bool single_task_{false};
+  uint32_t last_statistics_time_{0};
+  uint32_t last_frames_to_udp_{0};
+  uint32_t last_bytes_to_udp_{0};
+  uint32_t last_frames_to_uart_{0};
+  uint32_t last_bytes_to_uart_{0};
+  bool rx_pattern_detect_{false};
+  int16_t rx_full_threshold_{-1};
+  int16_t rx_timeout_{-1};
+  bool overflow_recovery_{false};
+  bool led_traffic_blink_{false};
+  uint32_t reset_hold_time_{50};
+  uint32_t reset_settle_time_{50};
+  uint16_t port_{RAW_UART_DEFAULT_PORT};
+  size_t frame_log_queue_size_{0};
+  TraceLog *trace_log_{nullptr};
+  uint32_t trace_log_size_{0};
+  CaptureMirrorTap *capture_mirror_{nullptr};
+  std::string capture_mirror_host_;
+  uint16_t capture_mirror_port_{CAPTURE_MIRROR_DEFAULT_PORT};
+  size_t capture_mirror_queue_size_{0};
+#ifdef USE_HM_RF_BRIDGE_FLIGHT_RECORDER
+  FlightRecorder *flight_recorder_{nullptr};
+  web_server_base::WebServerBase *web_server_base_{nullptr};
+  uint16_t flight_recorder_slots_{0};
+  uint16_t flight_recorder_snap_length_{0};
+  uint32_t flight_recorder_trigger_mask_{0};
+#endif
 };
 
 }  // namespace esphome::hm_rf_bridge
@@ -70,6 +70,38 @@ bool HMFrame::TryParse(unsigned char *buffer, uint16_t len, HMFrame *frame)
     return true;
 }
 
+bool HMFrame::TryParseHeader(const unsigned char *buffer, uint16_t len, HMFrame *frame)
+{
+    // length (2), destination, counter, command
+    unsigned char header[5];
+    uint16_t headerLen = 0;
+
+    if (len < 1 || buffer[0] != 0xfd)
+        return false;
+
+    for (uint16_t i = 1; i < len && headerLen < sizeof(header); i++)
+    {
+        if (buffer[i] == 0xfc && i + 1 < len)
+            header[headerLen++] = buffer[++i] | 0x80;
+        else
+            header[headerLen++] = buffer[i];
+    }
+    if (headerLen < sizeof(header))
+        return false;
+
+    uint16_t frameLen = (header[0] << 8) | header[1];
+    if (frameLen < 3)
+        return false;
+
+    frame->data_len = frameLen - 3;
+    frame->destination = header[2];
+    frame->counter = header[3];
+    frame->command = header[4];
+    frame->data = NULL;
+
+    return true;
+}
+
 HMFrame::HMFrame() : data_len(0)
 {
 }
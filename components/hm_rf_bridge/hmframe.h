@@ -24,6 +24,8 @@ class HMFrame
 {
 public:
     static bool TryParse(unsigned char *buffer, uint16_t len, HMFrame *frame);
+    // Reads length, destination, counter and command of an escaped frame, does not check the crc and leaves data unset
+    static bool TryParseHeader(const unsigned char *buffer, uint16_t len, HMFrame *frame);
     static uint16_t crc(unsigned char *buffer, uint16_t len);
 
     HMFrame();
@@ -65,6 +67,7 @@ typedef enum
 typedef enum
 {
     HM_CMD_HMIP_GET_DEFAULT_RF_ADDR = 0x01,
+    HM_CMD_HMIP_SEND = 0x03,
     HM_CMD_HMIP_ACK = 0x06,
 } hm_cmd_hmip_t;
 
@@ -75,6 +78,10 @@ typedef enum
     HM_CMD_LLMAC_GET_DEFAULT_RF_ADDR = 0x08,
 } hm_cmd_llmac_t;
 
+// LLMAC commands shorter than a BidCoS radio frame (length, counter, flags, type, sender, receiver) configure the
+// module and are not transmitted
+#define HM_LLMAC_MIN_RADIO_FRAME_LEN 10
+
 typedef enum
 {
     HM_CMD_COMMON_IDENTIFY = 0x01,
@@ -0,0 +1,60 @@
+#include "latencyhistogram.h"
+
+LatencyHistogram::LatencyHistogram() { reset(); }
+
+void LatencyHistogram::record(int64_t latency) {
+  uint32_t value = latency < 0 ? 0 : (latency > UINT32_MAX ? UINT32_MAX : (uint32_t) latency);
+
+  int bucket = value ? 32 - __builtin_clz(value) : 0;
+  if (bucket >= LATENCY_HISTOGRAM_BUCKETS)
+    bucket = LATENCY_HISTOGRAM_BUCKETS - 1;
+  atomic_fetch_add_explicit(&_buckets[bucket], 1u, std::memory_order_relaxed);
+
+  uint32_t max = atomic_load_explicit(&_max, std::memory_order_relaxed);
+  while (value > max && !atomic_compare_exchange_weak_explicit(&_max, &max, value, std::memory_order_relaxed,
+                                                               std::memory_order_relaxed)) {
+  }
+}
+
+void LatencyHistogram::reset() {
+  for (int i = 0; i < LATENCY_HISTOGRAM_BUCKETS; i++)
+    atomic_store_explicit(&_buckets[i], 0u, std::memory_order_relaxed);
+  atomic_store_explicit(&_max, 0u, std::memory_order_relaxed);
+}
+
+uint32_t LatencyHistogram::getCount() {
+  uint32_t count = 0;
+  for (int i = 0; i < LATENCY_HISTOGRAM_BUCKETS; i++)
+    count += atomic_load_explicit(&_buckets[i], std::memory_order_relaxed);
+  return count;
+}
+
+uint32_t LatencyHistogram::getPercentile(uint8_t percentile) {
+  uint32_t counts[LATENCY_HISTOGRAM_BUCKETS];
+  uint32_t total = 0;
+  for (int i = 0; i < LATENCY_HISTOGRAM_BUCKETS; i++) {
+    counts[i] = atomic_load_explicit(&_buckets[i], std::memory_order_relaxed);
+    total += counts[i];
+  }
+  if (!total)
+    return 0;
+
+  uint32_t rank = ((uint64_t) total * percentile + 99) / 100;
+  if (!rank)
+    rank = 1;
+
+  uint32_t max = getMax();
+  uint32_t seen = 0;
+  for (int i = 0; i < LATENCY_HISTOGRAM_BUCKETS; i++) {
+    if (seen + counts[i] < rank) {
+      seen += counts[i];
+      continue;
+    }
+
+    uint32_t lower = i ? 1u << (i - 1) : 0;
+    uint32_t upper = (i == LATENCY_HISTOGRAM_BUCKETS - 1) ? max : (1u << i) - 1;
+    uint32_t value = lower + (uint64_t) (upper - lower) * (rank - seen) / counts[i];
+    return value < max ? value : max;
+  }
+  return max;
+}
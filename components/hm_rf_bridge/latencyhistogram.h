@@ -0,0 +1,25 @@
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+
+#define LATENCY_HISTOGRAM_BUCKETS 24  // bucket n holds values below 2^n us, the last one everything above 4 s
+
+// Lock-free log2 histogram of latencies in microseconds. record() is called from the bridge tasks, the percentiles
+// are evaluated from the ESPHome loop.
+class LatencyHistogram {
+ private:
+  std::atomic<uint32_t> _buckets[LATENCY_HISTOGRAM_BUCKETS];
+  std::atomic<uint32_t> _max;
+
+ public:
+  LatencyHistogram();
+
+  void record(int64_t latency);
+  void reset();
+
+  uint32_t getCount();
+  uint32_t getMax() { return atomic_load_explicit(&_max, std::memory_order_relaxed); }
+  // Estimated by linear interpolation inside the matching bucket, 0 if nothing was recorded
+  uint32_t getPercentile(uint8_t percentile);
+};
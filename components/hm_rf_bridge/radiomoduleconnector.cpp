@@ -16,102 +16,542 @@
  *  limitations under the License.
  */
 
+#include <stdio.h>
 #include <stdlib.h>
+#include <new>
 #include "radiomoduleconnector.h"
 #include "hmframe.h"
 #include "esphome/core/log.h"
 #include "esphome/core/helpers.h"
 #include "radiomoduledetector_utils.h"
 
-static const char *TAG = "RadioModuleConnector";
+#define FRAME_DELIMITER 0xfd
+#define PATTERN_QUEUE_SIZE 16
+// 115200 baud transfers ~11.5 bytes per ms, allow some slack on top
+#define PATTERN_READ_TIMEOUT(__len) pdMS_TO_TICKS(5 + (__len) / 11)
+
+#define LED_RED 1
+#define LED_GREEN 2
+#define LED_BLUE 4
+
+#define RESET_IDLE_BIT BIT0
 
 void serialQueueHandlerTask(void *parameter) { ((RadioModuleConnector *) parameter)->_serialQueueHandler(); }
 
+void resetTimerCallback(void *parameter) { ((RadioModuleConnector *) parameter)->_resetTimerHandler(); }
+
 RadioModuleConnector::RadioModuleConnector(BinaryOutput *reset, QueueHandle_t *uart_queue, uart_port_t uart_num,
                                            size_t buffer_size)
     : _reset(reset), _uart_queue(*uart_queue), _uart_num(uart_num), _buffer_size(buffer_size) {
   using namespace std::placeholders;
+  snprintf(_tag, sizeof(_tag), "RadioModuleConnector.%d", (int) uart_num);
+
+#ifdef USE_HM_RF_BRIDGE_STATIC_ALLOCATION
+  _streamParser =
+      new (_streamParserStorage) StreamParser(false, std::bind(&RadioModuleConnector::_handleFrame, this, _1, _2));
+  _tapUpdateMutex = xSemaphoreCreateMutexStatic(&_tapUpdateMutexBuffer);
+  _resetMutex = xSemaphoreCreateMutexStatic(&_resetMutexBuffer);
+  _resetEvents = xEventGroupCreateStatic(&_resetEventsBuffer);
+
+  if (_buffer_size > sizeof(_readBuffer)) {
+    ESP_LOGE(_tag, "UART RX buffer of %u bytes exceeds the static read buffer of %u bytes", (unsigned) _buffer_size,
+             (unsigned) sizeof(_readBuffer));
+    _buffer_size = sizeof(_readBuffer);
+  }
+#else
   _streamParser = new StreamParser(false, std::bind(&RadioModuleConnector::_handleFrame, this, _1, _2));
+  _tapUpdateMutex = xSemaphoreCreateMutex();
+  _resetMutex = xSemaphoreCreateMutex();
+  _resetEvents = xEventGroupCreate();
+#endif
+  xEventGroupSetBits(_resetEvents, RESET_IDLE_BIT);
+
+  esp_timer_create_args_t timerArgs = {};
+  timerArgs.callback = resetTimerCallback;
+  timerArgs.arg = this;
+  timerArgs.dispatch_method = ESP_TIMER_TASK;
+  timerArgs.name = "hm_reset";
+  esp_timer_create(&timerArgs, &_resetTimer);
 }
 
-void RadioModuleConnector::start() {
-  xTaskCreate(serialQueueHandlerTask, "RadioModuleConnector_UART_QueueHandler", 4096, this, 15, &_tHandle);
-  resetModule();
+RadioModuleConnector::~RadioModuleConnector() {
+  esp_timer_stop(_resetTimer);
+  esp_timer_delete(_resetTimer);
+  vEventGroupDelete(_resetEvents);
+  vSemaphoreDelete(_tapUpdateMutex);
+  vSemaphoreDelete(_resetMutex);
+  delete atomic_load(&_tapList);
+#ifdef USE_HM_RF_BRIDGE_STATIC_ALLOCATION
+  _streamParser->~StreamParser();
+#else
+  delete _streamParser;
+#endif
+}
+
+void RadioModuleConnector::start(bool reset) {
+  if (_rxFullThreshold >= 0)
+    uart_set_rx_full_threshold(_uart_num, _rxFullThreshold);
+  if (_rxTimeout >= 0)
+    uart_set_rx_timeout(_uart_num, _rxTimeout);
+  if (_patternDetect) {
+    uart_enable_pattern_det_baud_intr(_uart_num, FRAME_DELIMITER, 1, 9, 0, 0);
+    uart_pattern_queue_reset(_uart_num, PATTERN_QUEUE_SIZE);
+  }
+  if (_singleTask && !_createQueueSet())
+    ESP_LOGE(_tag, "Could not allocate the queue set, the UDP side keeps a task of its own");
+#ifdef USE_HM_RF_BRIDGE_STATIC_ALLOCATION
+  _tHandle = xTaskCreateStaticPinnedToCore(serialQueueHandlerTask, "RadioModuleConnector_UART_QueueHandler",
+                                           RADIO_MODULE_CONNECTOR_STACK_SIZE, this, 15, _taskStack, &_taskBuffer, _core);
+#else
+  xTaskCreatePinnedToCore(serialQueueHandlerTask, "RadioModuleConnector_UART_QueueHandler",
+                          RADIO_MODULE_CONNECTOR_STACK_SIZE, this, 15, &_tHandle, _core);
+#endif
+  if (reset)
+    resetModule();
 }
 
 void RadioModuleConnector::stop() {
   if (_tHandle) {
     vTaskDelete(_tHandle);
     _tHandle = nullptr;
+    if (_patternDetect)
+      uart_disable_pattern_det_intr(_uart_num);
+    if (_queueSet) {
+      xQueueReset(_uart_queue);
+      xQueueRemoveFromSet(_uart_queue, _queueSet);
+      vQueueDelete(_queueSet);
+      _queueSet = nullptr;
+    }
     resetModule();
+    waitResetComplete(portMAX_DELAY);
   }
 }
 
+bool RadioModuleConnector::_createQueueSet() {
+  UBaseType_t uartQueueLength = uxQueueMessagesWaiting(_uart_queue) + uxQueueSpacesAvailable(_uart_queue);
+  // a reset UART queue leaves its handles in the set until they were selected, so there is room for it twice
+  _queueSet = xQueueCreateSet(2 * uartQueueLength + EVENT_LOOP_QUEUE_LENGTH);
+  if (!_queueSet)
+    return false;
+
+  // only an empty queue can join a set, the UART task flushes the input anyway
+  uart_flush_input(_uart_num);
+  do {
+    xQueueReset(_uart_queue);
+  } while (xQueueAddToSet(_uart_queue, _queueSet) != pdPASS);
+  return true;
+}
+
+bool RadioModuleConnector::attachEventLoop(QueueHandle_t queue, EventLoopHandler *handler) {
+  if (!_queueSet || uxQueueSpacesAvailable(queue) > EVENT_LOOP_QUEUE_LENGTH)
+    return false;
+
+  atomic_store(&_eventLoopHandler, handler);
+  if (xQueueAddToSet(queue, _queueSet) != pdPASS) {
+    detachEventLoop(queue);
+    return false;
+  }
+  return true;
+}
+
+void RadioModuleConnector::detachEventLoop(QueueHandle_t queue) {
+  atomic_store(&_eventLoopHandler, (EventLoopHandler *) nullptr);
+  while (atomic_load(&_eventLoopBusy))
+    vTaskDelay(1);
+  // items left in the queue keep it in the set, their handles are skipped by the UART task
+  if (_queueSet)
+    xQueueRemoveFromSet(queue, _queueSet);
+}
+
 void RadioModuleConnector::setFrameHandler(FrameHandler *frameHandler, bool decodeEscaped) {
   atomic_store(&_frameHandler, frameHandler);
   _streamParser->setDecodeEscaped(decodeEscaped);
 }
 
-void RadioModuleConnector::resetModule() {
+bool RadioModuleConnector::addFrameTap(FrameTap *tap) {
+  frame_tap_list_t *tapList = atomic_load(&_tapList);
+  if (tapList && tapList->count >= MAX_FRAME_TAPS)
+    return false;
+
+  _updateFrameTaps(tap, nullptr);
+  return true;
+}
+
+void RadioModuleConnector::removeFrameTap(FrameTap *tap) { _updateFrameTaps(nullptr, tap); }
+
+void RadioModuleConnector::_updateFrameTaps(FrameTap *add, FrameTap *remove) {
+  xSemaphoreTake(_tapUpdateMutex, portMAX_DELAY);
+
+  frame_tap_list_t *oldList = atomic_load(&_tapList);
+  frame_tap_list_t *newList = new frame_tap_list_t{};
+
+  if (oldList) {
+    for (uint8_t i = 0; i < oldList->count; i++) {
+      if (oldList->taps[i] != remove)
+        newList->taps[newList->count++] = oldList->taps[i];
+    }
+  }
+  if (add && newList->count < MAX_FRAME_TAPS)
+    newList->taps[newList->count++] = add;
+
+  if (!newList->count) {
+    delete newList;
+    newList = nullptr;
+  }
+
+  atomic_store(&_tapList, newList);
+
+  // wait for the bridge tasks to leave the old list before freeing it
+  while (atomic_load(&_tapReaders) != 0)
+    vTaskDelay(1);
+  delete oldList;
+
+  xSemaphoreGive(_tapUpdateMutex);
+}
+
+void RadioModuleConnector::resetModule(std::function<void()> onComplete) {
+  xSemaphoreTake(_resetMutex, portMAX_DELAY);
+  esp_timer_stop(_resetTimer);
+
+  xEventGroupClearBits(_resetEvents, RESET_IDLE_BIT);
+  atomic_store(&_awaitFirstFrame, false);
+  _resetCallback = std::move(onComplete);
+  atomic_store(&_resetState, (int) RESET_STATE_ASSERTED);
   _reset->turn_on();
-  vTaskDelay(50 / portTICK_PERIOD_MS);
-  _reset->turn_off();
-  vTaskDelay(50 / portTICK_PERIOD_MS);
+
+  esp_timer_start_once(_resetTimer, _resetHoldTime * 1000ULL);
+  xSemaphoreGive(_resetMutex);
+}
+
+void RadioModuleConnector::_resetTimerHandler() {
+  std::function<void()> callback;
+  xSemaphoreTake(_resetMutex, portMAX_DELAY);
+  // a reset started while this call waited for the lock restarted the timer, its hold time counts from then
+  if (esp_timer_is_active(_resetTimer)) {
+    xSemaphoreGive(_resetMutex);
+    return;
+  }
+
+  switch (atomic_load(&_resetState)) {
+    case RESET_STATE_ASSERTED:
+      _reset->turn_off();
+      _resetReleasedTime = esp_timer_get_time();
+      // measured from the release, a module that is up before the settle time ends shows it can be shortened
+      atomic_store(&_awaitFirstFrame, true);
+      atomic_store(&_resetState, (int) RESET_STATE_SETTLING);
+      esp_timer_start_once(_resetTimer, _resetSettleTime * 1000ULL);
+      break;
+
+    case RESET_STATE_SETTLING:
+      callback = std::move(_resetCallback);
+      _resetCallback = nullptr;
+      atomic_store(&_resetState, (int) RESET_STATE_IDLE);
+      xEventGroupSetBits(_resetEvents, RESET_IDLE_BIT);
+      break;
+
+    default:
+      break;
+  }
+  xSemaphoreGive(_resetMutex);
+
+  // outside the lock, the callback may start the next reset
+  if (callback)
+    callback();
 }
 
-void RadioModuleConnector::sendFrame(unsigned char *buffer, uint16_t len) {
-  uart_write_bytes(_uart_num, (const char *) buffer, len);
+bool RadioModuleConnector::waitResetComplete(TickType_t timeout) {
+  return xEventGroupWaitBits(_resetEvents, RESET_IDLE_BIT, pdFALSE, pdTRUE, timeout) & RESET_IDLE_BIT;
+}
+
+void RadioModuleConnector::sendFrame(unsigned char *buffer, uint16_t len) { sendFrames(buffer, &len, 1); }
+
+void RadioModuleConnector::sendFrames(unsigned char *buffer, const uint16_t *lengths, uint8_t count) {
+  uint16_t offset = 0;
+
+  if (isResetting()) {
+    // the module does not listen while it is held in reset
+    if (_flightRecorder) {
+      for (uint8_t i = 0; i < count; offset += lengths[i++])
+        _flightRecorder->record(FRAME_DIRECTION_TX, buffer + offset, lengths[i], FLIGHT_RECORDER_FLAG_DROPPED);
+    }
+    return;
+  }
+
+  int64_t now = _dutyCycleEstimator ? esp_timer_get_time() : 0;
+  for (uint8_t i = 0; i < count; offset += lengths[i++]) {
+    if (_flightRecorder)
+      _flightRecorder->record(FRAME_DIRECTION_TX, buffer + offset, lengths[i]);
+    if (_dutyCycleEstimator)
+      _dutyCycleEstimator->record(buffer + offset, lengths[i], now);
+  }
+
+  atomic_fetch_add_explicit(&_trafficCounter, (uint32_t) count, std::memory_order_relaxed);
+  uart_write_bytes(_uart_num, (const char *) buffer, offset);
+
+  offset = 0;
+  for (uint8_t i = 0; i < count; offset += lengths[i++])
+    _offerToTaps(FRAME_DIRECTION_TX, buffer + offset, lengths[i]);
 }
 
 void RadioModuleConnector::_serialQueueHandler() {
   uart_event_t event;
+#ifdef USE_HM_RF_BRIDGE_STATIC_ALLOCATION
+  uint8_t *buffer = _readBuffer;
+#else
   uint8_t *buffer = (uint8_t *) malloc(this->_buffer_size);
+#endif
 
   uart_flush_input(_uart_num);
 
+  TickType_t timeout = portMAX_DELAY;
   for (;;) {
-    if (xQueueReceive(_uart_queue, (void *) &event, (TickType_t) portMAX_DELAY)) {
-      switch (event.type) {
-        case UART_DATA:
-          uart_read_bytes(_uart_num, buffer, event.size, portMAX_DELAY);
-          _streamParser->append(buffer, event.size);
-          break;
-        case UART_FIFO_OVF:
-        case UART_BUFFER_FULL:
-          uart_flush_input(_uart_num);
-          xQueueReset(_uart_queue);
-          _streamParser->flush();
-          break;
-        case UART_BREAK:
-        case UART_PARITY_ERR:
-        case UART_FRAME_ERR:
-          _streamParser->flush();
-          break;
-        default:
-          break;
-      }
+    if (!_queueSet) {
+      if (xQueueReceive(_uart_queue, (void *) &event, (TickType_t) portMAX_DELAY))
+        _handleUartEvent(&event, buffer);
+      continue;
+    }
+
+    // single task mode, the UDP side is served between the UART events
+    QueueSetMemberHandle_t member = xQueueSelectFromSet(_queueSet, timeout);
+    if (member == _uart_queue) {
+      // the handle of a reset queue may still be in the set
+      if (xQueueReceive(_uart_queue, (void *) &event, 0))
+        _handleUartEvent(&event, buffer);
     }
+
+    // marked busy first, so detachEventLoop() either sees the task in the handler or the task sees no handler
+    atomic_store(&_eventLoopBusy, true);
+    EventLoopHandler *handler = atomic_load(&_eventLoopHandler);
+    if (handler) {
+      if (member && member != _uart_queue)
+        handler->handleQueueItem();
+      timeout = handler->handleDeadlines();
+    } else {
+      timeout = portMAX_DELAY;
+    }
+    atomic_store(&_eventLoopBusy, false);
   }
 
+#ifndef USE_HM_RF_BRIDGE_STATIC_ALLOCATION
   free(buffer);
   buffer = NULL;
+#endif
   vTaskDelete(NULL);
 }
 
+void RadioModuleConnector::_handleUartEvent(uart_event_t *event, uint8_t *buffer) {
+  _streamParser->setReceiveTime(esp_timer_get_time());
+
+  switch (event->type) {
+    case UART_DATA:
+      if (_patternDetect) {
+        // frames are pulled on UART_PATTERN_DET, only pick up what is still left in the ring buffer
+        _readBuffered(buffer, event->size);
+      } else if (_overflowRecovery) {
+        // exactly the bytes of this event, so the read position reaches a FIFO gap when its UART_FIFO_OVF is handled
+        _readEvent(buffer, event->size);
+      } else {
+        // the event never exceeds the ring buffer, only a too small static read buffer limits it
+        size_t len = event->size < _buffer_size ? event->size : _buffer_size;
+        uart_read_bytes(_uart_num, buffer, len, portMAX_DELAY);
+        _streamParser->append(buffer, len);
+      }
+      break;
+    case UART_PATTERN_DET:
+      _readPatternFrame(buffer);
+      break;
+    case UART_FIFO_OVF:
+    case UART_BUFFER_FULL:
+      if (_overflowRecovery) {
+        _recoverOverflow(buffer, event);
+        break;
+      }
+      uart_flush_input(_uart_num);
+      xQueueReset(_uart_queue);
+      _streamParser->flush();
+      if (_flightRecorder)
+        _flightRecorder->trigger(FLIGHT_RECORDER_TRIGGER_OVERFLOW);
+      break;
+    case UART_BREAK:
+    case UART_PARITY_ERR:
+    case UART_FRAME_ERR:
+      _streamParser->flush();
+      break;
+    default:
+      break;
+  }
+
+  if (_flightRecorder && _streamParser->getResyncCount() != _resyncCount) {
+    _resyncCount = _streamParser->getResyncCount();
+    _flightRecorder->trigger(FLIGHT_RECORDER_TRIGGER_PARSER_RESYNC);
+  }
+}
+
+void RadioModuleConnector::_readBuffered(uint8_t *buffer, size_t len) {
+  size_t available = 0;
+  uart_get_buffered_data_len(_uart_num, &available);
+  if (available < len)
+    len = available;
+  if (len > _buffer_size)
+    len = _buffer_size;
+
+  if (len) {
+    int read = uart_read_bytes(_uart_num, buffer, len, 0);
+    if (read > 0)
+      _appendReceived(buffer, read);
+  }
+}
+
+void RadioModuleConnector::_readPatternFrame(uint8_t *buffer) {
+  int pos = uart_pattern_pop_pos(_uart_num);
+
+  if (pos < 0) {
+    // delimiter already consumed by an earlier read or position queue overflowed
+    _readBuffered(buffer, _buffer_size);
+    return;
+  }
+
+  // tail of the previous frame, the delimiter and what already arrived of the new frame are in the ring buffer
+  size_t available = 0;
+  uart_get_buffered_data_len(_uart_num, &available);
+  size_t len = available > (size_t) pos ? available : pos + 1;
+  if (len > _buffer_size)
+    len = _buffer_size;
+
+  int read = uart_read_bytes(_uart_num, buffer, len, 0);
+  if (read > 0)
+    _appendReceived(buffer, read);
+
+  // the rest of the announced frame is still on the wire, it is waited for once for as long as it takes to receive
+  uint16_t remaining = _streamParser->remaining();
+  if (remaining > _buffer_size)
+    remaining = _buffer_size;
+  if (remaining) {
+    read = uart_read_bytes(_uart_num, buffer, remaining, PATTERN_READ_TIMEOUT(remaining));
+    if (read > 0)
+      _appendReceived(buffer, read);
+    // anything still missing, like a length field that was not received yet, comes with the next UART_DATA event
+  }
+}
+
+void RadioModuleConnector::_readEvent(uint8_t *buffer, size_t len) {
+  // the bytes of a UART_DATA event are in the ring buffer already
+  while (len) {
+    int read = uart_read_bytes(_uart_num, buffer, len < _buffer_size ? len : _buffer_size, 0);
+    if (read <= 0)
+      break;
+    _appendReceived(buffer, read);
+    len -= read;
+  }
+}
+
+void RadioModuleConnector::_appendReceived(uint8_t *buffer, size_t len) {
+  if (_overflowResync) {
+    // the bytes behind a FIFO gap belong to a frame whose start was lost
+    size_t skipped = 0;
+    while (skipped < len && buffer[skipped] != FRAME_DELIMITER)
+      skipped++;
+    atomic_fetch_add(&_overflowBytesLost, (uint32_t) skipped);
+    _overflowResync = skipped == len;
+    buffer += skipped;
+    len -= skipped;
+  }
+
+  if (len)
+    _streamParser->append(buffer, len);
+}
+
+void RadioModuleConnector::_recoverOverflow(uint8_t *buffer, uart_event_t *event) {
+  atomic_fetch_add(&_overflowCount, 1u);
+
+  // on UART_BUFFER_FULL the driver holds back the FIFO until there is room again, nothing is lost and the event
+  // carries the held back bytes like a UART_DATA event
+  if (event->type == UART_BUFFER_FULL) {
+    _readEvent(buffer, event->size);
+    return;
+  }
+
+  // on UART_FIFO_OVF the driver reset the FIFO, all bytes before the gap were read with their UART_DATA events and
+  // the ring buffer only holds bytes received after it: the frame spanning the gap is dropped and the following
+  // bytes are skipped up to the next 0xfd
+  uint16_t discarded = _streamParser->flush();
+  atomic_fetch_add(&_overflowBytesLost, (uint32_t) discarded);
+  atomic_fetch_add(&_overflowFramesLost, 1u);
+  _overflowResync = true;
+
+  if (_flightRecorder)
+    _flightRecorder->trigger(FLIGHT_RECORDER_TRIGGER_OVERFLOW);
+
+  trace_logw(_traceLog, _tag, "UART FIFO overflow, discarded %u bytes of the current frame", discarded);
+}
+
 void RadioModuleConnector::setLED(bool red, bool green, bool blue) {
-  ESP_LOGD(TAG, "red : %s green: %s blue:%s", red ? "on" : "off", green ? "on" : "off", blue ? "on" : "off");
+  atomic_store(&_ledState, (red ? LED_RED : 0u) | (green ? LED_GREEN : 0u) | (blue ? LED_BLUE : 0u));
+}
+
+void RadioModuleConnector::updateLED() {
+  uint32_t state = atomic_load(&_ledState);
+  uint32_t output = state;
+
+  if (state != _appliedLedState) {
+    ESP_LOGD(_tag, "red : %s green: %s blue:%s", state & LED_RED ? "on" : "off", state & LED_GREEN ? "on" : "off",
+             state & LED_BLUE ? "on" : "off");
+  }
+
+  if (_trafficBlink) {
+    // switch the LEDs off for one period whenever frames passed since the last update
+    uint32_t trafficCounter = atomic_load_explicit(&_trafficCounter, std::memory_order_relaxed);
+    if (trafficCounter != _appliedTrafficCounter) {
+      _appliedTrafficCounter = trafficCounter;
+      output = 0;
+    }
+  }
+
+  _appliedLedState = state;
+
+  if (output == _appliedLedOutput)
+    return;
+  _appliedLedOutput = output;
+
   if (_redLED)
-    _redLED->set_state(red);
+    _redLED->set_state(output & LED_RED);
   if (_greenLED)
-    _greenLED->set_state(green);
+    _greenLED->set_state(output & LED_GREEN);
   if (_blueLED)
-    _blueLED->set_state(blue);
+    _blueLED->set_state(output & LED_BLUE);
 }
 
 void RadioModuleConnector::_handleFrame(unsigned char *buffer, uint16_t len) {
+  // the first frame after the release is measured even if it is dropped because the module is still settling
+  int64_t receiveTime = _streamParser->getFrameReceiveTime();
+  if (atomic_load(&_awaitFirstFrame) && receiveTime >= _resetReleasedTime &&
+      atomic_exchange(&_awaitFirstFrame, false)) {
+    uint32_t resetToFirstFrame = receiveTime - _resetReleasedTime;
+    atomic_store(&_resetToFirstFrameTime, resetToFirstFrame);
+    if (isResetting()) {
+      trace_logd(_traceLog, _tag, "First frame %u us after reset release, dropped while settling", resetToFirstFrame);
+    } else {
+      trace_logd(_traceLog, _tag, "First frame %u us after reset release", resetToFirstFrame);
+    }
+  }
+
+  if (isResetting()) {
+    // garbage or boot messages while the reset line is toggled
+    atomic_fetch_add(&_framesDroppedInReset, 1u);
+    if (_flightRecorder)
+      _flightRecorder->record(FRAME_DIRECTION_RX, buffer, len, FLIGHT_RECORDER_FLAG_DROPPED);
+    return;
+  }
+
+  if (_flightRecorder)
+    _flightRecorder->record(FRAME_DIRECTION_RX, buffer, len);
+
   FrameHandler *frameHandler = (FrameHandler *) atomic_load(&_frameHandler);
+  atomic_fetch_add_explicit(&_trafficCounter, 1u, std::memory_order_relaxed);
 
   if (frameHandler) {
     frameHandler->handleFrame(buffer, len);
   }
+
+  _offerToTaps(FRAME_DIRECTION_RX, buffer, len);
 }
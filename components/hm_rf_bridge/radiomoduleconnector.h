@@ -21,8 +21,15 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/queue.h"
+#include "freertos/event_groups.h"
 #include "driver/uart.h"
+#include <esp_timer.h>
+#include "freertos/semphr.h"
 #include "streamparser.h"
+#include "frametap.h"
+#include "flightrecorder.h"
+#include "dutycycleestimator.h"
+#include "tracelog.h"
 #include <atomic>
 #define _Atomic(X) std::atomic<X>
 #include "esphome/components/output/binary_output.h"
@@ -32,9 +39,35 @@ class FrameHandler {
   virtual void handleFrame(unsigned char *buffer, uint16_t len) = 0;
 };
 
+// Work the UART task does next to the UART events in the single task mode
+class EventLoopHandler {
+ public:
+  // An item is waiting in the queue attached with RadioModuleConnector::attachEventLoop()
+  virtual void handleQueueItem() = 0;
+  // Called after every wake-up, returns the ticks until the next deadline
+  virtual TickType_t handleDeadlines() = 0;
+};
+
 using BinaryOutput = esphome::output::BinaryOutput;
 using LED = BinaryOutput;
 
+#define MAX_FRAME_TAPS 4
+#define LOG_TAG_SIZE 32  // log tags name the instance, several bridges may run on one node
+
+#define RADIO_MODULE_CONNECTOR_STACK_SIZE 4096
+#define EVENT_LOOP_QUEUE_LENGTH 32  // longest queue that can be attached to the UART task
+
+#if defined(USE_HM_RF_BRIDGE_STATIC_ALLOCATION) && !defined(HM_RF_BRIDGE_STATIC_RX_BUFFER_SIZE)
+#define HM_RF_BRIDGE_STATIC_RX_BUFFER_SIZE 256  // generated from the rx_buffer_size of the UART
+#endif
+
+typedef struct {
+  uint8_t count;
+  FrameTap *taps[MAX_FRAME_TAPS];
+} frame_tap_list_t;
+
+typedef enum { RESET_STATE_IDLE, RESET_STATE_ASSERTED, RESET_STATE_SETTLING } reset_state_t;
+
 class RadioModuleConnector {
  private:
   LED *_redLED{nullptr};
@@ -45,27 +78,175 @@ class RadioModuleConnector {
   std::atomic<FrameHandler *> _frameHandler = ATOMIC_VAR_INIT(0);
   QueueHandle_t _uart_queue;
   uart_port_t _uart_num;
+  char _tag[LOG_TAG_SIZE];
   TaskHandle_t _tHandle{nullptr};
+  BaseType_t _core{tskNO_AFFINITY};
+  bool _singleTask{false};
+  QueueSetHandle_t _queueSet{nullptr};
+  std::atomic<EventLoopHandler *> _eventLoopHandler{nullptr};
+  std::atomic<bool> _eventLoopBusy{false};
   uint8_t *_buffer{nullptr};
   size_t _buffer_size{0};
+  bool _patternDetect{false};
+  int _rxFullThreshold{-1};
+  int _rxTimeout{-1};
+  bool _overflowRecovery{false};
+  std::atomic<uint32_t> _overflowCount{0};
+  std::atomic<uint32_t> _overflowBytesLost{0};
+  std::atomic<uint32_t> _overflowFramesLost{0};
+  bool _overflowResync{false};  // skipping to the next 0xfd after a FIFO gap
+  std::atomic<uint32_t> _ledState{0};
+  std::atomic<uint32_t> _trafficCounter{0};
+  uint32_t _appliedLedState{0};
+  uint32_t _appliedLedOutput{UINT32_MAX};
+  uint32_t _appliedTrafficCounter{0};
+  bool _trafficBlink{false};
+  esp_timer_handle_t _resetTimer{nullptr};
+  EventGroupHandle_t _resetEvents{nullptr};
+  std::atomic<int> _resetState{RESET_STATE_IDLE};
+  std::function<void()> _resetCallback;
+  SemaphoreHandle_t _resetMutex{nullptr};  // a new reset may be started while the esp_timer task completes one
+  uint32_t _resetHoldTime{50};
+  uint32_t _resetSettleTime{50};
+  int64_t _resetReleasedTime{0};
+  std::atomic<bool> _awaitFirstFrame{false};
+  std::atomic<uint32_t> _resetToFirstFrameTime{0};
+  std::atomic<uint32_t> _framesDroppedInReset{0};
+  std::atomic<frame_tap_list_t *> _tapList{nullptr};
+  std::atomic<int> _tapReaders{0};
+  std::atomic<bool> _bulkTransfer{false};
+  SemaphoreHandle_t _tapUpdateMutex{nullptr};
+
+  FlightRecorder *_flightRecorder{nullptr};
+  DutyCycleEstimator *_dutyCycleEstimator{nullptr};
+  TraceLog *_traceLog{nullptr};
+  uint32_t _resyncCount{0};
+
+#ifdef USE_HM_RF_BRIDGE_STATIC_ALLOCATION
+  // everything the connector creates lives in the object itself
+  StaticTask_t _taskBuffer;
+  StackType_t _taskStack[RADIO_MODULE_CONNECTOR_STACK_SIZE];
+  StaticSemaphore_t _tapUpdateMutexBuffer;
+  StaticSemaphore_t _resetMutexBuffer;
+  StaticEventGroup_t _resetEventsBuffer;
+  alignas(StreamParser) uint8_t _streamParserStorage[sizeof(StreamParser)];
+  uint8_t _readBuffer[HM_RF_BRIDGE_STATIC_RX_BUFFER_SIZE];
+#endif
 
   void _handleFrame(unsigned char *buffer, uint16_t len);
+  void _handleUartEvent(uart_event_t *event, uint8_t *buffer);
+  bool _createQueueSet();
+  void _readBuffered(uint8_t *buffer, size_t len);
+  void _readPatternFrame(uint8_t *buffer);
+  void _readEvent(uint8_t *buffer, size_t len);
+  void _appendReceived(uint8_t *buffer, size_t len);
+  void _recoverOverflow(uint8_t *buffer, uart_event_t *event);
+  void _updateFrameTaps(FrameTap *add, FrameTap *remove);
+
+  inline void _offerToTaps(frame_direction_t direction, const unsigned char *buffer, uint16_t len) {
+    if (!atomic_load_explicit(&_tapList, std::memory_order_relaxed))
+      return;
+
+    // readers are counted so an updater knows when a replaced list is not in use anymore
+    atomic_fetch_add(&_tapReaders, 1);
+    frame_tap_list_t *tapList = atomic_load(&_tapList);
+    if (tapList) {
+      bool bulkTransfer = atomic_load_explicit(&_bulkTransfer, std::memory_order_relaxed);
+      for (uint8_t i = 0; i < tapList->count; i++) {
+        if (!bulkTransfer || !tapList->taps[i]->isPausedInBulkTransfer())
+          tapList->taps[i]->offer(direction, buffer, len);
+      }
+    }
+    atomic_fetch_sub(&_tapReaders, 1);
+  }
 
  public:
   RadioModuleConnector(BinaryOutput *reset, QueueHandle_t *uart_queue, uart_port_t uart_num, size_t buffer_size);
+  ~RadioModuleConnector();
 
-  void start();
+  // Starts the UART task, resetModule can be skipped if the module is known to be running already
+  void start(bool resetModule = true);
   void stop();
 
+  // Core the UART task is pinned to, tskNO_AFFINITY lets it run on any core, call before start()
+  void setCore(BaseType_t core) { _core = core < portNUM_PROCESSORS ? core : tskNO_AFFINITY; }
+  BaseType_t getCore() { return _core; }
+
+  // Lets the UART task also serve the queue and deadlines of the UDP side instead of a task of its own, saves a stack
+  // on small chips. Call before start().
+  void setSingleTask(bool singleTask) { _singleTask = singleTask; }
+  // True once start() set up the single task mode, it falls back to a UART task of its own without memory for it
+  bool isSingleTask() { return _queueSet != nullptr; }
+  // The queue has to be empty and at most EVENT_LOOP_QUEUE_LENGTH items long
+  bool attachEventLoop(QueueHandle_t queue, EventLoopHandler *handler);
+  // Returns once the UART task left the handler
+  void detachEventLoop(QueueHandle_t queue);
+
+  // Use the UART pattern detect interrupt on the 0xfd frame delimiter to pull complete frames, call before start()
+  void setPatternDetect(bool patternDetect) { _patternDetect = patternDetect; }
+
+  // RX FIFO full threshold in bytes and RX timeout in symbol times, negative keeps the driver setting
+  void setRxTuning(int rxFullThreshold, int rxTimeout) {
+    _rxFullThreshold = rxFullThreshold;
+    _rxTimeout = rxTimeout;
+  }
+
+  // Parse what is still valid on UART overflows instead of flushing the whole ring buffer
+  void setOverflowRecovery(bool overflowRecovery) { _overflowRecovery = overflowRecovery; }
+  uint32_t getOverflowCount() { return atomic_load(&_overflowCount); }
+  uint32_t getOverflowBytesLost() { return atomic_load(&_overflowBytesLost); }
+  uint32_t getOverflowFramesLost() { return atomic_load(&_overflowFramesLost); }
+
+  // Time the current frame arrived at the UART, only valid while FrameHandler::handleFrame is called
+  int64_t getFrameReceiveTime() { return _streamParser->getFrameReceiveTime(); }
+
   void setFrameHandler(FrameHandler *handler, bool decodeEscaped);
 
-  void resetModule();
+  uart_port_t getUartNum() { return _uart_num; }
+  const char *getTag() { return _tag; }
+
+  // Must be set before start()
+  void setFlightRecorder(FlightRecorder *flightRecorder) { _flightRecorder = flightRecorder; }
+  FlightRecorder *getFlightRecorder() { return _flightRecorder; }
+  // Must be set before start()
+  void setDutyCycleEstimator(DutyCycleEstimator *dutyCycleEstimator) { _dutyCycleEstimator = dutyCycleEstimator; }
+  // Warnings of the UART and UDP tasks go through the trace log if set, must be set before start()
+  void setTraceLog(TraceLog *traceLog) { _traceLog = traceLog; }
+  TraceLog *getTraceLog() { return _traceLog; }
+
+  // Taps get a copy of all frames in both directions after the primary FrameHandler, can be changed at runtime
+  bool addFrameTap(FrameTap *tap);
+  void removeFrameTap(FrameTap *tap);
+
+  // Starts the reset sequence (assert, hold, release, settle) and returns immediately. Frames are dropped until the
+  // module settled, onComplete is called from the esp_timer task afterwards.
+  void resetModule(std::function<void()> onComplete = nullptr);
+  bool waitResetComplete(TickType_t timeout);
+  bool isResetting() { return atomic_load(&_resetState) != RESET_STATE_IDLE; }
+  void setResetTimes(uint32_t holdTime, uint32_t settleTime) {
+    _resetHoldTime = holdTime;
+    _resetSettleTime = settleTime;
+  }
+  // Time from releasing the reset line until the first frame of the module was received, in us
+  uint32_t getResetToFirstFrameTime() { return atomic_load(&_resetToFirstFrameTime); }
+  uint32_t getFramesDroppedInReset() { return atomic_load(&_framesDroppedInReset); }
+  void _resetTimerHandler();
 
   void sendFrame(unsigned char *buffer, uint16_t len);
+  // Writes count escaped frames stored back to back in buffer with a single UART write
+  void sendFrames(unsigned char *buffer, const uint16_t *lengths, uint8_t count);
+
+  // While a bulk transfer runs, taps writing to the log are skipped
+  void setBulkTransfer(bool bulkTransfer) { atomic_store(&_bulkTransfer, bulkTransfer); }
+  bool isBulkTransfer() { return atomic_load(&_bulkTransfer); }
 
   void _serialQueueHandler();
 
+  // Publishes the LED state, the outputs are written by updateLED() outside of the bridge tasks
   void setLED(bool red, bool green, bool blue);
+  // Applies the published LED state to the outputs, called periodically from the ESPHome loop
+  void updateLED();
+  void setTrafficBlink(bool trafficBlink) { _trafficBlink = trafficBlink; }
 
   void addLed(LED *redLED, LED *greenLED, LED *blueLED) {
     _redLED = redLED;
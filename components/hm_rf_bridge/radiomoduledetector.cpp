@@ -20,44 +20,101 @@
 #include <string.h>
 #include "radiomoduledetector.h"
 #include "hmframe.h"
-
-static const char *TAG = "RadioModuleDetector";
+#include <esp_timer.h>
+
+// request timeouts follow the measured round trip time of the module
+#define RESPONSE_TIMEOUT_FACTOR 4
+#define RESPONSE_TIMEOUT_FLOOR 20      // ms
+#define IDENTIFY_TIMEOUT_CEILING 500   // ms
+#define STATE_TIMEOUT_CEILING 1000     // ms
+#define IDENTIFY_TIME_BUDGET 3000000  // us per identify phase, same worst case as the former 3 retries
+#define STATE_RETRIES 2                // requests sent again with the full timeout before detection gives up
+
+#define DETECT_ACTION_SEND -1
+
+typedef struct {
+  int nextState;  // DETECT_ACTION_SEND sends destination/command and keeps the state
+  uint8_t destination;
+  uint8_t command;
+} identify_action_t;
+
+typedef struct {
+  uint8_t destination;
+  uint8_t ackCommand;  // the response is either an ACK with status byte or command 0 followed by the name
+  uint8_t ackStatus;
+  const char *name;
+  uint16_t nameLen;
+  identify_action_t inStartBootloader;
+  identify_action_t inStartApp;
+} identify_response_t;
+
+#define GOTO(__state) \
+  { __state, 0, 0 }
+#define SEND(__destination, __command) \
+  { DETECT_ACTION_SEND, __destination, __command }
+
+// clang-format off
+static const identify_response_t IDENTIFY_RESPONSES[] = {
+  // TRX CoPro in bootloader
+  {HM_DST_COMMON, HM_CMD_COMMON_ACK, 1, "HMIP_TRX_Bl", 11,
+   GOTO(DETECT_STATE_START_APP), SEND(HM_DST_COMMON, HM_CMD_COMMON_START_APP)},
+  // Legacy CoPro in bootloader
+  {HM_DST_HMSYSTEM, HM_CMD_HMSYSTEM_ACK, 2, "Co_CPU_BL", 9,
+   GOTO(DETECT_STATE_START_APP), SEND(HM_DST_HMSYSTEM, HM_CMD_HMSYSTEM_CHANGE_APP)},
+  // Dual CoPro in app
+  {HM_DST_COMMON, HM_CMD_COMMON_ACK, 1, "DualCoPro_App", 13,
+   SEND(HM_DST_COMMON, HM_CMD_COMMON_START_BL), GOTO(DETECT_STATE_GET_MCU_TYPE)},
+  // HmIP only in app
+  {HM_DST_COMMON, HM_CMD_COMMON_ACK, 1, "HMIP_TRX_App", 12,
+   SEND(HM_DST_COMMON, HM_CMD_COMMON_START_BL), GOTO(DETECT_STATE_GET_MCU_TYPE)},
+  // Legacy CoPro in app
+  {HM_DST_HMSYSTEM, HM_CMD_HMSYSTEM_ACK, 2, "Co_CPU_App", 10,
+   SEND(HM_DST_HMSYSTEM, HM_CMD_HMSYSTEM_CHANGE_APP), GOTO(DETECT_STATE_LEGACY_GET_VERSION)},
+};
+// clang-format on
+
+static const identify_response_t *matchIdentifyResponse(HMFrame *frame) {
+  for (const identify_response_t &response : IDENTIFY_RESPONSES) {
+    if (frame->destination != response.destination)
+      continue;
+
+    if (frame->command == response.ackCommand && frame->data_len == response.nameLen + 1 &&
+        frame->data[0] == response.ackStatus && memcmp(frame->data + 1, response.name, response.nameLen) == 0)
+      return &response;
+
+    if (frame->command == 0 && frame->data_len == response.nameLen &&
+        memcmp(frame->data, response.name, response.nameLen) == 0)
+      return &response;
+  }
+  return nullptr;
+}
 
 void RadioModuleDetector::detectRadioModule(RadioModuleConnector *radioModuleConnector) {
   _radioModuleConnector = radioModuleConnector;
+  snprintf(_tag, sizeof(_tag), "RadioModuleDetector.%d", (int) radioModuleConnector->getUartNum());
 
   _detectState = DETECT_STATE_START_BL;
-  _detectRetryCount = 0;
   _detectMsgCounter = 0;
+  _responseTime = 0;
 
   _radioModuleType = RADIO_MODULE_NONE;
+  _identify[0] = 0;
+  _detectionComplete = false;
 
-  sem_init(_detectWaitFrameDataSemaphore);
+  if (!_detectWaitFrameDataSemaphore)
+    sem_init(_detectWaitFrameDataSemaphore);
 
   _radioModuleConnector->setFrameHandler(this, true);
 
-  while (_detectState == DETECT_STATE_START_BL && _detectRetryCount < 3) {
-    sendFrame(_detectMsgCounter++, HM_DST_COMMON, HM_CMD_COMMON_IDENTIFY, NULL, 0);
-    if (!sem_take(_detectWaitFrameDataSemaphore, 0.5f)) {
-      sendFrame(_detectMsgCounter++, HM_DST_HMSYSTEM, HM_CMD_HMSYSTEM_IDENTIFY, NULL, 0);
-      if (!sem_take(_detectWaitFrameDataSemaphore, 0.5f)) {
-        _detectRetryCount++;
-      }
-    }
-  }
+  // the reset started by RadioModuleConnector::start() runs asynchronously
+  _radioModuleConnector->waitResetComplete(1000 / portTICK_PERIOD_MS);
 
-  _detectRetryCount = 0;
-  while (_detectState == DETECT_STATE_START_APP && _detectRetryCount < 3) {
-    sendFrame(_detectMsgCounter++, HM_DST_COMMON, HM_CMD_COMMON_IDENTIFY, NULL, 0);
-    if (!sem_take(_detectWaitFrameDataSemaphore, 0.5f)) {
-      sendFrame(_detectMsgCounter++, HM_DST_HMSYSTEM, HM_CMD_HMSYSTEM_IDENTIFY, NULL, 0);
-      if (!sem_take(_detectWaitFrameDataSemaphore, 0.5f)) {
-        _detectRetryCount++;
-      }
-    }
-  }
+  identify(DETECT_STATE_START_BL);
+  identify(DETECT_STATE_START_APP);
 
+  int retries = 0;
   while (true) {
+    _requestTime = esp_timer_get_time();
     switch (_detectState) {
       case DETECT_STATE_START_BL:
       case DETECT_STATE_START_APP:
@@ -104,16 +161,137 @@ void RadioModuleDetector::detectRadioModule(RadioModuleConnector *radioModuleCon
         break;
     }
 
-    if (_detectState == DETECT_STATE_FINISHED || !sem_take(_detectWaitFrameDataSemaphore, 1)) {
+    if (_detectState == DETECT_STATE_FINISHED)
+      break;
+
+    // the first wait follows the measured round trip, a busy module gets the full timeout on the retries
+    int state = _detectState;
+    uint32_t timeout = retries ? STATE_TIMEOUT_CEILING : responseTimeout(STATE_TIMEOUT_CEILING);
+    if (sem_take_ms(_detectWaitFrameDataSemaphore, timeout) || _detectState != state) {
+      retries = 0;
+      continue;
+    }
+
+    if (++retries > STATE_RETRIES) {
+      ESP_LOGW(_tag, "Radio module did not answer in detection state %d", state);
+      break;
+    }
+  }
+
+  _radioModuleConnector->setFrameHandler(NULL, false);
+
+  // a module that stopped answering halfway leaves the state in between, unanswered identify probes no identify
+  _detectionComplete = _detectState == DETECT_STATE_FINISHED && _identify[0] != 0;
+}
+
+void RadioModuleDetector::identify(int state) {
+  int64_t deadline = esp_timer_get_time() + IDENTIFY_TIME_BUDGET;
+  _probeCounterFloor = _detectMsgCounter;
+
+  while (_detectState == state && esp_timer_get_time() < deadline) {
+    // both identify flavours back to back, whichever the module understands answers first
+    _requestTime = esp_timer_get_time();
+    sendFrame(_detectMsgCounter++, HM_DST_COMMON, HM_CMD_COMMON_IDENTIFY, NULL, 0);
+    sendFrame(_detectMsgCounter++, HM_DST_HMSYSTEM, HM_CMD_HMSYSTEM_IDENTIFY, NULL, 0);
+    // probes overlapping a slow answer are answered twice, the duplicate is dropped by its counter in handleFrame
+    xSemaphoreTake(_detectWaitFrameDataSemaphore, pdMS_TO_TICKS(responseTimeout(IDENTIFY_TIMEOUT_CEILING)));
+  }
+}
+
+bool RadioModuleDetector::isCurrentProbe(uint8_t counter) {
+  // counters wrap at 256 on the wire, so the age is counted back from the last frame sent
+  int age = (uint8_t) (_detectMsgCounter - 1 - counter);
+  return age < _detectMsgCounter - _probeCounterFloor;
+}
+
+void RadioModuleDetector::responseReceived() {
+  if (!_responseTime) {
+    _responseTime = esp_timer_get_time() - _requestTime;
+    ESP_LOGD(_tag, "Radio module response time %u us", _responseTime);
+  }
+  sem_give(_detectWaitFrameDataSemaphore);
+}
+
+uint32_t RadioModuleDetector::responseTimeout(uint32_t ceiling) {
+  if (!_responseTime)
+    return ceiling;
+
+  uint32_t timeout = _responseTime * RESPONSE_TIMEOUT_FACTOR / 1000;
+  if (timeout < RESPONSE_TIMEOUT_FLOOR)
+    return RESPONSE_TIMEOUT_FLOOR;
+  return timeout > ceiling ? ceiling : timeout;
+}
+
+bool RadioModuleDetector::verifyRadioModule(RadioModuleConnector *radioModuleConnector,
+                                            const radio_module_info_t *info) {
+  _radioModuleConnector = radioModuleConnector;
+  snprintf(_tag, sizeof(_tag), "RadioModuleDetector.%d", (int) radioModuleConnector->getUartNum());
+  _verifyIdentify = info->identify;
+  _detectState = DETECT_STATE_VERIFY;
+  _detectionComplete = false;
+
+  if (!_detectWaitFrameDataSemaphore)
+    sem_init(_detectWaitFrameDataSemaphore);
+
+  _radioModuleConnector->setFrameHandler(this, true);
+
+  bool legacy = strcmp(info->identify, "Co_CPU_App") == 0;
+  for (int retry = 0; retry < 2; retry++) {
+    _requestTime = esp_timer_get_time();
+    if (legacy) {
+      sendFrame(_detectMsgCounter++, HM_DST_HMSYSTEM, HM_CMD_HMSYSTEM_IDENTIFY, NULL, 0);
+    } else {
+      sendFrame(_detectMsgCounter++, HM_DST_COMMON, HM_CMD_COMMON_IDENTIFY, NULL, 0);
+    }
+    if (sem_take(_detectWaitFrameDataSemaphore, 0.1f))
       break;
+  }
+
+  // the firmware changes with a coprocessor update, so it is read again instead of taken from the cache
+  if (_detectState == DETECT_STATE_FINISHED) {
+    int versionState = legacy ? DETECT_STATE_LEGACY_GET_VERSION : DETECT_STATE_GET_VERSION;
+    _detectState = versionState;
+    for (int retry = 0; retry < 2 && _detectState == versionState; retry++) {
+      _requestTime = esp_timer_get_time();
+      if (legacy) {
+        sendFrame(_detectMsgCounter++, HM_DST_HMSYSTEM, HM_CMD_HMSYSTEM_GET_VERSION, NULL, 0);
+      } else {
+        sendFrame(_detectMsgCounter++, HM_DST_TRX, HM_CMD_TRX_GET_VERSION, NULL, 0);
+      }
+      xSemaphoreTake(_detectWaitFrameDataSemaphore, pdMS_TO_TICKS(responseTimeout(STATE_TIMEOUT_CEILING)));
     }
+    _detectState = _detectState == versionState ? DETECT_STATE_VERIFY : DETECT_STATE_FINISHED;
   }
 
   _radioModuleConnector->setFrameHandler(NULL, false);
+
+  if (_detectState != DETECT_STATE_FINISHED)
+    return false;
+
+  // the cached strings come from flash and are terminated here in any case
+  snprintf(_identify, sizeof(_identify), "%.*s", (int) sizeof(info->identify), info->identify);
+  _radioModuleType = info->radioModuleType;
+  snprintf(_serial, sizeof(_serial), "%.*s", (int) sizeof(info->serial), info->serial);
+  snprintf(_sgtin, sizeof(_sgtin), "%.*s", (int) sizeof(info->sgtin), info->sgtin);
+  _bidCosRadioMAC = info->bidCosRadioMAC;
+  _hmIPRadioMAC = info->hmIPRadioMAC;
+  _detectionComplete = true;
+  return true;
+}
+
+void RadioModuleDetector::getRadioModuleInfo(radio_module_info_t *info) {
+  memset(info, 0, sizeof(radio_module_info_t));
+  snprintf(info->identify, sizeof(info->identify), "%s", _identify);
+  info->radioModuleType = _radioModuleType;
+  memcpy(info->firmwareVersion, _firmwareVersion, sizeof(_firmwareVersion));
+  memcpy(info->serial, _serial, sizeof(_serial));
+  memcpy(info->sgtin, _sgtin, sizeof(_sgtin));
+  info->bidCosRadioMAC = _bidCosRadioMAC;
+  info->hmIPRadioMAC = _hmIPRadioMAC;
 }
 
 void RadioModuleDetector::handleFrame(unsigned char *buffer, uint16_t len) {
-  log_frame("Received HM frame:", buffer, len);
+  log_frame(_radioModuleConnector->getTraceLog(), _tag, "Received HM frame:", buffer, len);
 
   HMFrame frame;
   if (!HMFrame::TryParse(buffer, len, &frame)) {
@@ -121,92 +299,51 @@ void RadioModuleDetector::handleFrame(unsigned char *buffer, uint16_t len) {
   }
 
   switch (_detectState) {
-    case DETECT_STATE_START_BL:
-      if ((frame.destination == HM_DST_COMMON && frame.command == HM_CMD_COMMON_ACK && frame.data_len == 12 &&
-           frame.data[0] == 1 && strncmp((char *) (frame.data + 1), "HMIP_TRX_Bl", 11) == 0) ||
-          (frame.destination == HM_DST_COMMON && frame.command == 0 && frame.data_len == 11 &&
-           strncmp((char *) (frame.data), "HMIP_TRX_Bl", 11) == 0)) {
-        // TRX CoPro in bootloader
-        _detectState = DETECT_STATE_START_APP;
-        sem_give(_detectWaitFrameDataSemaphore);
-      } else if ((frame.destination == HM_DST_HMSYSTEM && frame.command == HM_CMD_HMSYSTEM_ACK &&
-                  frame.data_len == 10 && frame.data[0] == 2 &&
-                  strncmp((char *) (frame.data + 1), "Co_CPU_BL", 9) == 0) ||
-                 (frame.destination == HM_DST_HMSYSTEM && frame.command == 0 && frame.data_len == 9 &&
-                  strncmp((char *) frame.data, "Co_CPU_BL", 9) == 0)) {
-        // Legacy CoPro in bootloader
-        _detectState = DETECT_STATE_START_APP;
-        sem_give(_detectWaitFrameDataSemaphore);
-      } else if ((frame.destination == HM_DST_COMMON && frame.command == HM_CMD_COMMON_ACK && frame.data_len == 14 &&
-                  frame.data[0] == 1 && strncmp((char *) (frame.data + 1), "DualCoPro_App", 13) == 0) ||
-                 (frame.destination == HM_DST_COMMON && frame.command == 0 && frame.data_len == 13 &&
-                  strncmp((char *) frame.data, "DualCoPro_App", 13) == 0)) {
-        // Dual CoPro in app --> start bootloader
-        sendFrame(_detectMsgCounter++, HM_DST_COMMON, HM_CMD_COMMON_START_BL, NULL, 0);
-      } else if ((frame.destination == HM_DST_COMMON && frame.command == HM_CMD_COMMON_ACK && frame.data_len == 13 &&
-                  frame.data[0] == 1 && strncmp((char *) (frame.data + 1), "HMIP_TRX_App", 12) == 0) ||
-                 (frame.destination == HM_DST_COMMON && frame.command == 0 && frame.data_len == 12 &&
-                  strncmp((char *) frame.data, "HMIP_TRX_App", 12) == 0)) {
-        // HmIP only in app --> start bootloader
-        sendFrame(_detectMsgCounter++, HM_DST_COMMON, HM_CMD_COMMON_START_BL, NULL, 0);
-      } else if ((frame.destination == HM_DST_HMSYSTEM && frame.command == HM_CMD_HMSYSTEM_ACK &&
-                  frame.data_len == 11 && frame.data[0] == 2 &&
-                  strncmp((char *) (frame.data + 1), "Co_CPU_App", 10) == 0) ||
-                 (frame.destination == HM_DST_HMSYSTEM && frame.command == 0 && frame.data_len == 10 &&
-                  strncmp((char *) frame.data, "Co_CPU_App", 10) == 0)) {
-        // Legacy CoPro in app --> start bootloader
-        sendFrame(_detectMsgCounter++, HM_DST_HMSYSTEM, HM_CMD_HMSYSTEM_CHANGE_APP, NULL, 0);
+    case DETECT_STATE_VERIFY: {
+      const identify_response_t *response = matchIdentifyResponse(&frame);
+      if (response && strcmp(response->name, _verifyIdentify) == 0) {
+        _detectState = DETECT_STATE_FINISHED;
+        responseReceived();
       }
       break;
+    }
+
+    case DETECT_STATE_START_BL:
+    case DETECT_STATE_START_APP: {
+      const identify_response_t *response = matchIdentifyResponse(&frame);
+      if (!response || !isCurrentProbe(frame.counter))
+        break;
+
+      const identify_action_t *action =
+          _detectState == DETECT_STATE_START_BL ? &response->inStartBootloader : &response->inStartApp;
+
+      if (action->nextState == DETECT_ACTION_SEND) {
+        sendFrame(_detectMsgCounter++, action->destination, action->command, NULL, 0);
+        // answers to probes sent before the switch describe the old mode and would trigger it again
+        _probeCounterFloor = _detectMsgCounter;
+        break;
+      }
+
+      if (action->nextState != DETECT_STATE_START_APP)
+        strcpy(_identify, response->name);
 
-    case DETECT_STATE_START_APP:
-      if ((frame.destination == HM_DST_COMMON && frame.command == HM_CMD_COMMON_ACK && frame.data_len == 12 &&
-           frame.data[0] == 1 && strncmp((char *) (frame.data + 1), "HMIP_TRX_Bl", 11) == 0) ||
-          (frame.destination == HM_DST_COMMON && frame.command == 0 && frame.data_len == 11 &&
-           strncmp((char *) (frame.data), "HMIP_TRX_Bl", 11) == 0)) {
-        // TRX CoPro in bootloader --> start app
-        sendFrame(_detectMsgCounter++, HM_DST_COMMON, HM_CMD_COMMON_START_APP, NULL, 0);
-      } else if ((frame.destination == HM_DST_HMSYSTEM && frame.command == HM_CMD_HMSYSTEM_ACK &&
-                  frame.data_len == 10 && frame.data[0] == 2 &&
-                  strncmp((char *) (frame.data + 1), "Co_CPU_BL", 9) == 0) ||
-                 (frame.destination == HM_DST_HMSYSTEM && frame.command == 0 && frame.data_len == 9 &&
-                  strncmp((char *) frame.data, "Co_CPU_BL", 9) == 0)) {
-        // Legacy CoPro in bootloader --> start app
-        sendFrame(_detectMsgCounter++, HM_DST_HMSYSTEM, HM_CMD_HMSYSTEM_CHANGE_APP, NULL, 0);
-      } else if ((frame.destination == HM_DST_COMMON && frame.command == HM_CMD_COMMON_ACK && frame.data_len == 14 &&
-                  frame.data[0] == 1 && strncmp((char *) (frame.data + 1), "DualCoPro_App", 13) == 0) ||
-                 (frame.destination == HM_DST_COMMON && frame.command == 0 && frame.data_len == 13 &&
-                  strncmp((char *) frame.data, "DualCoPro_App", 13) == 0)) {
-        // Dual CoPro in app
-        _detectState = DETECT_STATE_GET_MCU_TYPE;
-        sem_give(_detectWaitFrameDataSemaphore);
-      } else if ((frame.destination == HM_DST_COMMON && frame.command == HM_CMD_COMMON_ACK && frame.data_len == 13 &&
-                  frame.data[0] == 1 && strncmp((char *) (frame.data + 1), "HMIP_TRX_App", 12) == 0) ||
-                 (frame.destination == HM_DST_COMMON && frame.command == 0 && frame.data_len == 12 &&
-                  strncmp((char *) frame.data, "HMIP_TRX_App", 12) == 0)) {
-        // HmIP only in app
-        _detectState = DETECT_STATE_GET_MCU_TYPE;
-        sem_give(_detectWaitFrameDataSemaphore);
-      } else if ((frame.destination == HM_DST_HMSYSTEM && frame.command == HM_CMD_HMSYSTEM_ACK &&
-                  frame.data_len == 11 && frame.data[0] == 2 &&
-                  strncmp((char *) (frame.data + 1), "Co_CPU_App", 10) == 0) ||
-                 (frame.destination == HM_DST_HMSYSTEM && frame.command == 0 && frame.data_len == 10 &&
-                  strncmp((char *) frame.data, "Co_CPU_App", 10) == 0)) {
-        // Legacy CoPro in app
-        _detectState = DETECT_STATE_LEGACY_GET_VERSION;
+      if (action->nextState == DETECT_STATE_LEGACY_GET_VERSION) {
         sprintf(_sgtin, "n/a");
         _hmIPRadioMAC = 0;
         _radioModuleType = RADIO_MODULE_HM_MOD_RPI_PCB;
-        sem_give(_detectWaitFrameDataSemaphore);
       }
+
+      _detectState = action->nextState;
+      responseReceived();
       break;
+    }
 
     case DETECT_STATE_GET_MCU_TYPE:
       if (frame.destination == HM_DST_TRX && frame.command == HM_CMD_TRX_ACK && frame.data_len == 2 &&
           frame.data[0] == 1) {
         _radioModuleType = (radio_module_type_t) frame.data[1];
         _detectState = DETECT_STATE_GET_VERSION;
-        sem_give(_detectWaitFrameDataSemaphore);
+        responseReceived();
       }
       break;
 
@@ -215,7 +352,7 @@ void RadioModuleDetector::handleFrame(unsigned char *buffer, uint16_t len) {
           frame.data[0] == 1) {
         memcpy(_firmwareVersion, frame.data + 1, 3);
         _detectState = DETECT_STATE_GET_HMIP_RF_ADDRESS;
-        sem_give(_detectWaitFrameDataSemaphore);
+        responseReceived();
       }
       break;
 
@@ -224,7 +361,7 @@ void RadioModuleDetector::handleFrame(unsigned char *buffer, uint16_t len) {
           frame.data[0] == 1) {
         _hmIPRadioMAC = (frame.data[1] << 16) | (frame.data[2] << 8) | frame.data[3];
         _detectState = DETECT_STATE_GET_SGTIN;
-        sem_give(_detectWaitFrameDataSemaphore);
+        responseReceived();
       }
       break;
 
@@ -256,7 +393,7 @@ void RadioModuleDetector::handleFrame(unsigned char *buffer, uint16_t len) {
             _detectState = DETECT_STATE_GET_BIDCOS_RF_ADDRESS;
             break;
         }
-        sem_give(_detectWaitFrameDataSemaphore);
+        responseReceived();
       }
       break;
 
@@ -267,12 +404,12 @@ void RadioModuleDetector::handleFrame(unsigned char *buffer, uint16_t len) {
         if (radioMac != 0 && (radioMac & 0xffff) != 0xffff)
           _bidCosRadioMAC = radioMac;
         _detectState = _radioModuleType == RADIO_MODULE_RPI_RF_MOD ? DETECT_STATE_FINISHED : DETECT_STATE_GET_SERIAL;
-        sem_give(_detectWaitFrameDataSemaphore);
+        responseReceived();
       } else if (frame.destination == HM_DST_LLMAC && frame.command == HM_CMD_LLMAC_ACK && frame.data_len == 1 &&
                  frame.data[0] == 0) {
         if (_radioModuleType == RADIO_MODULE_RPI_RF_MOD)
           _detectState = DETECT_STATE_FINISHED;
-        sem_give(_detectWaitFrameDataSemaphore);
+        responseReceived();
       }
       break;
 
@@ -281,7 +418,7 @@ void RadioModuleDetector::handleFrame(unsigned char *buffer, uint16_t len) {
           frame.data[0] == 1) {
         memcpy(_serial, frame.data + 1, 10);
         _detectState = DETECT_STATE_FINISHED;
-        sem_give(_detectWaitFrameDataSemaphore);
+        responseReceived();
       }
       break;
 
@@ -290,7 +427,7 @@ void RadioModuleDetector::handleFrame(unsigned char *buffer, uint16_t len) {
           frame.data[0] == 2) {
         memcpy(_firmwareVersion, frame.data + 4, 3);
         _detectState = DETECT_STATE_LEGACY_GET_BIDCOS_RF_ADDRESS;
-        sem_give(_detectWaitFrameDataSemaphore);
+        responseReceived();
       }
       break;
 
@@ -298,7 +435,7 @@ void RadioModuleDetector::handleFrame(unsigned char *buffer, uint16_t len) {
       if (frame.destination == HM_DST_TRX && frame.command == HM_CMD_TRX_ACK && frame.data_len == 6) {
         _bidCosRadioMAC = (frame.data[3] << 16) | (frame.data[4] << 8) | frame.data[5];
         _detectState = DETECT_STATE_LEGACY_GET_SERIAL;
-        sem_give(_detectWaitFrameDataSemaphore);
+        responseReceived();
       }
       break;
 
@@ -307,7 +444,7 @@ void RadioModuleDetector::handleFrame(unsigned char *buffer, uint16_t len) {
           frame.data[0] == 2) {
         memcpy(_serial, frame.data + 1, 10);
         _detectState = DETECT_STATE_FINISHED;
-        sem_give(_detectWaitFrameDataSemaphore);
+        responseReceived();
       }
       break;
   }
@@ -337,7 +474,7 @@ void RadioModuleDetector::sendFrame(uint8_t counter, uint8_t destination, uint8_
   frame.data_len = data_len;
   uint16_t len = frame.encode(sendBuffer, sizeof(sendBuffer), true);
 
-  log_frame("Sending HM frame:", sendBuffer, len);
+  log_frame(_radioModuleConnector->getTraceLog(), _tag, "Sending HM frame:", sendBuffer, len);
 
   _radioModuleConnector->sendFrame(sendBuffer, len);
 }
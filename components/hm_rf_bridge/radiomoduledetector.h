@@ -30,6 +30,7 @@ typedef enum {
 
 typedef enum {
   DETECT_STATE_START_BL = 0,
+  DETECT_STATE_VERIFY = 5,
   DETECT_STATE_START_APP = 10,
 
   DETECT_STATE_GET_MCU_TYPE = 20,
@@ -46,10 +47,25 @@ typedef enum {
   DETECT_STATE_FINISHED = 255,
 } detect_radio_module_state_t;
 
+// Everything detectRadioModule finds out about a module, stable for a given module and cacheable across boots
+typedef struct {
+  char identify[16];
+  radio_module_type_t radioModuleType;
+  uint8_t firmwareVersion[3];
+  char serial[11];
+  char sgtin[25];
+  uint32_t bidCosRadioMAC;
+  uint32_t hmIPRadioMAC;
+} radio_module_info_t;
+
 class RadioModuleDetector : private FrameHandler {
  private:
   void handleFrame(unsigned char *buffer, uint16_t len);
   void sendFrame(uint8_t counter, uint8_t destination, uint8_t command, unsigned char *data, uint data_len);
+  void identify(int state);
+  bool isCurrentProbe(uint8_t counter);
+  void responseReceived();
+  uint32_t responseTimeout(uint32_t ceiling);
 
   char _serial[11] = {0};
   uint32_t _bidCosRadioMAC = 0;
@@ -57,19 +73,33 @@ class RadioModuleDetector : private FrameHandler {
   char _sgtin[25] = {0};
   uint8_t _firmwareVersion[3] = {0};
   radio_module_type_t _radioModuleType = RADIO_MODULE_NONE;
+  char _identify[16] = {0};
+  const char *_verifyIdentify{nullptr};
+  bool _detectionComplete{false};
 
   int _detectState;
-  int _detectRetryCount;
-  int _detectMsgCounter;
-  SemaphoreHandle_t _detectWaitFrameDataSemaphore;
+  int _detectMsgCounter{0};
+  int _probeCounterFloor{0};  // identify answers to probes sent before it are duplicates
+  SemaphoreHandle_t _detectWaitFrameDataSemaphore{nullptr};
+  int64_t _requestTime{0};
+  uint32_t _responseTime{0};
   RadioModuleConnector *_radioModuleConnector;
+  char _tag[LOG_TAG_SIZE] = "RadioModuleDetector";
 
  public:
   void detectRadioModule(RadioModuleConnector *radioModuleConnector);
+  // Single identify probe against a previously detected module, adopts the cached info if the module answers with
+  // the same identify string
+  bool verifyRadioModule(RadioModuleConnector *radioModuleConnector, const radio_module_info_t *info);
+  void getRadioModuleInfo(radio_module_info_t *info);
+  // True if the last detection or verification got all information from the module, only then it may be cached
+  bool isDetectionComplete() { return _detectionComplete; }
   const char *getSerial();
   uint32_t getBidCosRadioMAC();
   uint32_t getHmIPRadioMAC();
   const char *getSGTIN();
   const uint8_t *getFirmwareVersion();
   radio_module_type_t getRadioModuleType();
+  // Round trip time of the first answered request in us, 0 if the module never answered
+  uint32_t getResponseTime() { return _responseTime; }
 };
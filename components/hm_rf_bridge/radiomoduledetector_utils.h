@@ -20,10 +20,18 @@
 #include "esphome/core/helpers.h"
 
 #define sem_take(__sem, __timeout) (xSemaphoreTake(__sem, __timeout * 1000 / portTICK_PERIOD_MS) == pdTRUE)
+#define sem_take_ms(__sem, __timeout) (xSemaphoreTake(__sem, pdMS_TO_TICKS(__timeout)) == pdTRUE)
 #define sem_give(__sem) xSemaphoreGive(__sem)
 #define sem_init(__sem) __sem = xSemaphoreCreateBinary();
 
-#define log_frame(__text, __buffer, __len) \
-  ESP_LOGD(TAG, __text); \
-  ESP_LOGD(TAG, "%s", (esphome::format_hex_pretty(__buffer, __len)).c_str());
+#define log_frame(__traceLog, __tag, __text, __buffer, __len) \
+  do { \
+    TraceLog *__trace = (__traceLog); \
+    if (__trace) { \
+      __trace->recordFrame(ESPHOME_LOG_LEVEL_DEBUG, __tag, __text, __buffer, __len); \
+    } else { \
+      ESP_LOGD(__tag, __text); \
+      ESP_LOGD(__tag, "%s", (esphome::format_hex_pretty(__buffer, __len)).c_str()); \
+    } \
+  } while (0)
 // ESP_LOG_BUFFER_HEX_LEVEL(TAG, __buffer, __len, ESP_LOG_DEBUG);
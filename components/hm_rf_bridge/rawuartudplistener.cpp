@@ -18,15 +18,19 @@
 
 #include "rawuartudplistener.h"
 #include "hmframe.h"
+#include <stdio.h>
 #include <string.h>
+#include <new>
 #include "udphelper.h"
 #include <esp_timer.h>
 #include "esphome/core/log.h"
 
-static const char *TAG = "RawUartUdpListener";
+#define stat_add(__counter, __value) atomic_fetch_add_explicit(&_statistics.__counter, (uint32_t) (__value), std::memory_order_relaxed)
 
 void _raw_uart_udpQueueHandlerTask(void *parameter) { ((RawUartUdpListener *) parameter)->_udpQueueHandler(); }
 
+void _raw_uart_pipelineHandlerTask(void *parameter) { ((RawUartUdpListener *) parameter)->_pipelineHandler(); }
+
 void _raw_uart_udpReceivePaket(void *arg, udp_pcb *pcb, pbuf *pb, const ip_addr_t *addr, uint16_t port) {
   while (pb != NULL) {
     pbuf *this_pb = pb;
@@ -40,6 +44,7 @@ void _raw_uart_udpReceivePaket(void *arg, udp_pcb *pcb, pbuf *pb, const ip_addr_
 
 RawUartUdpListener::RawUartUdpListener(RadioModuleConnector *radioModuleConnector)
     : _radioModuleConnector(radioModuleConnector) {
+  setPort(RAW_UART_DEFAULT_PORT);
   atomic_init(&_connectionStarted, false);
   atomic_init(&_remotePort, (ushort) 0);
   atomic_init(&_remoteAddress, 0u);
@@ -47,23 +52,32 @@ RawUartUdpListener::RawUartUdpListener(RadioModuleConnector *radioModuleConnecto
   atomic_init(&_endpointConnectionIdentifier, 1);
 }
 
-void RawUartUdpListener::handlePacket(pbuf *pb, ip4_addr_t addr, uint16_t port) {
+void RawUartUdpListener::setPort(uint16_t port) {
+  _port = port;
+  snprintf(_tag, sizeof(_tag), "RawUartUdpListener.%u", port);
+}
+
+void RawUartUdpListener::handlePacket(pbuf *pb, ip4_addr_t addr, uint16_t port, int64_t timestamp) {
   size_t length = pb->len;
   unsigned char *data = (unsigned char *) (pb->payload);
   unsigned char response_buffer[3];
+  TraceLog *traceLog = _radioModuleConnector->getTraceLog();
 
   if (length < 4) {
-    ESP_LOGW(TAG, "Received invalid raw-uart packet, length %d", length);
+    trace_logw(traceLog, _tag, "Received invalid raw-uart packet, length %d", length);
     return;
   }
 
   if (data[0] != 0 && (addr.addr != atomic_load(&_remoteAddress) || port != atomic_load(&_remotePort))) {
-    ESP_LOGW(TAG, "Received raw-uart packet from invalid address.");
+    trace_logw(traceLog, _tag, "Received raw-uart packet from invalid address.");
     return;
   }
 
   if (*((uint16_t *) (data + length - 2)) != htons(HMFrame::crc(data, length - 2))) {
-    ESP_LOGW(TAG, "Received raw-uart packet with invalid crc.");
+    stat_add(droppedCrc, 1);
+    if (_radioModuleConnector->getFlightRecorder())
+      _radioModuleConnector->getFlightRecorder()->trigger(FLIGHT_RECORDER_TRIGGER_CRC_ERROR);
+    trace_logw(traceLog, _tag, "Received raw-uart packet with invalid crc.");
     return;
   }
 
@@ -89,8 +103,9 @@ void RawUartUdpListener::handlePacket(pbuf *pb, ip4_addr_t addr, uint16_t port)
           atomic_store(&_endpointConnectionIdentifier, endpointConnectionIdentifier);
           atomic_store(&_connectionStarted, false);
         } else if (data[3] != (endpointConnectionIdentifier & 0xff)) {
-          ESP_LOGW(TAG, "Received raw-uart reconnect packet with invalid endpoint identifier %d, should be %d", data[3],
-                   endpointConnectionIdentifier);
+          trace_logw(traceLog, _tag,
+                     "Received raw-uart reconnect packet with invalid endpoint identifier %d, should be %d", data[3],
+                     endpointConnectionIdentifier);
           return;
         }
 
@@ -103,12 +118,13 @@ void RawUartUdpListener::handlePacket(pbuf *pb, ip4_addr_t addr, uint16_t port)
         response_buffer[2] = endpointConnectionIdentifier;
         sendMessage(0, response_buffer, 3);
       } else {
-        ESP_LOGW(TAG, "Received invalid raw-uart connect packet, length %d", length);
+        trace_logw(traceLog, _tag, "Received invalid raw-uart connect packet, length %d", length);
         return;
       }
       break;
 
     case 1:  // disconnect
+      endBulkTransfer("disconnected");
       atomic_store(&_remotePort, (ushort) 0);
       atomic_store(&_connectionStarted, false);
       atomic_store(&_remoteAddress, 0u);
@@ -116,11 +132,12 @@ void RawUartUdpListener::handlePacket(pbuf *pb, ip4_addr_t addr, uint16_t port)
       break;
 
     case 2:  // keep alive
+      stat_add(keepAlivesReceived, 1);
       break;
 
     case 3:  // LED
       if (length != 5) {
-        ESP_LOGW(TAG, "Received invalid raw-uart LED packet, length %d", length);
+        trace_logw(traceLog, _tag, "Received invalid raw-uart LED packet, length %d", length);
         return;
       }
 
@@ -129,7 +146,7 @@ void RawUartUdpListener::handlePacket(pbuf *pb, ip4_addr_t addr, uint16_t port)
 
     case 4:  // Reset
       if (length != 4) {
-        ESP_LOGW(TAG, "Received invalid raw-uart reset packet, length %d", length);
+        trace_logw(traceLog, _tag, "Received invalid raw-uart reset packet, length %d", length);
         return;
       }
 
@@ -138,18 +155,18 @@ void RawUartUdpListener::handlePacket(pbuf *pb, ip4_addr_t addr, uint16_t port)
 
     case 5:  // Start connection
       if (length != 4) {
-        ESP_LOGW(TAG, "Received invalid raw-uart startconn packet, length %d", length);
+        trace_logw(traceLog, _tag, "Received invalid raw-uart startconn packet, length %d", length);
         return;
       }
 
       atomic_store(&_connectionStarted, true);
-      ESP_LOGI(TAG, "Connection started");
+      trace_logi(traceLog, _tag, "Connection started");
 
       break;
 
     case 6:  // End connection
       if (length != 4) {
-        ESP_LOGW(TAG, "Received invalid raw-uart endconn packet, length %d", length);
+        trace_logw(traceLog, _tag, "Received invalid raw-uart endconn packet, length %d", length);
         return;
       }
 
@@ -158,15 +175,15 @@ void RawUartUdpListener::handlePacket(pbuf *pb, ip4_addr_t addr, uint16_t port)
 
     case 7:  // Frame
       if (length < 5) {
-        ESP_LOGW(TAG, "Received invalid raw-uart frame packet, length %d", length);
+        trace_logw(traceLog, _tag, "Received invalid raw-uart frame packet, length %d", length);
         return;
       }
 
-      _radioModuleConnector->sendFrame(&data[2], length - 4);
+      forwardFrame(&data[2], length - 4, timestamp);
       break;
 
     default:
-      ESP_LOGW(TAG, "Received invalid raw-uart packet with unknown type %d", data[0]);
+      trace_logw(traceLog, _tag, "Received invalid raw-uart packet with unknown type %d", data[0]);
       break;
   }
 }
@@ -185,20 +202,22 @@ ip4_addr_t RawUartUdpListener::getConnectedRemoteAddress() {
 
 bool RawUartUdpListener::isConnected() { return atomic_load(&_connectionStarted); }
 
-void RawUartUdpListener::sendMessage(unsigned char command, unsigned char *buffer, size_t len) {
-  uint16_t port = atomic_load(&_remotePort);
-  uint32_t address = atomic_load(&_remoteAddress);
+void RawUartUdpListener::resetLatency() {
+  _uartToUdpLatency.reset();
+  _udpSendLatency.reset();
+  _udpToUartLatency.reset();
+  if (_txScheduler)
+    _txScheduler->resetLatency();
+  if (_pipeline)
+    _pipeline->resetHighWaterMark();
+}
 
+pbuf *RawUartUdpListener::createMessage(unsigned char command, const unsigned char *buffer, size_t len) {
   pbuf *pb = pbuf_alloc(PBUF_TRANSPORT, len + 4, PBUF_RAM);
-  unsigned char *sendBuffer = (unsigned char *) pb->payload;
-
-  ip_addr_t addr;
-  ip4_addr_set_u32(ip_2_ip4(&addr), address);
-  IP_SET_TYPE(&addr, IPADDR_TYPE_V4);
-
-  if (!port)
-    return;
+  if (!pb)
+    return NULL;
 
+  unsigned char *sendBuffer = (unsigned char *) pb->payload;
   sendBuffer[0] = command;
   sendBuffer[1] = (unsigned char) atomic_fetch_add(&_counter, 1);
 
@@ -206,31 +225,151 @@ void RawUartUdpListener::sendMessage(unsigned char command, unsigned char *buffe
     memcpy(sendBuffer + 2, buffer, len);
 
   *((uint16_t *) (sendBuffer + len + 2)) = htons(HMFrame::crc(sendBuffer, len + 2));
+  return pb;
+}
+
+void RawUartUdpListener::sendMessage(unsigned char command, unsigned char *buffer, size_t len) {
+  if (!atomic_load(&_remotePort))
+    return;
 
-  _udp_sendto(_pcb, pb, &addr, port);
-  pbuf_free(pb);
+  pbuf *pb = createMessage(command, buffer, len);
+  if (pb)
+    sendMessages(&pb, 1);
+}
+
+void RawUartUdpListener::sendMessages(pbuf **pbs, uint8_t count) {
+  uint16_t port = atomic_load(&_remotePort);
+  uint32_t address = atomic_load(&_remoteAddress);
+
+  if (port) {
+    ip_addr_t addr;
+    ip4_addr_set_u32(ip_2_ip4(&addr), address);
+    IP_SET_TYPE(&addr, IPADDR_TYPE_V4);
+
+    int64_t sendStart = esp_timer_get_time();
+    if (count == 1)
+      _udp_sendto(_pcb, pbs[0], &addr, port);
+    else
+      _udp_sendto_batch(_pcb, pbs, count, &addr, port);
+    _udpSendLatency.record(esp_timer_get_time() - sendStart);
+  }
+
+  for (uint8_t i = 0; i < count; i++)
+    pbuf_free(pbs[i]);
 }
 
 void RawUartUdpListener::handleFrame(unsigned char *buffer, uint16_t len) {
-  if (!atomic_load(&_connectionStarted))
+  if (!atomic_load(&_connectionStarted)) {
+    stat_add(droppedNotConnected, 1);
     return;
+  }
 
   if (len > (1500 - 28 - 4)) {
-    ESP_LOGW(TAG, "Received oversized frame from radio module, length %d", len);
+    stat_add(droppedOversized, 1);
+    trace_logw(_radioModuleConnector->getTraceLog(), _tag, "Received oversized frame from radio module, length %d",
+               len);
+    return;
+  }
+
+  if (_pipeline) {
+    // the network task sends it, so reading the UART does not wait for the tcpip thread
+    if (_pipeline->push(buffer, len, (uint32_t) _radioModuleConnector->getFrameReceiveTime())) {
+      xTaskNotifyGive(_pipelineHandle);
+    } else {
+      stat_add(droppedPipelineFull, 1);
+      trace_logw(_radioModuleConnector->getTraceLog(), _tag, "Pipeline full, dropped frame of length %d", len);
+    }
     return;
   }
 
   sendMessage(7, buffer, len);
+  _uartToUdpLatency.record(esp_timer_get_time() - _radioModuleConnector->getFrameReceiveTime());
+  stat_add(framesToUdp, 1);
+  stat_add(bytesToUdp, len);
 }
 
 void RawUartUdpListener::start() {
-  _udp_queue = xQueueCreate(32, sizeof(udp_event_t *));
-  xTaskCreate(_raw_uart_udpQueueHandlerTask, "RawUartUdpListener_UDP_QueueHandler", 4096, this, 15, &_tHandle);
+  // in the single task mode the UART task serves the UDP queue, so there is no task to hand frames to either
+  _singleTask = _radioModuleConnector->isSingleTask();
+  if (_singleTask && _pipelineSize) {
+    ESP_LOGW(_tag, "The pipeline needs a task of its own, frames are sent from the UART task");
+    _pipelineSize = 0;
+  }
+  _nextKeepAliveSentOut = esp_timer_get_time();
+
+#ifdef USE_HM_RF_BRIDGE_STATIC_ALLOCATION
+  if (_bulkBatchSize > HM_RF_BRIDGE_STATIC_BULK_BATCH_SIZE) {
+    ESP_LOGE(_tag, "Bulk transfer batch of %u bytes exceeds the static batch of %u bytes", (unsigned) _bulkBatchSize,
+             (unsigned) HM_RF_BRIDGE_STATIC_BULK_BATCH_SIZE);
+    _bulkBatchSize = HM_RF_BRIDGE_STATIC_BULK_BATCH_SIZE;
+  }
+#if HM_RF_BRIDGE_STATIC_BULK_BATCH_SIZE > 0
+  if (_bulkBatchSize)
+    _txBatch = _txBatchStorage;
+#endif
+
+  _udpEventPool = xQueueCreateStatic(UDP_EVENT_POOL_SIZE, sizeof(udp_event_t *), _udpEventPoolStorage,
+                                     &_udpEventPoolBuffer);
+  for (int i = 0; i < UDP_EVENT_POOL_SIZE; i++) {
+    udp_event_t *event = &_udpEvents[i];
+    xQueueSend(_udpEventPool, &event, 0);
+  }
+
+  _udp_queue = xQueueCreateStatic(UDP_QUEUE_LENGTH, sizeof(udp_event_t *), _udpQueueStorage, &_udpQueueBuffer);
+  if (!_singleTask) {
+#if HM_RF_BRIDGE_STATIC_SINGLE_TASK
+    ESP_LOGE(_tag, "Built without memory for the UDP task, the radio module connector has to run in single task mode");
+#else
+    _tHandle = xTaskCreateStatic(_raw_uart_udpQueueHandlerTask, "RawUartUdpListener_UDP_QueueHandler",
+                                 RAW_UART_UDP_LISTENER_STACK_SIZE, this, 15, _taskStack, &_taskBuffer);
+#endif
+  }
+
+  if (_pipelineSize > HM_RF_BRIDGE_STATIC_PIPELINE_SIZE) {
+    ESP_LOGE(_tag, "Pipeline of %u bytes exceeds the static pipeline of %u bytes", (unsigned) _pipelineSize,
+             (unsigned) HM_RF_BRIDGE_STATIC_PIPELINE_SIZE);
+    _pipelineSize = HM_RF_BRIDGE_STATIC_PIPELINE_SIZE;
+  }
+#if HM_RF_BRIDGE_STATIC_PIPELINE_SIZE > 0
+  if (_pipelineSize) {
+    _pipelineBuffer = _pipelineBufferStorage;
+    _pipeline = new (_pipelineStorage) FrameRing(_pipelineBuffer, _pipelineSize);
+    _pipelineHandle = xTaskCreateStaticPinnedToCore(_raw_uart_pipelineHandlerTask, "RawUartUdpListener_Pipeline",
+                                                    RAW_UART_PIPELINE_STACK_SIZE, this, 15, _pipelineTaskStack,
+                                                    &_pipelineTaskBuffer, _pipelineCore);
+  }
+#endif
+#else
+  if (_bulkBatchSize && !(_txBatch = (unsigned char *) malloc(_bulkBatchSize))) {
+    ESP_LOGE(_tag, "Could not allocate the bulk transfer batch, fast path disabled");
+    _bulkBatchSize = 0;
+  }
+
+  _udp_queue = xQueueCreate(UDP_QUEUE_LENGTH, sizeof(udp_event_t *));
+  if (!_singleTask) {
+    xTaskCreate(_raw_uart_udpQueueHandlerTask, "RawUartUdpListener_UDP_QueueHandler",
+                RAW_UART_UDP_LISTENER_STACK_SIZE, this, 15, &_tHandle);
+  }
+
+  if (_pipelineSize && !(_pipelineBuffer = (uint8_t *) malloc(_pipelineSize))) {
+    ESP_LOGE(_tag, "Could not allocate the pipeline, frames are sent from the UART task");
+    _pipelineSize = 0;
+  }
+  if (_pipelineSize) {
+    _pipeline = new FrameRing(_pipelineBuffer, _pipelineSize);
+    xTaskCreatePinnedToCore(_raw_uart_pipelineHandlerTask, "RawUartUdpListener_Pipeline", RAW_UART_PIPELINE_STACK_SIZE,
+                            this, 15, &_pipelineHandle, _pipelineCore);
+  }
+#endif
+
+  // the queue joins the set of the UART task while it is still empty
+  if (_singleTask && !_radioModuleConnector->attachEventLoop(_udp_queue, this))
+    ESP_LOGE(_tag, "Could not attach the UDP queue to the UART task");
 
   _pcb = _udp_new();
   _udp_recv(_pcb, &_raw_uart_udpReceivePaket, (void *) this);
 
-  _udp_bind(_pcb, IP4_ADDR_ANY, 3008);
+  _udp_bind(_pcb, IP4_ADDR_ANY, _port);
 
   _radioModuleConnector->setFrameHandler(this, false);
 }
@@ -242,34 +381,307 @@ void RawUartUdpListener::stop() {
   _pcb = NULL;
 
   _radioModuleConnector->setFrameHandler(NULL, false);
-  vTaskDelete(_tHandle);
+  if (_singleTask) {
+    _radioModuleConnector->detachEventLoop(_udp_queue);
+  } else if (_tHandle) {
+    vTaskDelete(_tHandle);
+    _tHandle = NULL;
+  }
+
+  if (_pipelineHandle) {
+    vTaskDelete(_pipelineHandle);
+    _pipelineHandle = NULL;
+  }
+#ifdef USE_HM_RF_BRIDGE_STATIC_ALLOCATION
+  if (_pipeline)
+    _pipeline->~FrameRing();
+#else
+  delete _pipeline;
+  free(_pipelineBuffer);
+#endif
+  _pipeline = NULL;
+  _pipelineBuffer = NULL;
+
+  // frames still batched are dropped like the packets waiting in the queue
+#ifndef USE_HM_RF_BRIDGE_STATIC_ALLOCATION
+  free(_txBatch);
+#endif
+  _txBatch = NULL;
+  _txBatchCount = 0;
+  _txBatchLen = 0;
+  _bulkTransferState = BULK_TRANSFER_IDLE;
+  _radioModuleConnector->setBulkTransfer(false);
+}
+
+void RawUartUdpListener::forwardFrame(unsigned char *buffer, uint16_t len, int64_t timestamp) {
+  if (_bulkBatchSize)
+    trackBulkTransfer(buffer, len);
+
+  if (_bulkTransferState == BULK_TRANSFER_STREAMING) {
+    _bulkTransferSessionFrames++;
+    atomic_fetch_add_explicit(&_bulkTransferStatistics.frames, 1u, std::memory_order_relaxed);
+    atomic_fetch_add_explicit(&_bulkTransferStatistics.bytes, (uint32_t) len, std::memory_order_relaxed);
+
+    if (len <= _bulkBatchSize) {
+      if (_txBatchLen + len > _bulkBatchSize || _txBatchCount == BULK_TRANSFER_MAX_BATCH_FRAMES)
+        flushTxBatch();
+      memcpy(_txBatch + _txBatchLen, buffer, len);
+      _txBatchLengths[_txBatchCount] = len;
+      _txBatchTimestamps[_txBatchCount++] = timestamp;
+      _txBatchLen += len;
+      return;
+    }
+    atomic_fetch_add_explicit(&_bulkTransferStatistics.batches, 1u, std::memory_order_relaxed);
+  }
+
+  flushTxBatch();
+  _radioModuleConnector->sendFrame(buffer, len);
+  _udpToUartLatency.record(esp_timer_get_time() - timestamp);
+  stat_add(framesToUart, 1);
+  stat_add(bytesToUart, len);
+}
+
+void RawUartUdpListener::flushTxBatch() {
+  if (!_txBatchCount)
+    return;
+
+  _radioModuleConnector->sendFrames(_txBatch, _txBatchLengths, _txBatchCount);
+
+  int64_t now = esp_timer_get_time();
+  for (uint8_t i = 0; i < _txBatchCount; i++)
+    _udpToUartLatency.record(now - _txBatchTimestamps[i]);
+  stat_add(framesToUart, _txBatchCount);
+  stat_add(bytesToUart, _txBatchLen);
+  atomic_fetch_add_explicit(&_bulkTransferStatistics.batches, 1u, std::memory_order_relaxed);
+
+  _txBatchCount = 0;
+  _txBatchLen = 0;
+}
+
+void RawUartUdpListener::trackBulkTransfer(unsigned char *buffer, uint16_t len) {
+  HMFrame frame;
+  if (!HMFrame::TryParseHeader(buffer, len, &frame))
+    return;
+
+  int64_t now = esp_timer_get_time();
+
+  if ((frame.destination == HM_DST_COMMON && frame.command == HM_CMD_COMMON_START_BL) ||
+      (frame.destination == HM_DST_HMSYSTEM && frame.command == HM_CMD_HMSYSTEM_CHANGE_APP)) {
+    if (_bulkTransferState == BULK_TRANSFER_IDLE)
+      _bulkTransferState = BULK_TRANSFER_ARMED;
+    _bulkTransferStateTime = now;
+  } else if (frame.destination == HM_DST_COMMON && frame.command == HM_CMD_COMMON_START_APP) {
+    endBulkTransfer("application started");
+  } else if (_bulkTransferState == BULK_TRANSFER_ARMED && frame.data_len >= BULK_TRANSFER_MIN_FRAME_DATA) {
+    _bulkTransferState = BULK_TRANSFER_STREAMING;
+    _bulkTransferStart = now;
+    _bulkTransferStateTime = now;
+    _bulkTransferSessionFrames = 0;
+    atomic_fetch_add_explicit(&_bulkTransferStatistics.sessions, 1u, std::memory_order_relaxed);
+    _radioModuleConnector->setBulkTransfer(true);
+    trace_logi(_radioModuleConnector->getTraceLog(), _tag,
+               "Bulk transfer started, streaming frames to the radio module");
+  } else if (_bulkTransferState == BULK_TRANSFER_STREAMING) {
+    _bulkTransferStateTime = now;
+  }
+}
+
+void RawUartUdpListener::endBulkTransfer(const char *reason) {
+  if (_bulkTransferState == BULK_TRANSFER_STREAMING) {
+    flushTxBatch();
+    uint32_t duration = (esp_timer_get_time() - _bulkTransferStart) / 1000;
+    atomic_store_explicit(&_bulkTransferStatistics.lastDuration, duration, std::memory_order_relaxed);
+    _radioModuleConnector->setBulkTransfer(false);
+    ESP_LOGI(_tag, "Bulk transfer finished (%s), %u frames in %u ms", reason, _bulkTransferSessionFrames, duration);
+  }
+  _bulkTransferState = BULK_TRANSFER_IDLE;
+}
+
+udp_event_t *RawUartUdpListener::allocateEvent() {
+#ifdef USE_HM_RF_BRIDGE_STATIC_ALLOCATION
+  udp_event_t *event;
+  return xQueueReceive(_udpEventPool, &event, 0) == pdTRUE ? event : NULL;
+#else
+  return (udp_event_t *) malloc(sizeof(udp_event_t));
+#endif
+}
+
+void RawUartUdpListener::releaseEvent(udp_event_t *event) {
+#ifdef USE_HM_RF_BRIDGE_STATIC_ALLOCATION
+  xQueueSend(_udpEventPool, &event, 0);
+#else
+  free(event);
+#endif
+}
+
+void RawUartUdpListener::processEvent(udp_event_t *event) {
+  // frames collected for one UART write must not be overtaken by other packets
+  if (_txBatchCount && (event->pb->len < 1 || ((unsigned char *) event->pb->payload)[0] != 7))
+    flushTxBatch();
+  handlePacket(event->pb, event->addr, event->port, event->timestamp);
+  pbuf_free(event->pb);
+  releaseEvent(event);
+}
+
+bool RawUartUdpListener::scheduleFrame(udp_event_t *event) {
+  unsigned char *data = (unsigned char *) (event->pb->payload);
+  uint16_t length = event->pb->len;
+
+  if (length < 5 || data[0] != 7)
+    return false;
+
+  // a bulk transfer is the only traffic, its frames are batched in order once the scheduler ran empty
+  if (_bulkTransferState == BULK_TRANSFER_STREAMING && _txScheduler->isEmpty())
+    return false;
+
+  return _txScheduler->enqueue(_txScheduler->classify(&data[2], length - 4), event, esp_timer_get_time());
+}
+
+void RawUartUdpListener::flushTxScheduler() {
+  udp_event_t *event;
+  while ((event = (udp_event_t *) _txScheduler->dequeue(esp_timer_get_time())) != NULL)
+    processEvent(event);
 }
 
 void RawUartUdpListener::_udpQueueHandler() {
   udp_event_t *event = NULL;
-  int64_t nextKeepAliveSentOut = esp_timer_get_time();
 
   for (;;) {
-    if (xQueueReceive(_udp_queue, &event, (TickType_t) (100 / portTICK_PERIOD_MS)) == pdTRUE) {
-      handlePacket(event->pb, event->addr, event->port);
-      pbuf_free(event->pb);
-      free(event);
+    if (!_txScheduler) {
+      if (xQueueReceive(_udp_queue, &event, (TickType_t) (100 / portTICK_PERIOD_MS)) == pdTRUE) {
+        processEvent(event);
+        // while a bulk transfer streams, the frames already waiting are written to the UART at once
+        while (_txBatchCount && xQueueReceive(_udp_queue, &event, 0) == pdTRUE)
+          processEvent(event);
+      }
+    } else {
+      // While frames wait for the UART, newer packets are only collected so the next frame can be picked by class.
+      // Other packets keep their position relative to the frames, only keepalives and LED changes skip ahead.
+      TickType_t timeout = _txScheduler->isEmpty() ? (TickType_t) (100 / portTICK_PERIOD_MS) : 0;
+      while (!_txScheduler->isFull() && xQueueReceive(_udp_queue, &event, timeout) == pdTRUE) {
+        timeout = 0;
+        if (scheduleFrame(event))
+          continue;
+        uint8_t type = event->pb->len ? ((unsigned char *) event->pb->payload)[0] : 0;
+        if (type != 2 && type != 3)
+          flushTxScheduler();
+        processEvent(event);
+      }
+
+      if ((event = (udp_event_t *) _txScheduler->dequeue(esp_timer_get_time())) != NULL)
+        processEvent(event);
     }
+    handleTimeouts();
+  }
 
-    if (atomic_load(&_remotePort) != 0) {
-      int64_t now = esp_timer_get_time();
+  vTaskDelete(NULL);
+}
 
-      if (now > _lastReceivedKeepAlive + 5000000) {  // 5 sec
-        atomic_store(&_remotePort, (ushort) 0);
-        atomic_store(&_remoteAddress, 0u);
-        _radioModuleConnector->setLED(true, false, false);
-        ESP_LOGW(TAG, "Connection timed out");
-      }
+TickType_t RawUartUdpListener::handleTimeouts() {
+  flushTxBatch();
+
+  if (_bulkTransferState != BULK_TRANSFER_IDLE) {
+    int64_t now = esp_timer_get_time();
+    if (_bulkTransferState == BULK_TRANSFER_ARMED && now > _bulkTransferStateTime + BULK_TRANSFER_ARM_TIMEOUT)
+      _bulkTransferState = BULK_TRANSFER_IDLE;
+    else if (_bulkTransferState == BULK_TRANSFER_STREAMING && now > _bulkTransferStateTime + _bulkIdleTimeout)
+      endBulkTransfer("idle");
+  }
+
+  if (atomic_load(&_remotePort) != 0) {
+    int64_t now = esp_timer_get_time();
+
+    if (now > _lastReceivedKeepAlive + 5000000) {  // 5 sec
+      endBulkTransfer("connection timed out");
+      atomic_store(&_remotePort, (ushort) 0);
+      atomic_store(&_remoteAddress, 0u);
+      _radioModuleConnector->setLED(true, false, false);
+      if (_radioModuleConnector->getFlightRecorder())
+        _radioModuleConnector->getFlightRecorder()->trigger(FLIGHT_RECORDER_TRIGGER_CONNECTION_TIMEOUT);
+      trace_logw(_radioModuleConnector->getTraceLog(), _tag, "Connection timed out");
+    }
+
+    if (now > _nextKeepAliveSentOut) {
+      _nextKeepAliveSentOut = now + 1000000;  // 1sec
+      sendMessage(2, NULL, 0);
+      stat_add(keepAlivesSent, 1);
+    }
+  }
+
+  // nothing is due without a CCU, the next packet wakes the task
+  if (atomic_load(&_remotePort) == 0 && _bulkTransferState == BULK_TRANSFER_IDLE)
+    return portMAX_DELAY;
+  return (TickType_t) (100 / portTICK_PERIOD_MS);
+}
+
+void RawUartUdpListener::handleQueueItem() {
+  udp_event_t *event;
+  // the set reports every packet, so one is taken per call
+  if (xQueueReceive(_udp_queue, &event, 0) != pdTRUE)
+    return;
 
-      if (now > nextKeepAliveSentOut) {
-        nextKeepAliveSentOut = now + 1000000;  // 1sec
-        sendMessage(2, NULL, 0);
+  if (_txScheduler) {
+    // the UDP task leaves packets in the queue while the scheduler is full, here the best frame makes room instead
+    if (_txScheduler->isFull())
+      processEvent((udp_event_t *) _txScheduler->dequeue(esp_timer_get_time()));
+    if (scheduleFrame(event))
+      return;
+    uint8_t type = event->pb->len ? ((unsigned char *) event->pb->payload)[0] : 0;
+    if (type != 2 && type != 3)
+      flushTxScheduler();
+  }
+  processEvent(event);
+}
+
+TickType_t RawUartUdpListener::handleDeadlines() {
+  if (_txScheduler) {
+    udp_event_t *event = (udp_event_t *) _txScheduler->dequeue(esp_timer_get_time());
+    if (event)
+      processEvent(event);
+  }
+
+  // while a bulk transfer streams, the frames already waiting are written to the UART at once
+  if (_txBatchCount && uxQueueMessagesWaiting(_udp_queue))
+    return 0;
+
+  TickType_t timeout = handleTimeouts();
+  // frames waiting in the scheduler go out one per wake-up, newer packets are picked up in between
+  return _txScheduler && !_txScheduler->isEmpty() ? 0 : timeout;
+}
+
+void RawUartUdpListener::_pipelineHandler() {
+  pbuf *pbs[RAW_UART_PIPELINE_MAX_BATCH];
+  uint32_t receiveTimes[RAW_UART_PIPELINE_MAX_BATCH];
+
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+    // frames queued while the last batch was sent go out together, one round trip to the tcpip thread per batch
+    for (;;) {
+      uint8_t count = 0;
+      uint32_t bytes = 0;
+      const unsigned char *frame;
+      uint16_t len;
+
+      while (count < RAW_UART_PIPELINE_MAX_BATCH && (frame = _pipeline->front(&len, &receiveTimes[count])) != NULL) {
+        pbs[count] = createMessage(7, frame, len);
+        _pipeline->pop();
+        if (pbs[count]) {
+          bytes += len;
+          count++;
+        }
       }
+
+      if (!count)
+        break;
+
+      sendMessages(pbs, count);
+
+      uint32_t now = (uint32_t) esp_timer_get_time();
+      for (uint8_t i = 0; i < count; i++)
+        _uartToUdpLatency.record(now - receiveTimes[i]);
+      stat_add(framesToUdp, count);
+      stat_add(bytesToUdp, bytes);
     }
   }
 
@@ -277,12 +689,13 @@ void RawUartUdpListener::_udpQueueHandler() {
 }
 
 bool RawUartUdpListener::_udpReceivePacket(pbuf *pb, const ip_addr_t *addr, uint16_t port) {
-  udp_event_t *e = (udp_event_t *) malloc(sizeof(udp_event_t));
+  udp_event_t *e = allocateEvent();
   if (!e) {
     return false;
   }
 
   e->pb = pb;
+  e->timestamp = esp_timer_get_time();
 
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wpointer-arith"
@@ -295,8 +708,9 @@ bool RawUartUdpListener::_udpReceivePacket(pbuf *pb, const ip_addr_t *addr, uint
 
 #pragma GCC diagnostic pop
 
-  if (xQueueSend(_udp_queue, &e, portMAX_DELAY) != pdPASS) {
-    free((void *) (e));
+  // the UART task waits for the tcpip thread when it sends, so in the single task mode full queues drop the packet
+  if (xQueueSend(_udp_queue, &e, _singleTask ? 0 : portMAX_DELAY) != pdPASS) {
+    releaseEvent(e);
     return false;
   }
   return true;
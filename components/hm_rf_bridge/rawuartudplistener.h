@@ -25,35 +25,196 @@
 #include <atomic>
 #define _Atomic(X) std::atomic<X>
 #include "radiomoduleconnector.h"
+#include "latencyhistogram.h"
+#include "txscheduler.h"
+#include "framering.h"
 
-class RawUartUdpListener : FrameHandler {
+#define RAW_UART_DEFAULT_PORT 3008
+#define RAW_UART_UDP_LISTENER_STACK_SIZE 4096
+#define UDP_QUEUE_LENGTH 32
+#define RAW_UART_PIPELINE_STACK_SIZE 3072
+#define RAW_UART_PIPELINE_MAX_BATCH 8  // frames handed to the tcpip thread at once
+
+#ifdef USE_HM_RF_BRIDGE_STATIC_ALLOCATION
+// packets in the queue, held back by the TX scheduler, being handled and waiting in the receive callback
+#define UDP_EVENT_POOL_SIZE (UDP_QUEUE_LENGTH + TX_SCHEDULER_CAPACITY + 2)
+#ifndef HM_RF_BRIDGE_STATIC_BULK_BATCH_SIZE
+#define HM_RF_BRIDGE_STATIC_BULK_BATCH_SIZE 0  // generated from bulk_transfer.batch_size
+#endif
+#ifndef HM_RF_BRIDGE_STATIC_PIPELINE_SIZE
+#define HM_RF_BRIDGE_STATIC_PIPELINE_SIZE 0  // generated from pipeline.ring_size
+#endif
+#ifndef HM_RF_BRIDGE_STATIC_SINGLE_TASK
+#define HM_RF_BRIDGE_STATIC_SINGLE_TASK 0  // generated, 1 if all instances use single_task
+#endif
+#endif
+
+static_assert(UDP_QUEUE_LENGTH <= EVENT_LOOP_QUEUE_LENGTH, "the UDP queue does not fit into the UART task queue set");
+
+typedef struct {
+  pbuf *pb;
+  ip4_addr_t addr;
+  uint16_t port;
+  int64_t timestamp;
+} udp_event_t;
+
+typedef struct {
+  std::atomic<uint32_t> framesToUdp{0};
+  std::atomic<uint32_t> bytesToUdp{0};
+  std::atomic<uint32_t> framesToUart{0};
+  std::atomic<uint32_t> bytesToUart{0};
+  std::atomic<uint32_t> keepAlivesSent{0};
+  std::atomic<uint32_t> keepAlivesReceived{0};
+  std::atomic<uint32_t> droppedOversized{0};
+  std::atomic<uint32_t> droppedNotConnected{0};
+  std::atomic<uint32_t> droppedCrc{0};
+  std::atomic<uint32_t> droppedPipelineFull{0};
+} raw_uart_statistics_t;
+
+#define BULK_TRANSFER_MAX_BATCH_FRAMES 16
+#define BULK_TRANSFER_MIN_FRAME_DATA 32      // data bytes of a frame carrying firmware data
+#define BULK_TRANSFER_ARM_TIMEOUT 5000000    // us from the bootloader command to the first firmware data frame
+#define BULK_TRANSFER_DEFAULT_IDLE_TIMEOUT 2000000  // us
+
+typedef enum { BULK_TRANSFER_IDLE, BULK_TRANSFER_ARMED, BULK_TRANSFER_STREAMING } bulk_transfer_state_t;
+
+typedef struct {
+  std::atomic<uint32_t> sessions{0};
+  std::atomic<uint32_t> frames{0};
+  std::atomic<uint32_t> bytes{0};
+  std::atomic<uint32_t> batches{0};       // UART writes, frames / batches is the average batch
+  std::atomic<uint32_t> lastDuration{0};  // ms
+} bulk_transfer_statistics_t;
+
+class RawUartUdpListener : FrameHandler, EventLoopHandler {
  private:
   RadioModuleConnector *_radioModuleConnector;
+  uint16_t _port{RAW_UART_DEFAULT_PORT};
+  char _tag[LOG_TAG_SIZE];
   std::atomic<uint> _remoteAddress;
   std::atomic<ushort> _remotePort;
   std::atomic<bool> _connectionStarted;
   std::atomic<int> _counter;
   std::atomic<int> _endpointConnectionIdentifier;
   uint64_t _lastReceivedKeepAlive;
+  int64_t _nextKeepAliveSentOut{0};
   udp_pcb *_pcb;
   QueueHandle_t _udp_queue;
   TaskHandle_t _tHandle = NULL;
+  bool _singleTask{false};  // the UART task serves the UDP queue
+  raw_uart_statistics_t _statistics;
+  LatencyHistogram _uartToUdpLatency;  // UART event -> UDP packet handed to lwIP
+  LatencyHistogram _udpSendLatency;    // time spent in _udp_sendto
+  LatencyHistogram _udpToUartLatency;  // lwIP receive callback -> uart_write_bytes
+  TxScheduler *_txScheduler{nullptr};
+  size_t _bulkBatchSize{0};
+  uint32_t _bulkIdleTimeout{BULK_TRANSFER_DEFAULT_IDLE_TIMEOUT};
+  bulk_transfer_state_t _bulkTransferState{BULK_TRANSFER_IDLE};
+  int64_t _bulkTransferStateTime{0};  // when armed or the last frame was streamed
+  int64_t _bulkTransferStart{0};
+  uint32_t _bulkTransferSessionFrames{0};
+  bulk_transfer_statistics_t _bulkTransferStatistics;
+  unsigned char *_txBatch{nullptr};
+  uint16_t _txBatchLen{0};
+  uint8_t _txBatchCount{0};
+  uint16_t _txBatchLengths[BULK_TRANSFER_MAX_BATCH_FRAMES];
+  int64_t _txBatchTimestamps[BULK_TRANSFER_MAX_BATCH_FRAMES];
+  size_t _pipelineSize{0};
+  BaseType_t _pipelineCore{tskNO_AFFINITY};
+  FrameRing *_pipeline{nullptr};
+  uint8_t *_pipelineBuffer{nullptr};
+  TaskHandle_t _pipelineHandle{nullptr};
+
+#ifdef USE_HM_RF_BRIDGE_STATIC_ALLOCATION
+  // everything the listener creates lives in the object itself, packets are tracked in a fixed pool
+#if !HM_RF_BRIDGE_STATIC_SINGLE_TASK
+  StaticTask_t _taskBuffer;
+  StackType_t _taskStack[RAW_UART_UDP_LISTENER_STACK_SIZE];
+#endif
+  StaticQueue_t _udpQueueBuffer;
+  uint8_t _udpQueueStorage[UDP_QUEUE_LENGTH * sizeof(udp_event_t *)];
+  udp_event_t _udpEvents[UDP_EVENT_POOL_SIZE];
+  QueueHandle_t _udpEventPool{nullptr};  // free entries of _udpEvents
+  StaticQueue_t _udpEventPoolBuffer;
+  uint8_t _udpEventPoolStorage[UDP_EVENT_POOL_SIZE * sizeof(udp_event_t *)];
+#if HM_RF_BRIDGE_STATIC_BULK_BATCH_SIZE > 0
+  unsigned char _txBatchStorage[HM_RF_BRIDGE_STATIC_BULK_BATCH_SIZE];
+#endif
+#if HM_RF_BRIDGE_STATIC_PIPELINE_SIZE > 0
+  StaticTask_t _pipelineTaskBuffer;
+  StackType_t _pipelineTaskStack[RAW_UART_PIPELINE_STACK_SIZE];
+  alignas(FrameRing) uint8_t _pipelineStorage[sizeof(FrameRing)];
+  alignas(FRAME_RING_ALIGNMENT) uint8_t _pipelineBufferStorage[HM_RF_BRIDGE_STATIC_PIPELINE_SIZE];
+#endif
+#endif
 
-  void handlePacket(pbuf *pb, ip4_addr_t addr, uint16_t port);
+  void handlePacket(pbuf *pb, ip4_addr_t addr, uint16_t port, int64_t timestamp);
+  udp_event_t *allocateEvent();
+  void releaseEvent(udp_event_t *event);
+  void processEvent(udp_event_t *event);
+  bool scheduleFrame(udp_event_t *event);
+  void flushTxScheduler();
+  // Batches, bulk transfer and connection timeouts, keepalives. Returns the ticks until it has to run again.
+  TickType_t handleTimeouts();
+  void forwardFrame(unsigned char *buffer, uint16_t len, int64_t timestamp);
+  void flushTxBatch();
+  void trackBulkTransfer(unsigned char *buffer, uint16_t len);
+  void endBulkTransfer(const char *reason);
+  pbuf *createMessage(unsigned char command, const unsigned char *buffer, size_t len);
   void sendMessage(unsigned char command, unsigned char *buffer, size_t len);
+  // Sends and frees the packets
+  void sendMessages(pbuf **pbs, uint8_t count);
 
  public:
   RawUartUdpListener(RadioModuleConnector *radioModuleConnector);
 
   void handleFrame(unsigned char *buffer, uint16_t len);
-  void handleEvent();
+  // Single task mode, called from the UART task
+  void handleQueueItem();
+  TickType_t handleDeadlines();
 
   ip4_addr_t getConnectedRemoteAddress();
   bool isConnected();
+  const raw_uart_statistics_t &getStatistics() { return _statistics; }
+  LatencyHistogram &getUartToUdpLatency() { return _uartToUdpLatency; }
+  LatencyHistogram &getUdpSendLatency() { return _udpSendLatency; }
+  LatencyHistogram &getUdpToUartLatency() { return _udpToUartLatency; }
+  void resetLatency();
+
+  // Orders frames to the radio module by class while the UART is busy, must be set before start()
+  void setTxScheduler(TxScheduler *txScheduler) { _txScheduler = txScheduler; }
+  TxScheduler *getTxScheduler() { return _txScheduler; }
+
+  // Streams coprocessor firmware updates: after a bootloader command, firmware data frames are written to the UART
+  // in batches of up to batchSize bytes and frame logging pauses, until no frame arrived for idleTimeout us.
+  // Must be set before start(), a batchSize of 0 disables the detection.
+  void setBulkTransfer(size_t batchSize, uint32_t idleTimeout) {
+    _bulkBatchSize = batchSize;
+    _bulkIdleTimeout = idleTimeout;
+  }
+  size_t getBulkBatchSize() { return _bulkBatchSize; }
+  uint32_t getBulkIdleTimeout() { return _bulkIdleTimeout; }
+  bool isBulkTransfer() { return _radioModuleConnector->isBulkTransfer(); }
+  const bulk_transfer_statistics_t &getBulkTransferStatistics() { return _bulkTransferStatistics; }
+
+  // Splits the path from the radio module: the UART task only parses frames and queues them in a ring of size bytes,
+  // a network task pinned to core sends them. A size of 0 sends from the UART task, must be set before start().
+  void setPipeline(size_t size, BaseType_t core) {
+    _pipelineSize = size;
+    _pipelineCore = core < portNUM_PROCESSORS ? core : tskNO_AFFINITY;
+  }
+  BaseType_t getPipelineCore() { return _pipelineCore; }
+  // NULL unless the pipeline runs
+  FrameRing *getPipeline() { return _pipeline; }
+
+  // UDP port the CCU connects to, must be set before start()
+  void setPort(uint16_t port);
+  uint16_t getPort() { return _port; }
 
   void start();
   void stop();
 
   void _udpQueueHandler();
+  void _pipelineHandler();
   bool _udpReceivePacket(pbuf *pb, const ip_addr_t *addr, uint16_t port);
 };
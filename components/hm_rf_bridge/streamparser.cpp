@@ -19,14 +19,24 @@
 #include "streamparser.h"
 
 StreamParser::StreamParser(bool decodeEscaped, std::function<void(unsigned char *buffer, uint16_t len)> processor)
-    : _bufferPos(0), _state(NO_DATA), _isEscaped(false), _decodeEscaped(decodeEscaped), _processor(processor) {}
+    : _bufferPos(0),
+      _state(NO_DATA),
+      _isEscaped(false),
+      _decodeEscaped(decodeEscaped),
+      _receiveTime(0),
+      _frameReceiveTime(0),
+      _resyncCount(0),
+      _processor(processor) {}
 
 void StreamParser::append(unsigned char chr) {
   switch (chr) {
     case 0xfd:
+      if (_state != NO_DATA && _state != FRAME_COMPLETE)
+        _resyncCount++;
       _bufferPos = 0;
       _isEscaped = false;
       _state = RECEIVE_LENGTH_HIGH_BYTE;
+      _frameReceiveTime = _receiveTime;
       break;
 
     case 0xfc:
@@ -82,10 +92,27 @@ void StreamParser::append(unsigned char *buffer, uint16_t len) {
   }
 }
 
-void StreamParser::flush() {
+uint16_t StreamParser::flush() {
+  uint16_t discarded = (_state == NO_DATA || _state == FRAME_COMPLETE) ? 0 : _bufferPos;
+
   _state = NO_DATA;
   _bufferPos = 0;
   _isEscaped = false;
+
+  return discarded;
+}
+
+uint16_t StreamParser::remaining() {
+  switch (_state) {
+    case RECEIVE_LENGTH_HIGH_BYTE:
+      return 2;
+    case RECEIVE_LENGTH_LOW_BYTE:
+      return 1;
+    case RECEIVE_FRAME_DATA:
+      return _frameLength - _framePos;
+    default:
+      return 0;
+  }
 }
 
 bool StreamParser::getDecodeEscaped() { return _decodeEscaped; }
@@ -32,6 +32,9 @@ class StreamParser {
   state_t _state;
   bool _isEscaped;
   bool _decodeEscaped;
+  int64_t _receiveTime;
+  int64_t _frameReceiveTime;
+  uint32_t _resyncCount;
   std::function<void(unsigned char *buffer, uint16_t len)> _processor;
 
  public:
@@ -39,7 +42,18 @@ class StreamParser {
 
   void append(unsigned char chr);
   void append(unsigned char *buffer, uint16_t len);
-  void flush();
+  // Drops the frame in progress, returns the number of bytes discarded
+  uint16_t flush();
+
+  // Lower bound of bytes still missing to complete the current frame (escape bytes not included)
+  uint16_t remaining();
+
+  // Timestamp of the data appended next, a frame keeps the timestamp of the data its start byte was part of
+  void setReceiveTime(int64_t receiveTime) { _receiveTime = receiveTime; }
+  int64_t getFrameReceiveTime() { return _frameReceiveTime; }
+
+  // Number of frames cut off by the start byte of the next frame
+  uint32_t getResyncCount() { return _resyncCount; }
 
   bool getDecodeEscaped();
   void setDecodeEscaped(bool decodeEscaped);
@@ -0,0 +1,127 @@
+#include "tracelog.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <esp_timer.h>
+
+static const char *TAG = "TraceLog";
+
+TraceLog::TraceLog(uint32_t capacity) {
+  _capacity = 1;
+  while (_capacity < capacity)
+    _capacity <<= 1;
+
+  _records = (trace_record_t *) calloc(_capacity, sizeof(trace_record_t));
+  if (!_records) {
+    ESP_LOGE(TAG, "Could not allocate %u records", _capacity);
+    return;
+  }
+  for (uint32_t i = 0; i < _capacity; i++)
+    atomic_init(&_records[i].sequence, i);
+}
+
+TraceLog::~TraceLog() { free(_records); }
+
+trace_record_t *TraceLog::_acquire() {
+  if (!_records)
+    return nullptr;
+
+  // bounded multi producer queue: a slot is free for position pos once its sequence equals pos
+  uint32_t pos = atomic_load_explicit(&_head, std::memory_order_relaxed);
+  for (;;) {
+    trace_record_t *record = &_records[pos & (_capacity - 1)];
+    int32_t diff = (int32_t) (atomic_load_explicit(&record->sequence, std::memory_order_acquire) - pos);
+    if (diff == 0) {
+      if (atomic_compare_exchange_weak_explicit(&_head, &pos, pos + 1, std::memory_order_relaxed,
+                                                std::memory_order_relaxed)) {
+        record->timestamp = esp_timer_get_time();
+        return record;
+      }
+    } else if (diff < 0) {
+      atomic_fetch_add_explicit(&_dropped, 1u, std::memory_order_relaxed);
+      return nullptr;
+    } else {
+      pos = atomic_load_explicit(&_head, std::memory_order_relaxed);
+    }
+  }
+}
+
+void TraceLog::_commit(trace_record_t *record) {
+  uint32_t pos = atomic_load_explicit(&record->sequence, std::memory_order_relaxed);
+  atomic_store_explicit(&record->sequence, pos + 1, std::memory_order_release);
+}
+
+void TraceLog::recordFrame(uint8_t level, const char *tag, const char *text, const unsigned char *buffer,
+                           uint16_t len) {
+  trace_record_t *record = _acquire();
+  if (!record)
+    return;
+
+  record->tag = tag;
+  record->format = text;
+  record->level = level;
+  record->isFrame = true;
+  record->frameLen = len;
+  memcpy(record->frame, buffer, len < TRACE_LOG_FRAME_BYTES ? len : TRACE_LOG_FRAME_BYTES);
+  _commit(record);
+}
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wformat-nonliteral"
+#pragma GCC diagnostic ignored "-Wformat-security"
+
+size_t TraceLog::format(const trace_record_t *record, char *buffer, size_t size) {
+  int len;
+
+  if (!record->isFrame) {
+    len = snprintf(buffer, size, record->format, record->args[0], record->args[1], record->args[2], record->args[3]);
+    return len < 0 ? 0 : ((size_t) len < size ? len : size - 1);
+  }
+
+  len = snprintf(buffer, size, "%s (%u bytes)", record->format, record->frameLen);
+  uint16_t captured = record->frameLen < TRACE_LOG_FRAME_BYTES ? record->frameLen : TRACE_LOG_FRAME_BYTES;
+  for (uint16_t i = 0; i < captured && len >= 0 && (size_t) len + 4 < size; i++)
+    len += snprintf(buffer + len, size - len, " %02X", record->frame[i]);
+  if (captured < record->frameLen && len >= 0 && (size_t) len + 5 < size)
+    len += snprintf(buffer + len, size - len, " ...");
+  return len < 0 ? 0 : ((size_t) len < size ? len : size - 1);
+}
+
+#pragma GCC diagnostic pop
+
+uint32_t TraceLog::flush(uint32_t maxRecords) {
+  char text[TRACE_LOG_MAX_TEXT];
+  uint32_t count = 0;
+
+  if (!_records)
+    return 0;
+
+  while (count < maxRecords) {
+    trace_record_t *record = &_records[_tail & (_capacity - 1)];
+    if (atomic_load_explicit(&record->sequence, std::memory_order_acquire) != _tail + 1)
+      break;
+
+    format(record, text, sizeof(text));
+    // the time the event happened, the log line itself is written later
+    long long seconds = record->timestamp / 1000000, micros = record->timestamp % 1000000;
+    switch (record->level) {
+      case ESPHOME_LOG_LEVEL_ERROR:
+        ESP_LOGE(record->tag, "[%lld.%06lld] %s", seconds, micros, text);
+        break;
+      case ESPHOME_LOG_LEVEL_WARN:
+        ESP_LOGW(record->tag, "[%lld.%06lld] %s", seconds, micros, text);
+        break;
+      case ESPHOME_LOG_LEVEL_INFO:
+        ESP_LOGI(record->tag, "[%lld.%06lld] %s", seconds, micros, text);
+        break;
+      default:
+        ESP_LOGD(record->tag, "[%lld.%06lld] %s", seconds, micros, text);
+        break;
+    }
+
+    atomic_store_explicit(&record->sequence, _tail + _capacity, std::memory_order_release);
+    _tail++;
+    count++;
+  }
+  return count;
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include "esphome/core/log.h"
+
+#define TRACE_LOG_MAX_ARGS 4
+#define TRACE_LOG_FRAME_BYTES 32  // frame records keep the start of the frame, the length is kept in full
+#define TRACE_LOG_MAX_TEXT 160
+
+typedef struct {
+  int64_t timestamp;
+  std::atomic<uint32_t> sequence;  // position the slot is free for, position + 1 once written
+  const char *tag;
+  const char *format;  // string literal, for frame records the text in front of the bytes
+  uint8_t level;
+  bool isFrame;
+  uint16_t frameLen;
+  union {
+    uint32_t args[TRACE_LOG_MAX_ARGS];
+    uint8_t frame[TRACE_LOG_FRAME_BYTES];
+  };
+} trace_record_t;
+
+// Deferred log of the bridge tasks. Hot paths only copy the format pointer and the raw arguments or frame bytes into
+// a fixed size lock-free ring, records are formatted and written to the log later by flush() from the ESPHome loop
+// (or the main loop of the host build). Records are dropped and counted when the ring is full. Formats may only use
+// 32 bit integer conversions.
+class TraceLog {
+ private:
+  trace_record_t *_records;
+  uint32_t _capacity;  // power of two
+  std::atomic<uint32_t> _head{0};
+  uint32_t _tail{0};
+  std::atomic<uint32_t> _dropped{0};
+
+  trace_record_t *_acquire();
+  void _commit(trace_record_t *record);
+
+ public:
+  TraceLog(uint32_t capacity);
+  ~TraceLog();
+
+  // Called from any task, never blocks
+  template<typename... Args> void record(uint8_t level, const char *tag, const char *format, Args... args) {
+    static_assert(sizeof...(Args) <= TRACE_LOG_MAX_ARGS, "too many trace log arguments");
+    trace_record_t *slot = _acquire();
+    if (!slot)
+      return;
+    slot->tag = tag;
+    slot->format = format;
+    slot->level = level;
+    slot->isFrame = false;
+    uint32_t values[TRACE_LOG_MAX_ARGS] = {(uint32_t) args...};
+    for (int i = 0; i < TRACE_LOG_MAX_ARGS; i++)
+      slot->args[i] = values[i];
+    _commit(slot);
+  }
+  void recordFrame(uint8_t level, const char *tag, const char *text, const unsigned char *buffer, uint16_t len);
+
+  // Formats and logs up to maxRecords records, returns the number of records written. Single consumer.
+  uint32_t flush(uint32_t maxRecords);
+
+  uint32_t getCapacity() { return _capacity; }
+  uint32_t getDropped() { return atomic_load_explicit(&_dropped, std::memory_order_relaxed); }
+
+  static size_t format(const trace_record_t *record, char *buffer, size_t size);
+};
+
+// Log through the trace log if there is one, directly otherwise
+#define trace_log_(__traceLog, __level, __log, __tag, __format, ...) \
+  do { \
+    TraceLog *__trace = (__traceLog); \
+    if (__trace) \
+      __trace->record(__level, __tag, __format, ##__VA_ARGS__); \
+    else \
+      __log(__tag, __format, ##__VA_ARGS__); \
+  } while (0)
+
+#define trace_logw(__traceLog, __tag, __format, ...) \
+  trace_log_(__traceLog, ESPHOME_LOG_LEVEL_WARN, ESP_LOGW, __tag, __format, ##__VA_ARGS__)
+#define trace_logi(__traceLog, __tag, __format, ...) \
+  trace_log_(__traceLog, ESPHOME_LOG_LEVEL_INFO, ESP_LOGI, __tag, __format, ##__VA_ARGS__)
+#define trace_logd(__traceLog, __tag, __format, ...) \
+  trace_log_(__traceLog, ESPHOME_LOG_LEVEL_DEBUG, ESP_LOGD, __tag, __format, ##__VA_ARGS__)
@@ -0,0 +1,97 @@
+#include "txscheduler.h"
+#include "hmframe.h"
+#include <stddef.h>
+
+TxScheduler::TxScheduler(uint32_t agingTime, uint16_t bulkThreshold)
+    : _agingTime(agingTime), _bulkThreshold(bulkThreshold) {}
+
+tx_class_t TxScheduler::classify(const unsigned char *buffer, uint16_t len) {
+  HMFrame frame;
+
+  // unparsable frames are rejected by the module, passing them quickly is the cheapest way to get the error back
+  if (!HMFrame::TryParseHeader(buffer, len, &frame))
+    return TX_CLASS_CONTROL;
+
+  if (frame.data_len >= _bulkThreshold)
+    return TX_CLASS_BULK;
+
+  if ((frame.destination == HM_DST_HMIP && frame.command == HM_CMD_HMIP_SEND) ||
+      (frame.destination == HM_DST_LLMAC && frame.data_len >= HM_LLMAC_MIN_RADIO_FRAME_LEN))
+    return TX_CLASS_INTERACTIVE;
+
+  return TX_CLASS_CONTROL;
+}
+
+bool TxScheduler::enqueue(tx_class_t txClass, void *item, int64_t now) {
+  if (isFull())
+    return false;
+
+  // every class queue holds the full capacity, so only the total needs to be checked
+  tx_scheduler_entry_t &entry = _queues[txClass][(_head[txClass] + _count[txClass]) % TX_SCHEDULER_CAPACITY];
+  entry.item = item;
+  entry.enqueued = now;
+  _count[txClass]++;
+  _total++;
+
+  tx_class_statistics_t &statistics = _statistics[txClass];
+  atomic_store_explicit(&statistics.depth, (uint32_t) _count[txClass], std::memory_order_relaxed);
+  if (_count[txClass] > atomic_load_explicit(&statistics.maxDepth, std::memory_order_relaxed))
+    atomic_store_explicit(&statistics.maxDepth, (uint32_t) _count[txClass], std::memory_order_relaxed);
+  return true;
+}
+
+void *TxScheduler::dequeue(int64_t now) {
+  int selected = -1;
+  bool aged = false;
+
+  for (int txClass = 0; txClass < TX_CLASSES; txClass++) {
+    if (!_count[txClass])
+      continue;
+
+    if (selected < 0) {
+      selected = txClass;
+    } else if (now - _queues[txClass][_head[txClass]].enqueued >= _agingTime &&
+               _queues[txClass][_head[txClass]].enqueued < _queues[selected][_head[selected]].enqueued) {
+      // the oldest aged frame of the lower classes goes first
+      selected = txClass;
+      aged = true;
+    }
+  }
+
+  if (selected < 0)
+    return NULL;
+
+  tx_scheduler_entry_t &entry = _queues[selected][_head[selected]];
+  _head[selected] = (_head[selected] + 1) % TX_SCHEDULER_CAPACITY;
+  _count[selected]--;
+  _total--;
+
+  tx_class_statistics_t &statistics = _statistics[selected];
+  atomic_store_explicit(&statistics.depth, (uint32_t) _count[selected], std::memory_order_relaxed);
+  atomic_fetch_add_explicit(&statistics.frames, 1u, std::memory_order_relaxed);
+  if (aged)
+    atomic_fetch_add_explicit(&statistics.aged, 1u, std::memory_order_relaxed);
+  _queueTime[selected].record(now - entry.enqueued);
+
+  return entry.item;
+}
+
+void TxScheduler::resetLatency() {
+  for (int txClass = 0; txClass < TX_CLASSES; txClass++) {
+    _queueTime[txClass].reset();
+    atomic_store_explicit(&_statistics[txClass].maxDepth, 0u, std::memory_order_relaxed);
+  }
+}
+
+const char *TxScheduler::getClassName(tx_class_t txClass) {
+  switch (txClass) {
+    case TX_CLASS_CONTROL:
+      return "control";
+    case TX_CLASS_INTERACTIVE:
+      return "interactive";
+    case TX_CLASS_BULK:
+      return "bulk";
+    default:
+      return "unknown";
+  }
+}
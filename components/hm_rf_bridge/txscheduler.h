@@ -0,0 +1,68 @@
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include "latencyhistogram.h"
+
+#define TX_SCHEDULER_CAPACITY 32  // frames held back while the UART is busy, over all classes
+#define TX_SCHEDULER_DEFAULT_AGING_TIME 100000  // us
+#define TX_SCHEDULER_DEFAULT_BULK_THRESHOLD 40  // frame data bytes
+
+typedef enum {
+  TX_CLASS_CONTROL = 0,      // module management: identify, versions, keys, addresses, bootloader and app switches
+  TX_CLASS_INTERACTIVE = 1,  // short radio frames: actuator commands, ACKs
+  TX_CLASS_BULK = 2,         // long frames: device firmware and configuration transfers, coprocessor updates
+  TX_CLASSES = 3,
+} tx_class_t;
+
+typedef struct {
+  void *item;
+  int64_t enqueued;
+} tx_scheduler_entry_t;
+
+typedef struct {
+  std::atomic<uint32_t> frames{0};
+  std::atomic<uint32_t> depth{0};
+  std::atomic<uint32_t> maxDepth{0};
+  std::atomic<uint32_t> aged{0};  // sent ahead of a higher class after waiting for the aging time
+} tx_class_statistics_t;
+
+// Orders the frames waiting for the UART by class with strict priority. A frame of a lower class that waited for the
+// aging time is sent ahead of the higher classes, so bulk transfers keep progressing under interactive load. Frames
+// of one class keep their order. enqueue() and dequeue() are called from the UDP task, the statistics are read from
+// the ESPHome loop.
+class TxScheduler {
+ private:
+  int64_t _agingTime;
+  uint16_t _bulkThreshold;
+  tx_scheduler_entry_t _queues[TX_CLASSES][TX_SCHEDULER_CAPACITY];
+  uint8_t _head[TX_CLASSES]{};
+  uint8_t _count[TX_CLASSES]{};
+  uint8_t _total{0};
+  tx_class_statistics_t _statistics[TX_CLASSES];
+  LatencyHistogram _queueTime[TX_CLASSES];
+
+ public:
+  TxScheduler(uint32_t agingTime = TX_SCHEDULER_DEFAULT_AGING_TIME,
+              uint16_t bulkThreshold = TX_SCHEDULER_DEFAULT_BULK_THRESHOLD);
+
+  // Class of an escaped frame starting with 0xfd
+  tx_class_t classify(const unsigned char *buffer, uint16_t len);
+
+  // Returns false if the scheduler is full, the item stays with the caller then
+  bool enqueue(tx_class_t txClass, void *item, int64_t now);
+  // Next item to send or NULL
+  void *dequeue(int64_t now);
+
+  bool isEmpty() { return _total == 0; }
+  bool isFull() { return _total >= TX_SCHEDULER_CAPACITY; }
+
+  uint32_t getAgingTime() { return _agingTime; }
+  uint16_t getBulkThreshold() { return _bulkThreshold; }
+  const tx_class_statistics_t &getStatistics(tx_class_t txClass) { return _statistics[txClass]; }
+  // Time from enqueue() to dequeue() in us, reset together with the peak depths
+  LatencyHistogram &getQueueTime(tx_class_t txClass) { return _queueTime[txClass]; }
+  void resetLatency();
+
+  static const char *getClassName(tx_class_t txClass);
+};
@@ -39,12 +39,6 @@ typedef struct {
   void *recv_arg;
 } udp_recv_api_call_t;
 
-typedef struct {
-  pbuf *pb;
-  ip4_addr_t addr;
-  uint16_t port;
-} udp_event_t;
-
 static err_t _udp_remove_api(struct tcpip_api_call_data *api_call_msg) {
   udp_api_call_t *msg = (udp_api_call_t *) api_call_msg;
   msg->err = 0;
@@ -115,6 +109,40 @@ static err_t _udp_sendto(struct udp_pcb *pcb, struct pbuf *pb, const ip_addr_t *
   return msg.err;
 }
 
+typedef struct {
+  struct tcpip_api_call_data call;
+  udp_pcb *pcb;
+  const ip_addr_t *addr;
+  uint16_t port;
+  struct pbuf **pbs;
+  uint8_t count;
+  err_t err;
+} udp_batch_api_call_t;
+
+static err_t _udp_sendto_batch_api(struct tcpip_api_call_data *api_call_msg) {
+  udp_batch_api_call_t *msg = (udp_batch_api_call_t *) api_call_msg;
+  msg->err = ERR_OK;
+  for (uint8_t i = 0; i < msg->count; i++) {
+    err_t err = udp_sendto(msg->pcb, msg->pbs[i], msg->addr, msg->port);
+    if (err != ERR_OK)
+      msg->err = err;
+  }
+  return msg->err;
+}
+
+// Sends several packets with a single round trip to the tcpip thread
+static err_t _udp_sendto_batch(struct udp_pcb *pcb, struct pbuf **pbs, uint8_t count, const ip_addr_t *addr,
+                               u16_t port) {
+  udp_batch_api_call_t msg;
+  msg.pcb = pcb;
+  msg.addr = addr;
+  msg.port = port;
+  msg.pbs = pbs;
+  msg.count = count;
+  tcpip_api_call(_udp_sendto_batch_api, &msg.call);
+  return msg.err;
+}
+
 static err_t _udp_recv_api(struct tcpip_api_call_data *api_call_msg) {
   udp_recv_api_call_t *msg = (udp_recv_api_call_t *) api_call_msg;
   udp_recv(msg->pcb, msg->recv, msg->recv_arg);
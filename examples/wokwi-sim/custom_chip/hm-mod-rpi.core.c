@@ -0,0 +1,622 @@
+/*-----------------------------------------------------------------------------
+ * HM-MOD-RPI simulation core, shared by the Wokwi custom chip and the host
+ * module emulator (host/hm_fake_module.c)
+ *
+ * Copyright (c) 2026 Zinar Sisamci
+ * Author: Zinar Sisamci
+
+ * Based on alexreinert/piVCCU (kernel/fake_hmrf.c)
+ * Copyright (c) 2025 by Alexander Reinert
+ * Author: Alexander Reinert
+ * Uses parts of bcm2835_raw_uart.c. (c) 2015 by eQ-3 Entwicklung GmbH
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *---------------------------------------------------------------------------*/
+
+#include "hm-mod-rpi.core.h"
+#include <stdio.h>
+#include <string.h>
+
+#define CRC_SEED 0xffff // initial crc with start byte 0xfd included
+
+#define IDX_DESTINATION 0
+#define IDX_COUNTER 1
+#define IDX_COMMAND 2
+
+// command, type, data
+// HMSYSTEM ACK: 0x04
+static uint8_t system_identify_response[] = {0x04, 0x02, 0x43, 0x6F, 0x5F, 0x43, 0x50, 0x55, 0x5F, 0x42, 0x4C}; // "Co_CPU_BL"
+static uint8_t system_identify_app_response[] = {0x04, 0x02, 0x43, 0x6F, 0x5F, 0x43, 0x50, 0x55, 0x5F, 0x41, 0x70, 0x70}; // "Co_CPU_App"
+static uint8_t system_start_app_response[] = {0x04, 0x01};
+static uint8_t system_change_app_response[] = {0x04, 0x02};
+static uint8_t system_get_version_response[] = {0x04, 0x02, 0x00, 0x00, 0x00, 0x01, 0x04, 0x08}; // 1.4.8
+static uint8_t system_get_serial_response[] = {0x04, 0x02, 0x46, 0x4B, 0x45, 0x31, 0x32, 0x33, 0x34, 0x35, 0x36, 0x37};
+
+// COMMON ACK 0x05
+static uint8_t common_identify_response[] = {0x05, 0x01, 0x44, 0x75, 0x61, 0x6C, 0x43, 0x6F, 0x50, 0x72, 0x6F, 0x5F, 0x41, 0x70, 0x70}; //"DualCoPro_App"
+static uint8_t common_trx_identify_bl_response[] = {0x05, 0x01, 0x48, 0x4D, 0x49, 0x50, 0x5F, 0x54, 0x52, 0x58, 0x5F, 0x42, 0x6C}; // "HMIP_TRX_Bl"
+static uint8_t common_trx_identify_app_response[] = {0x05, 0x01, 0x48, 0x4D, 0x49, 0x50, 0x5F, 0x54, 0x52, 0x58, 0x5F, 0x41, 0x70, 0x70}; // "HMIP_TRX_App"
+static uint8_t common_start_bl_response[] = {0x05, 0x01};
+static uint8_t common_start_app_response[] = {0x05, 0x01};
+static uint8_t common_get_sgtin_response[] = {0x05, 0x01, 0x30, 0x14, 0xF7, 0x11, 0xA0, 0x61, 0xA7, 0xD5, 0x69, 0x9D, 0xAB, 0x52}; // SGTIN
+
+// TRX ACK: 0x04
+static uint8_t trx_get_version_response[] = {0x04, 0x01, 0x02, 0x08, 0x06, 0x01, 0x00, 0x03, 0x01, 0x14, 0x03}; // version 0x02, 0x08, 0x06, 2.8.6
+static uint8_t trx_get_dutycycle_response[] = {0x04, 0x01, 0x00};
+static uint8_t trx_set_dutycycle_limit_response[] = {0x04, 0x01};
+static uint8_t trx_get_mcu_type_response[] = {0x04, 0x01, 0x03};      // HM-MOD-RPI-PCB
+static uint8_t trx_hmip_get_mcu_type_response[] = {0x04, 0x01, 0x01}; // HmIP-RFUSB
+static uint8_t trx_get_default_rf_address_response[] = {0x04, 0x01, 0x00, 0x00, 0x4F, 0x68, 0xF1};
+
+// LLMAC ACK: 0x01
+static uint8_t llmac_get_default_rf_address_response[] = {0x01, 0x01, 0x4F, 0x68, 0xF1};
+static uint8_t llmac_get_serial_response[] = {0x01, 0x01, 0x46, 0x4B, 0x45, 0x31, 0x32, 0x33, 0x34, 0x35, 0x36, 0x37};
+static uint8_t llmac_get_timestamp_response[] = {0x01, 0x01, 0x2D, 0xEA};
+static uint8_t llmac_rfd_init_response[] = {0x01, 0x01, 0x12, 0x34};
+
+// HMIP ACK:  0x06
+static uint8_t hmip_set_radio_address_response[] = {0x06, 0x01};
+static uint8_t hmip_get_default_rf_address_response[] = {0x06, 0x01, 0x4F, 0x68, 0xF1};
+static uint8_t hmip_get_security_counter_response[] = {0x06, 0x01, 0x0C, 0xFF, 0xFF, 0xFF};
+static uint8_t hmip_set_security_counter_response[] = {0x06, 0x01};
+static uint8_t hmip_set_max_sent_attemps_response[] = {0x06, 0x01};
+static uint8_t hmip_get_nwkey_response[] = {0x06, 0x01, 0xC2, 0x14, 0x22, 0xF3, 0xCA, 0x9C, 0xBD, 0xA3, 0x5F, 0x71, 0x88, 0xA4, 0x73, 0xCE, 0x6F, 0x03, 0xA7, 0xA5, 0xCA, 0x26, 0xBA, 0xE8, 0xA2, 0x2A, 0x0D, 0x3D, 0x48, 0x97, 0xB6, 0xBA, 0x47, 0xF0, 0x1D, 0xCA, 0xA7, 0x39, 0xB8, 0x4D, 0xB3, 0xFB, 0x13, 0x47, 0x02, 0x15, 0xE5, 0x37, 0x52, 0xB9, 0x39, 0xDC, 0xBA, 0x22, 0x89, 0x34, 0xCA, 0x66, 0x66, 0x5B, 0xD3, 0x6F, 0xB3, 0xD5, 0x51, 0xB6, 0x67, 0x98};
+static uint8_t hmip_get_linkpartner_response[] = {0x06, 0x01};
+static uint8_t hmip_set_nwkey_response[] = {0x06, 0x01};
+static uint8_t hmip_add_linkpartner_response[] = {0x06, 0x01};
+static uint8_t hmip_send_response[] = {0x06, 0x01};
+
+typedef enum hm_dst
+{
+  HM_DST_SYSTEM = 0x00,
+  HM_DST_TRX = 0x01,
+  HM_DST_HMIP = 0x02,
+  HM_DST_LLMAC = 0x03,
+  HM_DST_COMMON = 0xfe,
+} hm_dst_t;
+
+typedef enum hm_system_cmd
+{
+  HM_SYSTEM_IDENTIFY = 0x00,
+  HM_SYSTEM_GET_VERSION = 0x02,
+  HM_SYSTEM_START_APP = 0x03, // CHANGE_APP on legacy firmware, toggles between bootloader and app
+  HM_SYSTEM_GET_SERIAL = 0x0b,
+} hm_system_cmd_t;
+
+typedef enum hm_common_cmd
+{
+  HM_COMMON_IDENTIFY = 0x01,
+  HM_COMMON_START_BL = 0x02,
+  HM_COMMON_START_APP = 0x03,
+  HM_COMMON_GET_SGTIN = 0x04,
+} hm_common_cmd_t;
+
+typedef enum hm_trx_cmd
+{
+  HM_TRX_GET_VERSION = 0x02,
+  HM_TRX_GET_DUTYCYCLE = 0x03,
+  HM_TRX_SET_DCUTYCYCLE_LIMIT = 0x07,
+  HM_TRX_GET_MCU_TYPE = 0x09,
+  HM_TRX_GET_DEFAULT_RF_ADDR = 0x10,
+} hm_trx_cmd_t;
+
+typedef enum hm_llmac_cmd
+{
+  HM_LLMAC_GET_TIMESTAMP = 0x02,
+  HM_LLMAC_RFD_INIT = 0x06,
+  HM_LLMAC_GET_SERIAL = 0x07,
+  HM_LLMAC_GET_DEFAULT_RF_ADDR = 0x08,
+} hm_llmac_cmd_t;
+
+typedef enum hm_hmip_cmd
+{
+  HM_HMIP_SET_RADIO_ADDR = 0x00,
+  HM_HMIP_GET_DEFAULT_RF_ADDR = 0x01,
+  HM_HMIP_SEND = 0x03,
+  HM_HMIP_ADD_LINK_PARTNER = 0x04,
+  HM_HMIP_GET_SECURITY_COUNTER = 0x0a,
+  HM_HMIP_SET_SECURITY_COUNTER = 0x08,
+  HM_HMIP_SET_MAX_SENT_ATTEMPS = 0x0d,
+  HM_HMIP_GET_LINK_PARTNER = 0x12,
+  HM_HMIP_GET_NWKEY = 0x13,
+  HM_HMIP_SET_NWKEY = 0x14,
+} hm_hmip_cmd_t;
+
+// synthetic radio frames are sent as unsolicited frames with counter 0, like frames received by the radio
+#define TRAFFIC_COMMAND 0x05
+#define TRAFFIC_BURST_LIMIT 64 // frames per poll when the caller falls behind the configured rate
+
+static uint16_t calculate_crc(uint16_t crc, uint8_t byte)
+{
+  crc ^= byte << 8;
+
+  for (int i = 0; i < 8; i++)
+  {
+    if (crc & 0x8000)
+    {
+      crc <<= 1;
+      crc ^= 0x8005;
+    }
+    else
+    {
+      crc <<= 1;
+    }
+  }
+  return crc;
+}
+
+static size_t put_escaped(uint8_t *out, size_t pos, uint8_t byte)
+{
+  if (byte == 0xFD || byte == 0xFC) //  escaping needed
+  {
+    out[pos++] = 0xFC;        // add escape marker
+    out[pos++] = byte & 0x7F; // escape actual byte
+  }
+  else
+  {
+    out[pos++] = byte;
+  }
+  return pos;
+}
+
+size_t hm_mod_encode_frame(uint8_t *out, uint8_t destination, uint8_t counter, const uint8_t *payload, size_t len)
+{
+  uint16_t data_len = 1 + 1 + len; // destination + counter + payload(command + data)
+  uint8_t header[] = {(uint8_t)(data_len >> 8), (uint8_t)(data_len & 0xFF), destination, counter};
+  uint16_t crc = CRC_SEED;
+  size_t pos = 0;
+
+  out[pos++] = 0xFD; // start byte
+
+  for (size_t i = 0; i < sizeof(header); i++)
+  {
+    crc = calculate_crc(crc, header[i]);
+    pos = put_escaped(out, pos, header[i]);
+  }
+  for (size_t i = 0; i < len; i++)
+  {
+    crc = calculate_crc(crc, payload[i]);
+    pos = put_escaped(out, pos, payload[i]);
+  }
+
+  pos = put_escaped(out, pos, (uint8_t)(crc >> 8));
+  pos = put_escaped(out, pos, (uint8_t)(crc & 0xFF));
+  return pos;
+}
+
+static void send_response_frame(hm_mod_t *mod, uint8_t response[], size_t response_len)
+{
+  if (mod->pending_count == HM_MOD_PENDING_RESPONSES)
+  {
+    mod->stats.responses_dropped++;
+    return;
+  }
+
+  // answer with the destination and counter of the request
+  hm_mod_pending_t *pending = &mod->pending[(mod->pending_head + mod->pending_count) % HM_MOD_PENDING_RESPONSES];
+  pending->len = hm_mod_encode_frame(pending->data, mod->buffer[IDX_DESTINATION], mod->buffer[IDX_COUNTER], response, response_len);
+  pending->due = mod->frame_time + mod->response_latency;
+  mod->pending_count++;
+}
+
+static void process_system_frame(hm_mod_t *mod, hm_system_cmd_t command)
+{
+  bool legacy = mod->identity == HM_MOD_IDENTITY_CO_CPU;
+
+  switch (command)
+  {
+  case HM_SYSTEM_IDENTIFY:
+    if (mod->is_in_bl)
+      send_response_frame(mod, system_identify_response, sizeof(system_identify_response));
+    else if (legacy)
+      send_response_frame(mod, system_identify_app_response, sizeof(system_identify_app_response));
+    break;
+  case HM_SYSTEM_START_APP:
+    if (legacy)
+    {
+      mod->is_in_bl = !mod->is_in_bl;
+      send_response_frame(mod, system_change_app_response, sizeof(system_change_app_response));
+    }
+    else
+    {
+      mod->is_in_bl = false; // exit bootloader
+      send_response_frame(mod, system_start_app_response, sizeof(system_start_app_response));
+    }
+    break;
+  case HM_SYSTEM_GET_VERSION:
+    if (legacy)
+      send_response_frame(mod, system_get_version_response, sizeof(system_get_version_response));
+    break;
+  case HM_SYSTEM_GET_SERIAL:
+    if (legacy)
+      send_response_frame(mod, system_get_serial_response, sizeof(system_get_serial_response));
+    break;
+  }
+}
+
+static void process_common_frame(hm_mod_t *mod, hm_common_cmd_t command)
+{
+  bool trx = mod->identity == HM_MOD_IDENTITY_HMIP_TRX;
+
+  switch (command)
+  {
+  case HM_COMMON_IDENTIFY:
+    if (trx && mod->is_in_bl)
+      send_response_frame(mod, common_trx_identify_bl_response, sizeof(common_trx_identify_bl_response));
+    else if (trx)
+      send_response_frame(mod, common_trx_identify_app_response, sizeof(common_trx_identify_app_response));
+    else if (!mod->is_in_bl)
+      send_response_frame(mod, common_identify_response, sizeof(common_identify_response));
+    break;
+  case HM_COMMON_START_BL:
+    mod->is_in_bl = true;
+    send_response_frame(mod, common_start_bl_response, sizeof(common_start_bl_response));
+    break;
+  case HM_COMMON_START_APP:
+    if (trx)
+    {
+      mod->is_in_bl = false;
+      send_response_frame(mod, common_start_app_response, sizeof(common_start_app_response));
+    }
+    break;
+  case HM_COMMON_GET_SGTIN:
+    send_response_frame(mod, common_get_sgtin_response, sizeof(common_get_sgtin_response));
+    break;
+  }
+}
+
+static void process_trx_frame(hm_mod_t *mod, hm_trx_cmd_t command)
+{
+  if (mod->identity == HM_MOD_IDENTITY_CO_CPU)
+  {
+    if (command == HM_TRX_GET_DEFAULT_RF_ADDR)
+      send_response_frame(mod, trx_get_default_rf_address_response, sizeof(trx_get_default_rf_address_response));
+    return;
+  }
+
+  switch (command)
+  {
+  case HM_TRX_GET_VERSION:
+    send_response_frame(mod, trx_get_version_response, sizeof(trx_get_version_response));
+    break;
+  case HM_TRX_GET_DUTYCYCLE:
+    send_response_frame(mod, trx_get_dutycycle_response, sizeof(trx_get_dutycycle_response));
+    break;
+  case HM_TRX_SET_DCUTYCYCLE_LIMIT:
+    send_response_frame(mod, trx_set_dutycycle_limit_response, sizeof(trx_set_dutycycle_limit_response));
+    break;
+  case HM_TRX_GET_MCU_TYPE:
+    if (mod->identity == HM_MOD_IDENTITY_HMIP_TRX)
+      send_response_frame(mod, trx_hmip_get_mcu_type_response, sizeof(trx_hmip_get_mcu_type_response));
+    else
+      send_response_frame(mod, trx_get_mcu_type_response, sizeof(trx_get_mcu_type_response));
+    break;
+  default:
+    break;
+  }
+}
+
+static void process_llmac_frame(hm_mod_t *mod, hm_llmac_cmd_t command)
+{
+  switch (command)
+  {
+  case HM_LLMAC_GET_TIMESTAMP:
+    send_response_frame(mod, llmac_get_timestamp_response, sizeof(llmac_get_timestamp_response));
+    break;
+  case HM_LLMAC_RFD_INIT:
+    send_response_frame(mod, llmac_rfd_init_response, sizeof(llmac_rfd_init_response));
+    break;
+  case HM_LLMAC_GET_SERIAL:
+    send_response_frame(mod, llmac_get_serial_response, sizeof(llmac_get_serial_response));
+    break;
+  case HM_LLMAC_GET_DEFAULT_RF_ADDR:
+    send_response_frame(mod, llmac_get_default_rf_address_response, sizeof(llmac_get_default_rf_address_response));
+    break;
+  }
+}
+
+static void process_hmip_frame(hm_mod_t *mod, hm_hmip_cmd_t command)
+{
+  switch (command)
+  {
+  case HM_HMIP_SET_RADIO_ADDR:
+    send_response_frame(mod, hmip_set_radio_address_response, sizeof(hmip_set_radio_address_response));
+    break;
+  case HM_HMIP_GET_DEFAULT_RF_ADDR:
+    send_response_frame(mod, hmip_get_default_rf_address_response, sizeof(hmip_get_default_rf_address_response));
+    break;
+  case HM_HMIP_SEND:
+    send_response_frame(mod, hmip_send_response, sizeof(hmip_send_response));
+    break;
+  case HM_HMIP_ADD_LINK_PARTNER:
+    send_response_frame(mod, hmip_add_linkpartner_response, sizeof(hmip_add_linkpartner_response));
+    break;
+  case HM_HMIP_GET_SECURITY_COUNTER:
+    send_response_frame(mod, hmip_get_security_counter_response, sizeof(hmip_get_security_counter_response));
+    break;
+  case HM_HMIP_SET_SECURITY_COUNTER:
+    send_response_frame(mod, hmip_set_security_counter_response, sizeof(hmip_set_security_counter_response));
+    break;
+  case HM_HMIP_SET_MAX_SENT_ATTEMPS:
+    send_response_frame(mod, hmip_set_max_sent_attemps_response, sizeof(hmip_set_max_sent_attemps_response));
+    break;
+  case HM_HMIP_GET_LINK_PARTNER:
+    send_response_frame(mod, hmip_get_linkpartner_response, sizeof(hmip_get_linkpartner_response));
+    break;
+  case HM_HMIP_GET_NWKEY:
+    send_response_frame(mod, hmip_get_nwkey_response, sizeof(hmip_get_nwkey_response));
+    break;
+  case HM_HMIP_SET_NWKEY:
+    send_response_frame(mod, hmip_set_nwkey_response, sizeof(hmip_set_nwkey_response));
+    break;
+  }
+}
+
+static void process_frame(hm_mod_t *mod)
+{
+  hm_dst_t destination = (hm_dst_t)mod->buffer[IDX_DESTINATION];
+  uint8_t command = mod->buffer[IDX_COMMAND];
+  uint32_t answered = mod->pending_count + mod->stats.responses_dropped;
+
+  // the destinations the firmware of the simulated module implements
+  switch (destination)
+  {
+  case HM_DST_SYSTEM:
+    if (mod->identity != HM_MOD_IDENTITY_HMIP_TRX)
+      process_system_frame(mod, (hm_system_cmd_t)command);
+    break;
+  case HM_DST_COMMON:
+    if (mod->identity != HM_MOD_IDENTITY_CO_CPU)
+      process_common_frame(mod, (hm_common_cmd_t)command);
+    break;
+  case HM_DST_TRX:
+    process_trx_frame(mod, (hm_trx_cmd_t)command);
+    break;
+  case HM_DST_LLMAC:
+    if (mod->identity == HM_MOD_IDENTITY_DUALCOPRO)
+      process_llmac_frame(mod, (hm_llmac_cmd_t)command);
+    break;
+  case HM_DST_HMIP:
+    if (mod->identity != HM_MOD_IDENTITY_CO_CPU)
+      process_hmip_frame(mod, (hm_hmip_cmd_t)command);
+    break;
+  default:
+    if (!mod->echo)
+      printf("unsupported destination\n");
+    break;
+  }
+
+  if (mod->echo && mod->pending_count + mod->stats.responses_dropped == answered)
+  {
+    // command and data of the request, the header is taken from the request anyway
+    size_t len = mod->frame_length - IDX_COMMAND;
+    if (2 * (len + 6) + 1 <= HM_MOD_MAX_RESPONSE)
+      send_response_frame(mod, &mod->buffer[IDX_COMMAND], len);
+    else
+      mod->stats.responses_dropped++;
+  }
+}
+
+void hm_mod_init(hm_mod_t *mod, hm_mod_identity_t identity, hm_mod_write_t write, void *user_data)
+{
+  memset(mod, 0, sizeof(hm_mod_t));
+  mod->identity = identity;
+  mod->write = write;
+  mod->user_data = user_data;
+  mod->state = WAIT_FOR_START;
+  mod->is_in_bl = true;
+}
+
+void hm_mod_set_reset(hm_mod_t *mod, bool active)
+{
+  if (active)
+  {
+    // Reset asserted
+    printf("Reset active\n");
+    mod->reset_active = true;
+    mod->state = WAIT_FOR_START;
+    mod->escaped = false;
+    mod->is_in_bl = true;
+    mod->pending_count = 0;
+  }
+  else
+  {
+    // Reset released
+    printf("Reset released\n");
+    mod->reset_active = false;
+  }
+}
+
+void hm_mod_receive(hm_mod_t *mod, uint8_t byte, uint64_t now)
+{
+  if (mod->reset_active) // do nothing in reset
+    return;
+
+  if (mod->verbose)
+    printf("0x%02X", byte);
+
+  if (byte == 0xFD)
+  {
+    mod->state = RECEIVE_LENGTH_HIGH;
+    mod->crc = CRC_SEED;
+    mod->escaped = false;
+    return;
+  }
+  else if (byte == 0xFC)
+  {
+    mod->escaped = true;
+    return;
+  }
+
+  if (mod->escaped)
+  {
+    mod->escaped = false;
+    byte = byte | 0x80;
+  }
+
+  switch (mod->state)
+  {
+
+  case RECEIVE_LENGTH_HIGH:
+    mod->frame_length = byte << 8;
+    mod->crc = calculate_crc(mod->crc, byte);
+    mod->state = RECEIVE_LENGTH_LOW;
+    break;
+
+  case RECEIVE_LENGTH_LOW:
+    mod->frame_length |= byte;
+    mod->crc = calculate_crc(mod->crc, byte);
+    mod->frame_pos = 0;
+    mod->state = mod->frame_length ? RECEIVE_FRAME_DATA : RECEIVE_CRC_HIGH;
+    break;
+
+  case RECEIVE_FRAME_DATA:
+
+    mod->buffer[mod->frame_pos++] = byte;
+    mod->crc = calculate_crc(mod->crc, byte);
+
+    if (mod->frame_pos == mod->frame_length)
+    {
+      mod->state = RECEIVE_CRC_HIGH;
+    }
+    else if (mod->frame_pos == HM_MOD_BUFFER_SIZE - 1)
+    {
+      mod->state = WAIT_FOR_START;
+    }
+    break;
+
+  case RECEIVE_CRC_HIGH:
+
+    if ((mod->crc >> 8) == byte)
+    { // check high byte
+      mod->state = RECEIVE_CRC_LOW;
+    }
+    else
+    {
+      printf("CRC Error\n");
+      mod->stats.crc_errors++;
+      mod->state = WAIT_FOR_START;
+    }
+    break;
+
+  case RECEIVE_CRC_LOW:
+    if ((mod->crc & 0xFF) == byte && mod->frame_length >= 3)
+    { //  crc correct and has counter destination comand
+      if (mod->verbose)
+        printf("        : Valid Frame Received\n");
+      mod->stats.frames_received++;
+      mod->frame_time = now;
+      process_frame(mod);
+    }
+    else
+    {
+      if (mod->frame_length < 3)
+        printf("Frame too short\n");
+      else
+      {
+        printf("CRC Error\n");
+        mod->stats.crc_errors++;
+      }
+    }
+    mod->state = WAIT_FOR_START;
+    break;
+
+  case WAIT_FOR_START:
+    break;
+  }
+}
+
+void hm_mod_set_traffic(hm_mod_t *mod, uint32_t frames_per_second, uint16_t length, uint64_t now)
+{
+  if (length < 1)
+    length = 1;
+  if (length > HM_MOD_MAX_TRAFFIC_LENGTH)
+    length = HM_MOD_MAX_TRAFFIC_LENGTH;
+
+  mod->traffic_interval = frames_per_second ? 1000000 / frames_per_second : 0;
+  if (frames_per_second && !mod->traffic_interval)
+    mod->traffic_interval = 1;
+  mod->traffic_length = length;
+  mod->traffic_next = now + mod->traffic_interval;
+}
+
+static void send_traffic_frame(hm_mod_t *mod)
+{
+  uint8_t payload[HM_MOD_MAX_TRAFFIC_LENGTH];
+  uint8_t frame[2 * (HM_MOD_MAX_TRAFFIC_LENGTH + 6) + 1];
+
+  // command, sequence number, filler
+  payload[0] = TRAFFIC_COMMAND;
+  for (uint16_t i = 1; i < mod->traffic_length; i++)
+    payload[i] = i <= 4 ? (uint8_t)(mod->traffic_sequence >> (8 * (4 - i))) : (uint8_t)i;
+
+  uint8_t destination = mod->identity == HM_MOD_IDENTITY_CO_CPU ? HM_DST_TRX : HM_DST_HMIP;
+  size_t len = hm_mod_encode_frame(frame, destination, 0, payload, mod->traffic_length);
+  mod->write(mod->user_data, frame, len);
+
+  mod->traffic_sequence++;
+  mod->stats.traffic_sent++;
+}
+
+uint64_t hm_mod_poll(hm_mod_t *mod, uint64_t now)
+{
+  uint64_t next = HM_MOD_NEVER;
+
+  while (mod->pending_count)
+  {
+    hm_mod_pending_t *pending = &mod->pending[mod->pending_head];
+    if (pending->due > now)
+    {
+      next = pending->due;
+      break;
+    }
+    mod->write(mod->user_data, pending->data, pending->len);
+    mod->pending_head = (mod->pending_head + 1) % HM_MOD_PENDING_RESPONSES;
+    mod->pending_count--;
+    mod->stats.responses_sent++;
+  }
+
+  if (mod->traffic_interval)
+  {
+    // the radio only forwards received frames while the app is running
+    int burst = 0;
+    while (mod->traffic_next <= now && burst++ < TRAFFIC_BURST_LIMIT)
+    {
+      if (!mod->reset_active && !mod->is_in_bl)
+        send_traffic_frame(mod);
+      mod->traffic_next += mod->traffic_interval;
+    }
+    if (mod->traffic_next <= now)
+      mod->traffic_next = now + mod->traffic_interval; // too far behind, do not catch up
+    if (mod->traffic_next < next)
+      next = mod->traffic_next;
+  }
+
+  return next;
+}
+
+const char *hm_mod_identity_name(hm_mod_identity_t identity)
+{
+  switch (identity)
+  {
+  case HM_MOD_IDENTITY_CO_CPU:
+    return "Co_CPU";
+  case HM_MOD_IDENTITY_DUALCOPRO:
+    return "DualCoPro";
+  case HM_MOD_IDENTITY_HMIP_TRX:
+    return "HMIP_TRX";
+  }
+  return "unknown";
+}
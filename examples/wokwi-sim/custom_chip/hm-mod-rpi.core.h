@@ -0,0 +1,126 @@
+/*-----------------------------------------------------------------------------
+ * HM-MOD-RPI simulation core, shared by the Wokwi custom chip and the host
+ * module emulator (host/hm_fake_module.c)
+ *
+ * Copyright (c) 2026 Zinar Sisamci
+ * Author: Zinar Sisamci
+
+ * Based on alexreinert/piVCCU (kernel/fake_hmrf.c)
+ * Copyright (c) 2025 by Alexander Reinert
+ * Author: Alexander Reinert
+ * Uses parts of bcm2835_raw_uart.c. (c) 2015 by eQ-3 Entwicklung GmbH
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *---------------------------------------------------------------------------*/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define HM_MOD_BUFFER_SIZE 1024
+#define HM_MOD_MAX_RESPONSE 160 // escaped response frame incl. start byte and crc
+#define HM_MOD_PENDING_RESPONSES 64
+#define HM_MOD_MAX_TRAFFIC_LENGTH 256
+#define HM_MOD_NEVER UINT64_MAX
+
+// Firmware the simulated module identifies as
+typedef enum hm_mod_identity
+{
+  HM_MOD_IDENTITY_CO_CPU = 0,    // HM-MOD-RPI-PCB with legacy firmware, "Co_CPU_BL" / "Co_CPU_App"
+  HM_MOD_IDENTITY_DUALCOPRO = 1, // HM-MOD-RPI-PCB with DualCoPro firmware, "Co_CPU_BL" / "DualCoPro_App"
+  HM_MOD_IDENTITY_HMIP_TRX = 2,  // HmIP-RFUSB, "HMIP_TRX_Bl" / "HMIP_TRX_App"
+} hm_mod_identity_t;
+
+typedef enum hm_mod_uart_state
+{
+  WAIT_FOR_START,
+  RECEIVE_LENGTH_HIGH,
+  RECEIVE_LENGTH_LOW,
+  RECEIVE_FRAME_DATA,
+  RECEIVE_CRC_HIGH,
+  RECEIVE_CRC_LOW,
+} hm_mod_uart_state_t;
+
+// called with a complete, escaped frame
+typedef void (*hm_mod_write_t)(void *user_data, const uint8_t *buffer, size_t len);
+
+typedef struct hm_mod_pending
+{
+  uint64_t due;
+  uint16_t len;
+  uint8_t data[HM_MOD_MAX_RESPONSE];
+} hm_mod_pending_t;
+
+typedef struct hm_mod_stats
+{
+  uint32_t frames_received;
+  uint32_t crc_errors;
+  uint32_t responses_sent;
+  uint32_t responses_dropped; // response queue full
+  uint32_t traffic_sent;
+} hm_mod_stats_t;
+
+typedef struct hm_mod
+{
+  uint8_t buffer[HM_MOD_BUFFER_SIZE];
+  uint16_t frame_length;
+  uint16_t frame_pos;
+  uint16_t crc;
+  uint64_t frame_time; // end of the last received frame
+  hm_mod_uart_state_t state;
+  bool escaped;
+  bool reset_active;
+  bool is_in_bl;
+  bool verbose; // log every received byte
+  bool echo;    // answer frames the firmware does not know with the frame itself, as loopback for load tests
+
+  hm_mod_identity_t identity;
+  uint32_t response_latency; // us between the end of a request and its response
+
+  hm_mod_pending_t pending[HM_MOD_PENDING_RESPONSES];
+  uint8_t pending_head;
+  uint8_t pending_count;
+
+  uint64_t traffic_interval; // us between synthetic RF frames, 0 disables the generator
+  uint64_t traffic_next;
+  uint16_t traffic_length;
+  uint32_t traffic_sequence;
+
+  hm_mod_stats_t stats;
+
+  hm_mod_write_t write;
+  void *user_data;
+} hm_mod_t;
+
+void hm_mod_init(hm_mod_t *mod, hm_mod_identity_t identity, hm_mod_write_t write, void *user_data);
+
+// The reset line, while active all received bytes are ignored, releasing it starts the bootloader
+void hm_mod_set_reset(hm_mod_t *mod, bool active);
+
+// Feeds one byte received on the UART, now is a monotonic time in us
+void hm_mod_receive(hm_mod_t *mod, uint8_t byte, uint64_t now);
+
+// Generates frames_per_second frames with length bytes of payload, as the module would forward received radio frames
+void hm_mod_set_traffic(hm_mod_t *mod, uint32_t frames_per_second, uint16_t length, uint64_t now);
+
+// Writes due responses and synthetic frames, returns the time of the next pending event or HM_MOD_NEVER
+uint64_t hm_mod_poll(hm_mod_t *mod, uint64_t now);
+
+const char *hm_mod_identity_name(hm_mod_identity_t identity);
+
+// Builds an escaped frame with start byte and crc into out, which must hold 2 * (len + 6) + 1 bytes
+size_t hm_mod_encode_frame(uint8_t *out, uint8_t destination, uint8_t counter, const uint8_t *payload, size_t len);
@@ -0,0 +1,559 @@
+// Emulates the CCU side of the raw-uart UDP protocol as RawUartUdpListener::handlePacket expects it: connect v1/v2,
+// start/end connection, keepalives, LED, reset and frames. Sends frames at a configurable rate with injected loss,
+// duplicates, reordering and CRC errors and measures the round-trip time through the radio module, so it can be used
+// as soak test and benchmark against a bridge, real or host build.
+
+#include <arpa/inet.h>
+#include <getopt.h>
+#include <netdb.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+#include <atomic>
+#include <mutex>
+#include <random>
+#include <thread>
+
+#include "esphome/core/log.h"
+#include "hmframe.h"
+#include "latencyhistogram.h"
+
+static const char *TAG = "HmCcuEmulator";
+
+#define RAW_UART_CONNECT 0
+#define RAW_UART_DISCONNECT 1
+#define RAW_UART_KEEPALIVE 2
+#define RAW_UART_LED 3
+#define RAW_UART_RESET 4
+#define RAW_UART_START_CONNECTION 5
+#define RAW_UART_END_CONNECTION 6
+#define RAW_UART_FRAME 7
+
+#define PROBE_ECHO_COMMAND 0x7f  // unknown to the firmware, hm_fake_module -e sends the frame back
+#define PROBE_SEQUENCE_LEN 4
+#define MAX_PROBE_SIZE 512
+
+typedef enum {
+  PROBE_ECHO = 0,        // frames with sequence number, needs a looped-back module
+  PROBE_RF_ADDRESS = 1,  // HmIP get default RF address, answered by every module with HmIP firmware
+} probe_t;
+
+typedef struct {
+  int protocolVersion = 2;
+  probe_t probe = PROBE_ECHO;
+  uint32_t rate = 100;  // frames/s
+  uint32_t burst = 1;   // frames sent back to back
+  uint32_t size = 8;    // probe payload bytes
+  uint32_t duration = 10;
+  uint32_t drainTime = 1000;  // ms to wait for outstanding responses
+  double loss = 0;            // probabilities of the injected faults
+  double duplicate = 0;
+  double reorder = 0;
+  double corrupt = 0;
+  bool reset = false;
+  bool bootloader = false;
+  uint32_t reportInterval = 1;
+  double maxLoss = -1;
+} ccu_options_t;
+
+typedef struct {
+  int64_t sendTime;
+  uint32_t sequence;
+  bool pending;
+} inflight_t;
+
+static std::atomic<bool> _running{true};
+
+static void _stop(int signal) { _running = false; }
+
+static int64_t _now() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+class CcuEmulator {
+ private:
+  const ccu_options_t &_options;
+  int _socket{-1};
+  sockaddr_in _bridge{};
+  uint8_t _counter{0};
+  uint8_t _endpointIdentifier{0};
+
+  std::mutex _inflightMutex;
+  inflight_t _inflight[256]{};  // indexed by the counter of the HM frame
+  uint32_t _lastSequence{0};
+
+  std::mt19937 _random{std::random_device{}()};
+  std::uniform_real_distribution<double> _chance{0, 1};
+  uint8_t _held[MAX_PROBE_SIZE * 2 + 16];
+  size_t _heldLen{0};
+
+  LatencyHistogram _rtt;
+  LatencyHistogram _intervalRtt;
+
+ public:
+  std::atomic<uint32_t> sent{0}, sentBytes{0}, injectedLoss{0}, injectedDuplicates{0}, injectedReorders{0},
+      injectedCorrupt{0};
+  std::atomic<uint32_t> received{0}, receivedBytes{0}, duplicates{0}, outOfOrder{0}, unexpected{0}, otherFrames{0},
+      lost{0}, keepAlivesReceived{0};
+
+  CcuEmulator(const ccu_options_t &options) : _options(options) {}
+
+  bool open(const char *host, uint16_t port);
+  bool connect();
+  void disconnect();
+  void sendPacket(uint8_t type, const uint8_t *payload, size_t len, bool corrupt = false);
+  void sendProbe(uint32_t sequence);
+  void sendCommand(uint8_t destination, uint8_t command);
+  void flushHeld();
+  void receiveLoop();
+  void expirePending(bool all);
+
+  LatencyHistogram &getRtt() { return _rtt; }
+  LatencyHistogram &getIntervalRtt() { return _intervalRtt; }
+
+ private:
+  void _handleFrame(unsigned char *buffer, size_t len, int64_t now);
+  ssize_t _receive(uint8_t *buffer, size_t size);
+};
+
+bool CcuEmulator::open(const char *host, uint16_t port) {
+  addrinfo hints{}, *result;
+  hints.ai_family = AF_INET;
+  hints.ai_socktype = SOCK_DGRAM;
+  if (getaddrinfo(host, NULL, &hints, &result)) {
+    ESP_LOGE(TAG, "Could not resolve %s", host);
+    return false;
+  }
+  _bridge = *(sockaddr_in *) result->ai_addr;
+  _bridge.sin_port = htons(port);
+  freeaddrinfo(result);
+
+  _socket = socket(AF_INET, SOCK_DGRAM, 0);
+  timeval timeout = {0, 100000};
+  setsockopt(_socket, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+  int bufferSize = 1 << 20;
+  setsockopt(_socket, SOL_SOCKET, SO_RCVBUF, &bufferSize, sizeof(bufferSize));
+  return _socket >= 0;
+}
+
+void CcuEmulator::sendPacket(uint8_t type, const uint8_t *payload, size_t len, bool corrupt) {
+  uint8_t packet[MAX_PROBE_SIZE * 2 + 16];
+
+  packet[0] = type;
+  packet[1] = _counter++;
+  if (len)
+    memcpy(packet + 2, payload, len);
+  uint16_t crc = HMFrame::crc(packet, len + 2);
+  if (corrupt)
+    crc ^= 0x5a5a;
+  packet[len + 2] = crc >> 8;
+  packet[len + 3] = crc & 0xff;
+
+  sendto(_socket, packet, len + 4, 0, (sockaddr *) &_bridge, sizeof(_bridge));
+}
+
+ssize_t CcuEmulator::_receive(uint8_t *buffer, size_t size) {
+  sockaddr_in from;
+  socklen_t fromLen = sizeof(from);
+  ssize_t len = recvfrom(_socket, buffer, size, 0, (sockaddr *) &from, &fromLen);
+
+  if (len < 4 || from.sin_addr.s_addr != _bridge.sin_addr.s_addr || from.sin_port != _bridge.sin_port)
+    return -1;
+  if (((buffer[len - 2] << 8) | buffer[len - 1]) != HMFrame::crc(buffer, len - 2)) {
+    ESP_LOGW(TAG, "Received raw-uart packet with invalid crc");
+    return -1;
+  }
+  return len;
+}
+
+bool CcuEmulator::connect() {
+  uint8_t buffer[1500];
+
+  for (int retry = 0; retry < 3 && _running; retry++) {
+    uint8_t request[2] = {(uint8_t) _options.protocolVersion, 0};  // v2: endpoint identifier 0 starts a new session
+    sendPacket(RAW_UART_CONNECT, request, _options.protocolVersion == 1 ? 1 : 2);
+
+    int64_t deadline = _now() + 1000000;
+    while (_now() < deadline) {
+      ssize_t len = _receive(buffer, sizeof(buffer));
+      if (len < 0 || buffer[0] != RAW_UART_CONNECT)
+        continue;
+      if (_options.protocolVersion == 1 && len == 6 && buffer[2] == 1) {
+        ESP_LOGI(TAG, "Connected with protocol version 1");
+      } else if (_options.protocolVersion == 2 && len == 7 && buffer[2] == 2) {
+        _endpointIdentifier = buffer[4];
+        ESP_LOGI(TAG, "Connected with protocol version 2, endpoint identifier %u", _endpointIdentifier);
+      } else {
+        continue;
+      }
+
+      if (_options.reset) {
+        sendPacket(RAW_UART_RESET, NULL, 0);
+        usleep(1000000);
+      }
+      sendPacket(RAW_UART_START_CONNECTION, NULL, 0);
+      uint8_t led = 2;  // green
+      sendPacket(RAW_UART_LED, &led, 1);
+      return true;
+    }
+  }
+  return false;
+}
+
+void CcuEmulator::disconnect() {
+  sendPacket(RAW_UART_END_CONNECTION, NULL, 0);
+  sendPacket(RAW_UART_DISCONNECT, NULL, 0);
+}
+
+void CcuEmulator::sendCommand(uint8_t destination, uint8_t command) {
+  uint8_t frameBuffer[16];
+
+  HMFrame frame;
+  frame.destination = destination;
+  frame.counter = 0;
+  frame.command = command;
+  frame.data_len = 0;
+  sendPacket(RAW_UART_FRAME, frameBuffer, frame.encode(frameBuffer, sizeof(frameBuffer), true));
+}
+
+void CcuEmulator::sendProbe(uint32_t sequence) {
+  uint8_t data[MAX_PROBE_SIZE];
+  uint8_t frameBuffer[MAX_PROBE_SIZE * 2 + 16];
+
+  HMFrame frame;
+  frame.destination = HM_DST_HMIP;
+  frame.counter = sequence & 0xff;
+  frame.data = data;
+  if (_options.probe == PROBE_ECHO) {
+    frame.command = PROBE_ECHO_COMMAND;
+    frame.data_len = _options.size < PROBE_SEQUENCE_LEN ? PROBE_SEQUENCE_LEN : _options.size;
+    for (uint16_t i = 0; i < frame.data_len; i++)
+      data[i] = i < PROBE_SEQUENCE_LEN ? sequence >> (8 * (PROBE_SEQUENCE_LEN - 1 - i)) : i;
+  } else {
+    frame.command = HM_CMD_HMIP_GET_DEFAULT_RF_ADDR;
+    frame.data_len = 0;
+  }
+  uint16_t len = frame.encode(frameBuffer, sizeof(frameBuffer), true);
+
+  if (_chance(_random) < _options.loss) {
+    injectedLoss++;
+    return;
+  }
+
+  if (_chance(_random) < _options.corrupt) {
+    // the bridge has to drop it, so no response is expected
+    injectedCorrupt++;
+    sendPacket(RAW_UART_FRAME, frameBuffer, len, true);
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(_inflightMutex);
+    inflight_t &inflight = _inflight[frame.counter];
+    if (inflight.pending)
+      lost++;  // no response before the counter wrapped around
+    inflight.sendTime = _now();
+    inflight.sequence = sequence;
+    inflight.pending = true;
+  }
+
+  sent++;
+  sentBytes += len;
+
+  if (!_heldLen && _chance(_random) < _options.reorder) {
+    // sent after the next probe
+    injectedReorders++;
+    memcpy(_held, frameBuffer, len);
+    _heldLen = len;
+    return;
+  }
+
+  sendPacket(RAW_UART_FRAME, frameBuffer, len);
+  if (_chance(_random) < _options.duplicate) {
+    injectedDuplicates++;
+    sendPacket(RAW_UART_FRAME, frameBuffer, len);
+  }
+  flushHeld();
+}
+
+void CcuEmulator::flushHeld() {
+  if (_heldLen) {
+    sendPacket(RAW_UART_FRAME, _held, _heldLen);
+    _heldLen = 0;
+  }
+}
+
+void CcuEmulator::_handleFrame(unsigned char *buffer, size_t len, int64_t now) {
+  // frames are forwarded escaped as the module sent them
+  size_t pos = 0;
+  for (size_t i = 0; i < len; i++) {
+    if (buffer[i] == 0xfc && i + 1 < len)
+      buffer[pos++] = buffer[++i] | 0x80;
+    else
+      buffer[pos++] = buffer[i];
+  }
+
+  HMFrame frame;
+  if (!HMFrame::TryParse(buffer, pos, &frame)) {
+    unexpected++;
+    return;
+  }
+
+  bool isProbe;
+  uint32_t sequence = 0;
+  if (_options.probe == PROBE_ECHO) {
+    isProbe = frame.destination == HM_DST_HMIP && frame.command == PROBE_ECHO_COMMAND &&
+              frame.data_len >= PROBE_SEQUENCE_LEN;
+    for (int i = 0; isProbe && i < PROBE_SEQUENCE_LEN; i++)
+      sequence = (sequence << 8) | frame.data[i];
+  } else {
+    isProbe = frame.destination == HM_DST_HMIP && frame.command == HM_CMD_HMIP_ACK;
+  }
+
+  if (!isProbe) {
+    otherFrames++;
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(_inflightMutex);
+  inflight_t &inflight = _inflight[frame.counter];
+  if (_options.probe == PROBE_RF_ADDRESS)
+    sequence = inflight.sequence;
+
+  if (inflight.sequence != sequence) {
+    unexpected++;
+  } else if (!inflight.pending) {
+    duplicates++;
+  } else {
+    inflight.pending = false;
+    _rtt.record(now - inflight.sendTime);
+    _intervalRtt.record(now - inflight.sendTime);
+    received++;
+    receivedBytes += len;
+    if (sequence < _lastSequence)
+      outOfOrder++;
+    _lastSequence = sequence;
+  }
+}
+
+void CcuEmulator::receiveLoop() {
+  uint8_t buffer[1500];
+
+  while (_running) {
+    ssize_t len = _receive(buffer, sizeof(buffer));
+    if (len < 0)
+      continue;
+
+    switch (buffer[0]) {
+      case RAW_UART_KEEPALIVE:
+        keepAlivesReceived++;
+        break;
+      case RAW_UART_FRAME:
+        _handleFrame(buffer + 2, len - 4, _now());
+        break;
+      default:
+        break;
+    }
+  }
+}
+
+void CcuEmulator::expirePending(bool all) {
+  int64_t deadline = _now() - (int64_t) _options.drainTime * 1000;
+
+  std::lock_guard<std::mutex> lock(_inflightMutex);
+  for (inflight_t &inflight : _inflight) {
+    if (inflight.pending && (all || inflight.sendTime < deadline)) {
+      inflight.pending = false;
+      lost++;
+    }
+  }
+}
+
+static void _usage(const char *name) {
+  fprintf(stderr,
+          "Usage: %s [options] [bridge address]\n"
+          "  -p, --port <port>            raw-uart port of the bridge (default 3008)\n"
+          "  -V, --protocol <1|2>         raw-uart protocol version (default 2)\n"
+          "  -P, --probe <echo|rfaddr>    echo: frames with sequence numbers, needs hm_fake_module -e (default)\n"
+          "                               rfaddr: HmIP get default RF address, answered by real modules\n"
+          "  -r, --rate <frames/s>        probe rate (default 100)\n"
+          "  -b, --burst <frames>         probes sent back to back, at the same average rate (default 1)\n"
+          "  -s, --size <bytes>           echo probe payload size (default 8)\n"
+          "  -d, --duration <seconds>     test duration (default 10, 0 runs until interrupted)\n"
+          "  -l, --loss <percent>         drop probes before sending\n"
+          "  -D, --duplicate <percent>    send probes twice\n"
+          "  -R, --reorder <percent>      send probes after the next one\n"
+          "  -C, --corrupt <percent>      send probes with invalid CRC, the bridge has to drop them\n"
+          "  -x, --reset                  reset the radio module after connecting\n"
+          "  -F, --bootloader             wrap the run in start bootloader / start app like a coprocessor update\n"
+          "  -i, --interval <seconds>     report interval (default 1, 0 disables)\n"
+          "  -m, --max-loss <percent>     exit with 1 if more probes got lost\n"
+          "  -q, --quiet                  only log warnings and errors\n",
+          name);
+}
+
+int main(int argc, char **argv) {
+  static const struct option options[] = {
+      {"port", required_argument, NULL, 'p'},      {"protocol", required_argument, NULL, 'V'},
+      {"probe", required_argument, NULL, 'P'},     {"rate", required_argument, NULL, 'r'},
+      {"burst", required_argument, NULL, 'b'},     {"size", required_argument, NULL, 's'},
+      {"duration", required_argument, NULL, 'd'},  {"loss", required_argument, NULL, 'l'},
+      {"duplicate", required_argument, NULL, 'D'}, {"reorder", required_argument, NULL, 'R'},
+      {"corrupt", required_argument, NULL, 'C'},   {"reset", no_argument, NULL, 'x'},
+      {"bootloader", no_argument, NULL, 'F'},
+      {"interval", required_argument, NULL, 'i'},  {"max-loss", required_argument, NULL, 'm'},
+      {"quiet", no_argument, NULL, 'q'},           {"help", no_argument, NULL, 'h'},
+      {NULL, 0, NULL, 0},
+  };
+
+  ccu_options_t ccuOptions;
+  uint16_t port = 3008;
+
+  int opt;
+  while ((opt = getopt_long(argc, argv, "p:V:P:r:b:s:d:l:D:R:C:xFi:m:qh", options, NULL)) != -1) {
+    switch (opt) {
+      case 'p':
+        port = atoi(optarg);
+        break;
+      case 'V':
+        ccuOptions.protocolVersion = atoi(optarg) == 1 ? 1 : 2;
+        break;
+      case 'P':
+        ccuOptions.probe = strcmp(optarg, "rfaddr") == 0 ? PROBE_RF_ADDRESS : PROBE_ECHO;
+        break;
+      case 'r':
+        ccuOptions.rate = atoi(optarg);
+        break;
+      case 'b':
+        ccuOptions.burst = atoi(optarg);
+        break;
+      case 's':
+        ccuOptions.size = atoi(optarg);
+        break;
+      case 'd':
+        ccuOptions.duration = atoi(optarg);
+        break;
+      case 'l':
+        ccuOptions.loss = atof(optarg) / 100;
+        break;
+      case 'D':
+        ccuOptions.duplicate = atof(optarg) / 100;
+        break;
+      case 'R':
+        ccuOptions.reorder = atof(optarg) / 100;
+        break;
+      case 'C':
+        ccuOptions.corrupt = atof(optarg) / 100;
+        break;
+      case 'x':
+        ccuOptions.reset = true;
+        break;
+      case 'F':
+        ccuOptions.bootloader = true;
+        break;
+      case 'i':
+        ccuOptions.reportInterval = atoi(optarg);
+        break;
+      case 'm':
+        ccuOptions.maxLoss = atof(optarg);
+        break;
+      case 'q':
+        esphome::host_log_level = ESPHOME_LOG_LEVEL_WARN;
+        break;
+      default:
+        _usage(argv[0]);
+        return opt == 'h' ? 0 : 1;
+    }
+  }
+
+  if (!ccuOptions.rate || !ccuOptions.burst || ccuOptions.size > MAX_PROBE_SIZE) {
+    _usage(argv[0]);
+    return 1;
+  }
+
+  signal(SIGINT, _stop);
+  signal(SIGTERM, _stop);
+
+  CcuEmulator ccu(ccuOptions);
+  if (!ccu.open(optind < argc ? argv[optind] : "127.0.0.1", port))
+    return 1;
+  if (!ccu.connect()) {
+    ESP_LOGE(TAG, "Bridge did not answer the connect request");
+    return 2;
+  }
+
+  std::thread receiver(&CcuEmulator::receiveLoop, &ccu);
+
+  if (ccuOptions.bootloader) {
+    ccu.sendCommand(HM_DST_COMMON, HM_CMD_COMMON_START_BL);
+    usleep(100000);
+  }
+
+  int64_t start = _now();
+  int64_t end = ccuOptions.duration ? start + (int64_t) ccuOptions.duration * 1000000 : INT64_MAX;
+  int64_t burstInterval = (int64_t) ccuOptions.burst * 1000000 / ccuOptions.rate;
+  int64_t nextBurst = start, nextKeepAlive = start, nextReport = start + ccuOptions.reportInterval * 1000000;
+  uint32_t sequence = 0, lastSent = 0, lastReceived = 0;
+
+  while (_running && nextBurst < end) {
+    struct timespec wakeup = {(time_t) (nextBurst / 1000000), (long) (nextBurst % 1000000) * 1000};
+    clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wakeup, NULL);
+
+    for (uint32_t i = 0; i < ccuOptions.burst; i++)
+      ccu.sendProbe(sequence++);
+    nextBurst += burstInterval;
+
+    int64_t now = _now();
+    if (now >= nextKeepAlive) {
+      ccu.sendPacket(RAW_UART_KEEPALIVE, NULL, 0);
+      nextKeepAlive = now + 1000000;
+      ccu.expirePending(false);
+    }
+
+    if (ccuOptions.reportInterval && now >= nextReport) {
+      uint32_t sent = ccu.sent, received = ccu.received;
+      ESP_LOGI(TAG, "%u frames/s sent, %u frames/s received, %u lost, RTT p50 %u us p99 %u us",
+               (sent - lastSent) / ccuOptions.reportInterval, (received - lastReceived) / ccuOptions.reportInterval,
+               ccu.lost.load(), ccu.getIntervalRtt().getPercentile(50), ccu.getIntervalRtt().getPercentile(99));
+      ccu.getIntervalRtt().reset();
+      lastSent = sent;
+      lastReceived = received;
+      nextReport += ccuOptions.reportInterval * 1000000;
+    }
+  }
+  ccu.flushHeld();
+  int64_t elapsed = _now() - start;
+
+  usleep(ccuOptions.drainTime * 1000);
+  _running = false;
+  receiver.join();
+  ccu.expirePending(true);
+  if (ccuOptions.bootloader)
+    ccu.sendCommand(HM_DST_COMMON, HM_CMD_COMMON_START_APP);
+  ccu.disconnect();
+
+  double seconds = elapsed / 1e6;
+  uint32_t sent = ccu.sent, lost = ccu.lost;
+  double lossPercent = sent ? 100.0 * lost / sent : 0;
+  LatencyHistogram &rtt = ccu.getRtt();
+
+  printf("Sent      %u frames in %.1f s, %.0f frames/s, %.0f B/s\n", sent, seconds, sent / seconds,
+         ccu.sentBytes / seconds);
+  printf("Injected  %u lost, %u duplicated, %u reordered, %u corrupted\n", ccu.injectedLoss.load(),
+         ccu.injectedDuplicates.load(), ccu.injectedReorders.load(), ccu.injectedCorrupt.load());
+  printf("Received  %u frames, %.0f frames/s, %.0f B/s, %u duplicates, %u out of order, %u unexpected, %u other\n",
+         ccu.received.load(), ccu.received / seconds, ccu.receivedBytes / seconds, ccu.duplicates.load(),
+         ccu.outOfOrder.load(), ccu.unexpected.load(), ccu.otherFrames.load());
+  printf("Lost      %u frames (%.3f %%)\n", lost, lossPercent);
+  printf("RTT       p50 %u us, p90 %u us, p99 %u us, max %u us\n", rtt.getPercentile(50), rtt.getPercentile(90),
+         rtt.getPercentile(99), rtt.getMax());
+  printf("Bridge    %u keepalives received\n", ccu.keepAlivesReceived.load());
+
+  return ccuOptions.maxLoss >= 0 && lossPercent > ccuOptions.maxLoss ? 1 : 0;
+}
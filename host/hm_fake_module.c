@@ -0,0 +1,241 @@
+// Emulates a radio module behind a pty with the protocol core of the Wokwi HM-MOD-RPI chip, so the detector and the
+// UART path of hm_rf_bridge_host can be load tested without hardware.
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "hm-mod-rpi.core.h"
+
+typedef struct
+{
+  int fd;
+  uint32_t dropped;
+} fake_module_t;
+
+static volatile sig_atomic_t _running = 1;
+static volatile sig_atomic_t _reset = 0;
+
+static void _stop(int signal) { _running = 0; }
+
+static void _requestReset(int signal) { _reset = 1; }
+
+static uint64_t _now(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+// Frames are dropped on a full pty (nobody reading) like on a disconnected UART
+static void _writeFrame(void *user_data, const uint8_t *buffer, size_t len)
+{
+  fake_module_t *module = (fake_module_t *)user_data;
+  size_t pos = 0;
+
+  while (pos < len)
+  {
+    ssize_t written = write(module->fd, buffer + pos, len - pos);
+    if (written > 0)
+    {
+      pos += written;
+      continue;
+    }
+    if (written < 0 && errno != EAGAIN && errno != EINTR)
+      break;
+    if (pos == 0)
+    {
+      module->dropped++;
+      return;
+    }
+
+    // finish a partially written frame, unless nobody is reading anymore
+    struct pollfd pfd = {.fd = module->fd, .events = POLLOUT};
+    if (!_running || poll(&pfd, 1, 100) <= 0)
+    {
+      module->dropped++;
+      return;
+    }
+  }
+}
+
+static int _parseIdentity(const char *name, hm_mod_identity_t *identity)
+{
+  if (!strcmp(name, "cocpu"))
+    *identity = HM_MOD_IDENTITY_CO_CPU;
+  else if (!strcmp(name, "dualcopro"))
+    *identity = HM_MOD_IDENTITY_DUALCOPRO;
+  else if (!strcmp(name, "hmip_trx"))
+    *identity = HM_MOD_IDENTITY_HMIP_TRX;
+  else
+    return 0;
+  return 1;
+}
+
+static void _usage(const char *name)
+{
+  fprintf(stderr,
+          "Usage: %s [options]\n"
+          "  -i, --identity <name>        cocpu, dualcopro (default) or hmip_trx\n"
+          "  -l, --latency <us>           delay of each response\n"
+          "  -r, --rate <frames/s>        synthetic radio frames per second (default 0)\n"
+          "  -s, --size <bytes>           payload size of synthetic frames (default 20, max %d)\n"
+          "  -L, --link <path>            create a symlink to the pty\n"
+          "  -e, --echo                   send frames with unknown commands back (loopback for hm_ccu_emulator)\n"
+          "  -v, --verbose                log every received byte\n"
+          "SIGUSR1 pulses the reset line.\n",
+          name, HM_MOD_MAX_TRAFFIC_LENGTH);
+}
+
+int main(int argc, char *argv[])
+{
+  static const struct option options[] = {
+      {"identity", required_argument, NULL, 'i'},
+      {"latency", required_argument, NULL, 'l'},
+      {"rate", required_argument, NULL, 'r'},
+      {"size", required_argument, NULL, 's'},
+      {"link", required_argument, NULL, 'L'},
+      {"echo", no_argument, NULL, 'e'},
+      {"verbose", no_argument, NULL, 'v'},
+      {"help", no_argument, NULL, 'h'},
+      {NULL, 0, NULL, 0},
+  };
+
+  hm_mod_identity_t identity = HM_MOD_IDENTITY_DUALCOPRO;
+  uint32_t latency = 0, rate = 0, size = 20;
+  const char *link = NULL;
+  int echo = 0, verbose = 0;
+  int opt;
+
+  while ((opt = getopt_long(argc, argv, "i:l:r:s:L:evh", options, NULL)) != -1)
+  {
+    switch (opt)
+    {
+    case 'i':
+      if (!_parseIdentity(optarg, &identity))
+      {
+        _usage(argv[0]);
+        return 1;
+      }
+      break;
+    case 'l':
+      latency = strtoul(optarg, NULL, 0);
+      break;
+    case 'r':
+      rate = strtoul(optarg, NULL, 0);
+      break;
+    case 's':
+      size = strtoul(optarg, NULL, 0);
+      break;
+    case 'L':
+      link = optarg;
+      break;
+    case 'e':
+      echo = 1;
+      break;
+    case 'v':
+      verbose = 1;
+      break;
+    default:
+      _usage(argv[0]);
+      return opt == 'h' ? 0 : 1;
+    }
+  }
+
+  fake_module_t module = {0};
+  module.fd = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK);
+  if (module.fd < 0 || grantpt(module.fd) || unlockpt(module.fd))
+  {
+    perror("posix_openpt");
+    return 1;
+  }
+  const char *ptyName = ptsname(module.fd);
+
+  // keep the slave side open and raw, so the pty survives reconnects of the bridge and nothing is echoed
+  int slave = open(ptyName, O_RDWR | O_NOCTTY);
+  struct termios tio;
+  if (slave < 0 || tcgetattr(slave, &tio))
+  {
+    perror(ptyName);
+    return 1;
+  }
+  cfmakeraw(&tio);
+  tcsetattr(slave, TCSANOW, &tio);
+
+  if (link)
+  {
+    unlink(link);
+    if (symlink(ptyName, link))
+    {
+      perror(link);
+      return 1;
+    }
+  }
+
+  signal(SIGINT, _stop);
+  signal(SIGTERM, _stop);
+  signal(SIGUSR1, _requestReset);
+
+  hm_mod_t mod;
+  hm_mod_init(&mod, identity, _writeFrame, &module);
+  mod.verbose = verbose;
+  mod.echo = echo;
+  mod.response_latency = latency;
+  hm_mod_set_traffic(&mod, rate, size, _now());
+
+  printf("%s module on %s\n", hm_mod_identity_name(identity), link ? link : ptyName);
+  fflush(stdout);
+
+  uint8_t buffer[256];
+  uint64_t next = HM_MOD_NEVER;
+
+  while (_running)
+  {
+    if (_reset)
+    {
+      _reset = 0;
+      hm_mod_set_reset(&mod, true);
+      hm_mod_set_reset(&mod, false);
+    }
+
+    uint64_t now = _now();
+    struct timespec timeout = {1, 0};
+    if (next != HM_MOD_NEVER)
+    {
+      uint64_t wait = next > now ? next - now : 0;
+      if (wait < 1000000)
+        timeout = (struct timespec){0, (long)wait * 1000};
+    }
+
+    struct pollfd pfd = {.fd = module.fd, .events = POLLIN};
+    if (ppoll(&pfd, 1, &timeout, NULL) > 0 && (pfd.revents & POLLIN))
+    {
+      ssize_t len = read(module.fd, buffer, sizeof(buffer));
+      now = _now();
+      for (ssize_t i = 0; i < len; i++)
+        hm_mod_receive(&mod, buffer[i], now);
+    }
+
+    next = hm_mod_poll(&mod, _now());
+  }
+
+  printf("%u frames received, %u CRC errors, %u responses sent, %u responses dropped, %u synthetic frames sent, "
+         "%u frames dropped on a full pty\n",
+         mod.stats.frames_received, mod.stats.crc_errors, mod.stats.responses_sent, mod.stats.responses_dropped,
+         mod.stats.traffic_sent, module.dropped);
+
+  if (link)
+    unlink(link);
+  close(slave);
+  close(module.fd);
+  return 0;
+}
@@ -0,0 +1,289 @@
+// Finds the highest rate of frames from the radio module the bridge forwards to UDP without UART overflows, once with
+// the frames sent from the UART task and once through the pipeline to the network task. Frames are written into a pty
+// at increasing rates while every tcpip_api_call() takes the given time, like the round trip to the busy tcpip thread
+// of an ESP32. A rate is sustained if no UART_BUFFER_FULL was seen and every frame arrived at the CCU socket.
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include <atomic>
+#include <string>
+#include <thread>
+
+#include "driver/uart.h"
+#include "esphome/core/log.h"
+#include "hmframe.h"
+#include "lwip/priv/tcpip_priv.h"
+#include "radiomoduleconnector.h"
+#include "rawuartudplistener.h"
+
+static const char *TAG = "HmPipelineBenchmark";
+
+#define BENCHMARK_UART_QUEUE_SIZE 20
+#define BENCHMARK_RATE_STEP 1.25
+#define BENCHMARK_DRAIN_TIME 300000  // us after each step for frames still in flight
+
+typedef struct {
+  uint32_t callTime = 200;  // us
+  uint16_t size = 20;       // frame data bytes
+  int rxBufferSize = 256;
+  size_t pipelineSize = 4096;
+  uint32_t rate = 250;  // frames/s of the first step
+  uint32_t maxRate = 50000;
+  uint32_t duration = 2000;  // ms per step
+} benchmark_options_t;
+
+// The reset line of the radio module, a pty has none
+class BenchmarkOutput : public esphome::output::BinaryOutput {
+ protected:
+  void write_state(bool state) override {}
+};
+
+static int64_t _now() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+// The CCU side, only counts the frames
+class BenchmarkCcu {
+ private:
+  int _socket{-1};
+  sockaddr_in _bridge{};
+  uint8_t _counter{0};
+  std::thread _receiver;
+  std::atomic<bool> _running{false};
+
+  void _receiveLoop() {
+    uint8_t buffer[1500];
+    while (_running) {
+      ssize_t len = recv(_socket, buffer, sizeof(buffer), 0);
+      if (len >= 4 && buffer[0] == 7)
+        frames++;
+    }
+  }
+
+ public:
+  std::atomic<uint32_t> frames{0};
+
+  bool open(uint16_t port) {
+    _bridge.sin_family = AF_INET;
+    _bridge.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    _bridge.sin_port = htons(port);
+
+    _socket = socket(AF_INET, SOCK_DGRAM, 0);
+    if (_socket < 0)
+      return false;
+    timeval timeout = {0, 100000};
+    setsockopt(_socket, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    int bufferSize = 1 << 22;
+    setsockopt(_socket, SOL_SOCKET, SO_RCVBUF, &bufferSize, sizeof(bufferSize));
+
+    _running = true;
+    _receiver = std::thread(&BenchmarkCcu::_receiveLoop, this);
+    return true;
+  }
+
+  void close() {
+    sendPacket(6, NULL, 0);  // end connection
+    sendPacket(1, NULL, 0);  // disconnect
+    _running = false;
+    _receiver.join();
+    ::close(_socket);
+  }
+
+  void sendPacket(uint8_t type, const uint8_t *payload, size_t len) {
+    uint8_t packet[16];
+    packet[0] = type;
+    packet[1] = _counter++;
+    if (len)
+      memcpy(packet + 2, payload, len);
+    uint16_t crc = HMFrame::crc(packet, len + 2);
+    packet[len + 2] = crc >> 8;
+    packet[len + 3] = crc & 0xff;
+    sendto(_socket, packet, len + 4, 0, (sockaddr *) &_bridge, sizeof(_bridge));
+  }
+
+  void connect() {
+    uint8_t version = 1;
+    sendPacket(0, &version, 1);
+    usleep(100000);
+    sendPacket(5, NULL, 0);  // start connection
+    usleep(100000);
+  }
+};
+
+// Runs all rate steps against one bridge, returns the highest sustained rate
+static uint32_t _run(const benchmark_options_t &options, uart_port_t uartNum, uint16_t port, size_t pipelineSize) {
+  int master = posix_openpt(O_RDWR | O_NOCTTY);
+  if (master < 0 || grantpt(master) || unlockpt(master)) {
+    ESP_LOGE(TAG, "Could not open a pty");
+    return 0;
+  }
+  const char *ptyName = ptsname(master);
+  struct termios tio;
+  tcgetattr(master, &tio);
+  cfmakeraw(&tio);
+  tcsetattr(master, TCSANOW, &tio);
+
+  QueueHandle_t uartQueue;
+  if (uart_driver_install_host(uartNum, ptyName, options.rxBufferSize, BENCHMARK_UART_QUEUE_SIZE, &uartQueue) !=
+      ESP_OK) {
+    ESP_LOGE(TAG, "Could not open %s", ptyName);
+    return 0;
+  }
+
+  // both bridges stay up until the end, the first one idles while the second one is measured
+  BenchmarkOutput *reset = new BenchmarkOutput();
+  RadioModuleConnector *connector = new RadioModuleConnector(reset, &uartQueue, uartNum, options.rxBufferSize);
+  connector->setOverflowRecovery(true);
+  connector->setCore(1);
+  connector->start(false);
+
+  RawUartUdpListener *listener = new RawUartUdpListener(connector);
+  listener->setPipeline(pipelineSize, 0);
+  listener->setPort(port);
+  listener->start();
+
+  BenchmarkCcu ccu;
+  if (!ccu.open(port)) {
+    ESP_LOGE(TAG, "Could not open the CCU socket");
+    return 0;
+  }
+  ccu.connect();
+
+  unsigned char data[1024];
+  unsigned char frameBuffer[sizeof(data) * 2 + 16];
+  for (uint16_t i = 0; i < options.size; i++)
+    data[i] = i;
+  HMFrame frame;
+  frame.destination = HM_DST_HMIP;
+  frame.command = HM_CMD_HMIP_ACK;
+  frame.data = data;
+  frame.data_len = options.size;
+
+  printf("%s: UART RX buffer %d bytes, tcpip call %u us, %u byte frames", pipelineSize ? "Pipeline" : "UART task",
+         options.rxBufferSize, options.callTime, options.size);
+  if (pipelineSize)
+    printf(", ring %u bytes", listener->getPipeline()->getSize());
+  printf("\n  %8s %12s %10s %8s %10s %12s\n", "rate/s", "forwarded/s", "overflows", "lost", "ring hwm", "send p99 us");
+
+  uint32_t sustained = 0;
+  uint8_t counter = 0;
+  for (double rate = options.rate; rate <= options.maxRate; rate *= BENCHMARK_RATE_STEP) {
+    uint32_t overflows = connector->getOverflowCount();
+    uint32_t received = ccu.frames;
+    uint32_t written = 0;
+    if (pipelineSize)
+      listener->getPipeline()->resetHighWaterMark();
+    listener->resetLatency();
+
+    int64_t start = _now(), end = start + (int64_t) options.duration * 1000, nextKeepAlive = start;
+    for (int64_t now = start; now < end; now = _now()) {
+      // the frames due until now are written back to back, the UART delivers them in bursts as well
+      uint32_t due = (uint32_t) ((now - start) * rate / 1000000);
+      for (; written < due; written++) {
+        frame.counter = counter++;
+        uint16_t len = frame.encode(frameBuffer, sizeof(frameBuffer), true);
+        if (write(master, frameBuffer, len) != len)
+          ESP_LOGW(TAG, "Short write to the pty");
+      }
+      if (now >= nextKeepAlive) {
+        ccu.sendPacket(2, NULL, 0);
+        nextKeepAlive = now + 1000000;
+      }
+      usleep(1000);
+    }
+    usleep(BENCHMARK_DRAIN_TIME);
+
+    overflows = connector->getOverflowCount() - overflows;
+    uint32_t forwarded = ccu.frames - received;
+    uint32_t lost = written > forwarded ? written - forwarded : 0;
+    printf("  %8.0f %12.0f %10u %8u %10s %12u\n", rate, forwarded * 1000.0 / options.duration, overflows, lost,
+           pipelineSize ? std::to_string(listener->getPipeline()->getHighWaterMark()).c_str() : "-",
+           listener->getUdpSendLatency().getPercentile(99));
+    fflush(stdout);
+
+    if (overflows || lost)
+      break;
+    sustained = (uint32_t) rate;
+  }
+
+  ccu.close();
+  printf("  sustained %u frames/s\n\n", sustained);
+  return sustained;
+}
+
+static void _usage(const char *name) {
+  fprintf(stderr,
+          "Usage: %s [options]\n"
+          "  -c, --call-time <us>         time of each tcpip_api_call (default 200)\n"
+          "  -s, --size <bytes>           frame data bytes (default 20)\n"
+          "  -b, --rx-buffer <bytes>      UART RX ring buffer size (default 256)\n"
+          "  -P, --pipeline <bytes>       pipeline ring size (default 4096)\n"
+          "  -r, --rate <frames/s>        rate of the first step (default 250), raised by 25%% per step\n"
+          "  -R, --max-rate <frames/s>    rate of the last step (default 50000)\n"
+          "  -d, --duration <ms>          duration of each step (default 2000)\n",
+          name);
+}
+
+int main(int argc, char **argv) {
+  static const struct option longOptions[] = {
+      {"call-time", required_argument, NULL, 'c'}, {"size", required_argument, NULL, 's'},
+      {"rx-buffer", required_argument, NULL, 'b'}, {"pipeline", required_argument, NULL, 'P'},
+      {"rate", required_argument, NULL, 'r'},      {"max-rate", required_argument, NULL, 'R'},
+      {"duration", required_argument, NULL, 'd'},  {"help", no_argument, NULL, 'h'},
+      {NULL, 0, NULL, 0},
+  };
+
+  benchmark_options_t options;
+  int opt;
+  while ((opt = getopt_long(argc, argv, "c:s:b:P:r:R:d:h", longOptions, NULL)) != -1) {
+    switch (opt) {
+      case 'c':
+        options.callTime = atoi(optarg);
+        break;
+      case 's':
+        options.size = atoi(optarg);
+        break;
+      case 'b':
+        options.rxBufferSize = atoi(optarg);
+        break;
+      case 'P':
+        options.pipelineSize = atoi(optarg);
+        break;
+      case 'r':
+        options.rate = atoi(optarg);
+        break;
+      case 'R':
+        options.maxRate = atoi(optarg);
+        break;
+      case 'd':
+        options.duration = atoi(optarg);
+        break;
+      default:
+        _usage(argv[0]);
+        return opt == 'h' ? 0 : 1;
+    }
+  }
+
+  if (!options.rate || !options.duration || options.size > 1024 || !options.pipelineSize) {
+    _usage(argv[0]);
+    return 1;
+  }
+
+  esphome::host_log_level = ESPHOME_LOG_LEVEL_WARN;
+  tcpip_host_set_call_time(options.callTime);
+
+  uint32_t direct = _run(options, 1, RAW_UART_DEFAULT_PORT + 100, 0);
+  uint32_t pipeline = _run(options, 2, RAW_UART_DEFAULT_PORT + 101, options.pipelineSize);
+  printf("Sustained without overflow: UART task %u frames/s, pipeline %u frames/s\n", direct, pipeline);
+  return 0;
+}
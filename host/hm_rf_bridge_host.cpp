@@ -0,0 +1,287 @@
+// Runs the bridge core as Linux process: RadioModuleConnector and RadioModuleDetector on a tty, RawUartUdpListener
+// on UDP port 3008 (or the one given with -U), so the forwarding path can be profiled and tested without an ESP32.
+
+#include <getopt.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <atomic>
+
+#include "driver/uart.h"
+#include "dutycycleestimator.h"
+#include "esp_timer.h"
+#include "esphome/core/log.h"
+#include "radiomoduleconnector.h"
+#include "radiomoduledetector.h"
+#include "rawuartudplistener.h"
+#include "tracelog.h"
+
+static const char *TAG = "HmRFBridgeHost";
+
+#define HOST_UART_NUM 1
+#define HOST_UART_QUEUE_SIZE 20
+
+static std::atomic<bool> _running{true};
+
+// The reset line of the radio module, a pty has none so state changes are only logged
+class HostOutput : public esphome::output::BinaryOutput {
+ private:
+  const char *_name;
+
+ protected:
+  void write_state(bool state) override { ESP_LOGD(TAG, "%s %s", _name, state ? "on" : "off"); }
+
+ public:
+  HostOutput(const char *name) : _name(name) {}
+};
+
+static void _stop(int signal) { _running = false; }
+
+static void _usage(const char *name) {
+  fprintf(stderr,
+          "Usage: %s -u <tty> [options]\n"
+          "  -u, --uart <tty>             tty of the radio module (serial port or pty)\n"
+          "  -U, --udp-port <port>        raw-uart UDP port (default 3008)\n"
+          "  -b, --rx-buffer <bytes>      UART RX ring buffer size (default 256)\n"
+          "  -p, --pattern-detect         read frames on the 0xfd pattern interrupt\n"
+          "  -o, --overflow-recovery      keep complete frames on RX overflow\n"
+          "  -t, --rx-full-threshold <n>  RX FIFO full threshold in bytes\n"
+          "  -T, --rx-timeout <n>         RX timeout in symbol times\n"
+          "  -S, --tx-scheduler <us>      order frames to the module by class, aging time of bulk frames\n"
+          "  -B, --bulk-batch <bytes>     batch coprocessor firmware updates into UART writes of up to n bytes\n"
+          "  -P, --pipeline <bytes>       send frames to UDP from a network task, fed through a ring of n bytes\n"
+          "  -1, --single-task            serve UART and UDP from one task\n"
+          "  -l, --trace-log <records>    defer warnings and frame dumps of the bridge tasks to the main loop\n"
+          "  -s, --statistics <seconds>   print statistics every n seconds (default 10, 0 disables)\n"
+          "  -v, --verbose                more log output, may be repeated\n"
+          "  -q, --quiet                  only log warnings and errors\n",
+          name);
+}
+
+static const char *_radioModuleName(radio_module_type_t type) {
+  switch (type) {
+    case RADIO_MODULE_HM_MOD_RPI_PCB:
+      return "HM-MOD-RPI-PCB";
+    case RADIO_MODULE_RPI_RF_MOD:
+      return "RPI-RF-MOD";
+    case RADIO_MODULE_HMIP_RFUSB:
+      return "HmIP-RFUSB";
+    default:
+      return "unknown radio module";
+  }
+}
+
+static void _printStatistics(RawUartUdpListener *listener, DutyCycleEstimator *dutyCycleEstimator) {
+  const raw_uart_statistics_t &stats = listener->getStatistics();
+  ESP_LOGI(TAG, "UART->UDP %u frames / %u bytes, UDP->UART %u frames / %u bytes, keepalives %u sent / %u received",
+           stats.framesToUdp.load(), stats.bytesToUdp.load(), stats.framesToUart.load(), stats.bytesToUart.load(),
+           stats.keepAlivesSent.load(), stats.keepAlivesReceived.load());
+  ESP_LOGI(TAG, "Dropped %u oversized, %u not connected, %u CRC, %u pipeline full", stats.droppedOversized.load(),
+           stats.droppedNotConnected.load(), stats.droppedCrc.load(), stats.droppedPipelineFull.load());
+  ESP_LOGI(TAG, "Latency UART->UDP p50 %u us p99 %u us max %u us, UDP->UART p50 %u us p99 %u us max %u us",
+           listener->getUartToUdpLatency().getPercentile(50), listener->getUartToUdpLatency().getPercentile(99),
+           listener->getUartToUdpLatency().getMax(), listener->getUdpToUartLatency().getPercentile(50),
+           listener->getUdpToUartLatency().getPercentile(99), listener->getUdpToUartLatency().getMax());
+  int64_t now = esp_timer_get_time();
+  ESP_LOGI(TAG, "Duty cycle %.1f%% of the budget, HmIP %u frames / %u ms, BidCoS %u frames / %u ms",
+           dutyCycleEstimator->getUsage(now), dutyCycleEstimator->getFrames(DUTY_CYCLE_PROTOCOL_HMIP),
+           dutyCycleEstimator->getAirtime(DUTY_CYCLE_PROTOCOL_HMIP, now) / 1000,
+           dutyCycleEstimator->getFrames(DUTY_CYCLE_PROTOCOL_BIDCOS),
+           dutyCycleEstimator->getAirtime(DUTY_CYCLE_PROTOCOL_BIDCOS, now) / 1000);
+
+  if (listener->getBulkBatchSize()) {
+    const bulk_transfer_statistics_t &bulkStats = listener->getBulkTransferStatistics();
+    ESP_LOGI(TAG, "Bulk transfer %u sessions, last %u ms, %u frames / %u bytes in %u UART writes",
+             bulkStats.sessions.load(), bulkStats.lastDuration.load(), bulkStats.frames.load(),
+             bulkStats.bytes.load(), bulkStats.batches.load());
+  }
+
+  FrameRing *pipeline = listener->getPipeline();
+  if (pipeline) {
+    ESP_LOGI(TAG, "Pipeline %u bytes, high-water mark %u bytes, %u used", pipeline->getSize(),
+             pipeline->getHighWaterMark(), pipeline->getUsed());
+  }
+
+  TxScheduler *txScheduler = listener->getTxScheduler();
+  if (txScheduler) {
+    for (int txClass = 0; txClass < TX_CLASSES; txClass++) {
+      const tx_class_statistics_t &classStats = txScheduler->getStatistics((tx_class_t) txClass);
+      LatencyHistogram &queueTime = txScheduler->getQueueTime((tx_class_t) txClass);
+      ESP_LOGI(TAG, "TX %s: %u frames, %u aged, max depth %u, queued p50 %u us p99 %u us max %u us",
+               TxScheduler::getClassName((tx_class_t) txClass), classStats.frames.load(), classStats.aged.load(),
+               classStats.maxDepth.load(), queueTime.getPercentile(50), queueTime.getPercentile(99),
+               queueTime.getMax());
+    }
+  }
+}
+
+int main(int argc, char **argv) {
+  static const struct option options[] = {
+      {"uart", required_argument, NULL, 'u'},
+      {"udp-port", required_argument, NULL, 'U'},
+      {"rx-buffer", required_argument, NULL, 'b'},
+      {"pattern-detect", no_argument, NULL, 'p'},
+      {"overflow-recovery", no_argument, NULL, 'o'},
+      {"rx-full-threshold", required_argument, NULL, 't'},
+      {"rx-timeout", required_argument, NULL, 'T'},
+      {"tx-scheduler", required_argument, NULL, 'S'},
+      {"bulk-batch", required_argument, NULL, 'B'},
+      {"pipeline", required_argument, NULL, 'P'},
+      {"single-task", no_argument, NULL, '1'},
+      {"trace-log", required_argument, NULL, 'l'},
+      {"statistics", required_argument, NULL, 's'},
+      {"verbose", no_argument, NULL, 'v'},
+      {"quiet", no_argument, NULL, 'q'},
+      {"help", no_argument, NULL, 'h'},
+      {NULL, 0, NULL, 0},
+  };
+
+  const char *device = NULL;
+  int udpPort = RAW_UART_DEFAULT_PORT;
+  int rxBufferSize = 256;
+  bool patternDetect = false;
+  bool overflowRecovery = false;
+  int rxFullThreshold = -1;
+  int rxTimeout = -1;
+  int statisticsInterval = 10;
+  int txSchedulerAgingTime = -1;
+  int bulkBatchSize = 0;
+  int pipelineSize = 0;
+  bool singleTask = false;
+  int traceLogSize = 0;
+
+  int opt;
+  while ((opt = getopt_long(argc, argv, "u:U:b:pot:T:S:B:P:1l:s:vqh", options, NULL)) != -1) {
+    switch (opt) {
+      case 'u':
+        device = optarg;
+        break;
+      case 'U':
+        udpPort = atoi(optarg);
+        break;
+      case 'b':
+        rxBufferSize = atoi(optarg);
+        break;
+      case 'p':
+        patternDetect = true;
+        break;
+      case 'o':
+        overflowRecovery = true;
+        break;
+      case 't':
+        rxFullThreshold = atoi(optarg);
+        break;
+      case 'T':
+        rxTimeout = atoi(optarg);
+        break;
+      case 'S':
+        txSchedulerAgingTime = atoi(optarg);
+        break;
+      case 'B':
+        bulkBatchSize = atoi(optarg);
+        break;
+      case 'P':
+        pipelineSize = atoi(optarg);
+        break;
+      case '1':
+        singleTask = true;
+        break;
+      case 'l':
+        traceLogSize = atoi(optarg);
+        break;
+      case 's':
+        statisticsInterval = atoi(optarg);
+        break;
+      case 'v':
+        esphome::host_log_level =
+            esphome::host_log_level < ESPHOME_LOG_LEVEL_DEBUG ? ESPHOME_LOG_LEVEL_DEBUG : ESPHOME_LOG_LEVEL_VERBOSE;
+        break;
+      case 'q':
+        esphome::host_log_level = ESPHOME_LOG_LEVEL_WARN;
+        break;
+      default:
+        _usage(argv[0]);
+        return opt == 'h' ? 0 : 1;
+    }
+  }
+
+  if (!device) {
+    _usage(argv[0]);
+    return 1;
+  }
+
+  QueueHandle_t uartQueue;
+  if (uart_driver_install_host(HOST_UART_NUM, device, rxBufferSize, HOST_UART_QUEUE_SIZE, &uartQueue) != ESP_OK) {
+    ESP_LOGE(TAG, "Could not open %s", device);
+    return 1;
+  }
+
+  signal(SIGINT, _stop);
+  signal(SIGTERM, _stop);
+
+  HostOutput reset("reset");
+  RadioModuleConnector radioModuleConnector(&reset, &uartQueue, HOST_UART_NUM, rxBufferSize);
+  radioModuleConnector.setPatternDetect(patternDetect);
+  radioModuleConnector.setRxTuning(rxFullThreshold, rxTimeout);
+  radioModuleConnector.setOverflowRecovery(overflowRecovery);
+  radioModuleConnector.setSingleTask(singleTask);
+  DutyCycleEstimator dutyCycleEstimator;
+  radioModuleConnector.setDutyCycleEstimator(&dutyCycleEstimator);
+  TraceLog *traceLog = traceLogSize > 0 ? new TraceLog(traceLogSize) : nullptr;
+  radioModuleConnector.setTraceLog(traceLog);
+  radioModuleConnector.start();
+
+  RadioModuleDetector radioModuleDetector;
+  radioModuleDetector.detectRadioModule(&radioModuleConnector);
+
+  if (radioModuleDetector.getRadioModuleType() == RADIO_MODULE_NONE) {
+    ESP_LOGE(TAG, "Radio module could not be detected");
+    radioModuleConnector.stop();
+    if (traceLog) {
+      traceLog->flush(traceLog->getCapacity());
+      delete traceLog;
+    }
+    uart_driver_delete(HOST_UART_NUM);
+    return 2;
+  }
+
+  const uint8_t *firmwareVersion = radioModuleDetector.getFirmwareVersion();
+  ESP_LOGI(TAG, "Radio module %s, firmware %u.%u.%u, serial %s, SGTIN %s, BidCoS %06X, HmIP %06X",
+           _radioModuleName(radioModuleDetector.getRadioModuleType()),
+           firmwareVersion[0], firmwareVersion[1], firmwareVersion[2], radioModuleDetector.getSerial(),
+           radioModuleDetector.getSGTIN(), radioModuleDetector.getBidCosRadioMAC(),
+           radioModuleDetector.getHmIPRadioMAC());
+
+  RawUartUdpListener rawUartUdpListener(&radioModuleConnector);
+  TxScheduler txScheduler(txSchedulerAgingTime);
+  if (txSchedulerAgingTime >= 0)
+    rawUartUdpListener.setTxScheduler(&txScheduler);
+  rawUartUdpListener.setBulkTransfer(bulkBatchSize, BULK_TRANSFER_DEFAULT_IDLE_TIMEOUT);
+  rawUartUdpListener.setPipeline(pipelineSize, 0);
+  rawUartUdpListener.setPort(udpPort);
+  rawUartUdpListener.start();
+  ESP_LOGI(TAG, "Listening on UDP port %d", udpPort);
+
+  int elapsed = 0;
+  while (_running) {
+    usleep(100000);
+    if (traceLog)
+      traceLog->flush(traceLog->getCapacity());
+    if (statisticsInterval && ++elapsed >= statisticsInterval * 10) {
+      elapsed = 0;
+      _printStatistics(&rawUartUdpListener, &dutyCycleEstimator);
+    }
+  }
+
+  rawUartUdpListener.stop();
+  radioModuleConnector.stop();
+  _printStatistics(&rawUartUdpListener, &dutyCycleEstimator);
+  if (traceLog) {
+    traceLog->flush(traceLog->getCapacity());
+    ESP_LOGI(TAG, "Trace log: %u records, %u dropped", traceLog->getCapacity(), traceLog->getDropped());
+    delete traceLog;
+  }
+  uart_driver_delete(HOST_UART_NUM);
+  return 0;
+}
@@ -0,0 +1,126 @@
+#include "esp_timer.h"
+
+#include <pthread.h>
+#include <time.h>
+#include <condition_variable>
+#include <mutex>
+#include <set>
+#include <thread>
+
+struct esp_timer {
+  esp_timer_cb_t callback;
+  void *arg;
+  const char *name;
+  int64_t alarm;  // 0 while not armed
+  uint64_t period;
+};
+
+// never destroyed, the timer thread still waits on them while the process exits
+static std::mutex &_timerMutex = *new std::mutex();
+static std::condition_variable &_timerChanged = *new std::condition_variable();
+static std::set<esp_timer_handle_t> &_timers = *new std::set<esp_timer_handle_t>();
+static bool _timerTaskStarted = false;
+
+int64_t esp_timer_get_time(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (int64_t) now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+static void _timerTask() {
+  pthread_setname_np(pthread_self(), "esp_timer");
+  std::unique_lock<std::mutex> lock(_timerMutex);
+
+  for (;;) {
+    esp_timer_handle_t next = NULL;
+    for (esp_timer_handle_t timer : _timers) {
+      if (timer->alarm && (!next || timer->alarm < next->alarm))
+        next = timer;
+    }
+
+    if (!next) {
+      _timerChanged.wait(lock);
+      continue;
+    }
+
+    int64_t now = esp_timer_get_time();
+    if (next->alarm > now) {
+      _timerChanged.wait_for(lock, std::chrono::microseconds(next->alarm - now));
+      continue;
+    }
+
+    next->alarm = next->period ? next->alarm + next->period : 0;
+
+    // callbacks may start or stop timers
+    esp_timer_cb_t callback = next->callback;
+    void *arg = next->arg;
+    lock.unlock();
+    callback(arg);
+    lock.lock();
+  }
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *create_args, esp_timer_handle_t *out_handle) {
+  if (!create_args || !create_args->callback || !out_handle)
+    return ESP_ERR_INVALID_ARG;
+
+  esp_timer_handle_t timer = new esp_timer();
+  timer->callback = create_args->callback;
+  timer->arg = create_args->arg;
+  timer->name = create_args->name;
+  timer->alarm = 0;
+  timer->period = 0;
+
+  std::lock_guard<std::mutex> lock(_timerMutex);
+  if (!_timerTaskStarted) {
+    std::thread(_timerTask).detach();
+    _timerTaskStarted = true;
+  }
+  _timers.insert(timer);
+  *out_handle = timer;
+  return ESP_OK;
+}
+
+static esp_err_t _timerStart(esp_timer_handle_t timer, uint64_t timeout, uint64_t period) {
+  std::lock_guard<std::mutex> lock(_timerMutex);
+  if (timer->alarm)
+    return ESP_ERR_INVALID_STATE;
+
+  timer->alarm = esp_timer_get_time() + timeout;
+  if (!timer->alarm)
+    timer->alarm = 1;
+  timer->period = period;
+  _timerChanged.notify_all();
+  return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us) { return _timerStart(timer, timeout_us, 0); }
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period) {
+  return _timerStart(timer, period, period);
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer) {
+  std::lock_guard<std::mutex> lock(_timerMutex);
+  if (!timer->alarm)
+    return ESP_ERR_INVALID_STATE;
+
+  timer->alarm = 0;
+  _timerChanged.notify_all();
+  return ESP_OK;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t timer) {
+  std::lock_guard<std::mutex> lock(_timerMutex);
+  if (timer->alarm)
+    return ESP_ERR_INVALID_STATE;
+
+  _timers.erase(timer);
+  delete timer;
+  return ESP_OK;
+}
+
+bool esp_timer_is_active(esp_timer_handle_t timer) {
+  std::lock_guard<std::mutex> lock(_timerMutex);
+  return timer->alarm != 0;
+}
@@ -0,0 +1,65 @@
+#include "esphome/core/log.h"
+#include "esphome/core/helpers.h"
+#include "esp_timer.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <mutex>
+
+namespace esphome {
+
+int host_log_level = ESPHOME_LOG_LEVEL_INFO;
+
+static std::mutex _logMutex;
+
+void esp_log_printf_(int level, const char *tag, int line, const char *format, ...) {
+  static const char *const LEVELS = "-EWICDV";
+  int64_t now = esp_timer_get_time();
+
+  std::lock_guard<std::mutex> lock(_logMutex);
+  fprintf(stderr, "%6lld.%03lld [%c][%s:%d]: ", (long long) (now / 1000000), (long long) (now / 1000 % 1000),
+          LEVELS[level], tag, line);
+  va_list args;
+  va_start(args, format);
+  vfprintf(stderr, format, args);
+  va_end(args);
+  fputc('\n', stderr);
+}
+
+std::string format_hex_pretty(const uint8_t *data, size_t length) {
+  if (!length)
+    return "";
+
+  std::string ret;
+  ret.resize(3 * length - 1);
+  static const char *const HEX = "0123456789ABCDEF";
+  for (size_t i = 0; i < length; i++) {
+    ret[3 * i] = HEX[data[i] >> 4];
+    ret[3 * i + 1] = HEX[data[i] & 0x0f];
+    if (i != length - 1)
+      ret[3 * i + 2] = '.';
+  }
+  if (length > 4)
+    return ret + " (" + std::to_string(length) + ")";
+  return ret;
+}
+
+std::string str_sprintf(const char *fmt, ...) {
+  std::string str;
+  va_list args;
+
+  va_start(args, fmt);
+  size_t length = vsnprintf(nullptr, 0, fmt, args);
+  va_end(args);
+
+  str.resize(length);
+  va_start(args, fmt);
+  vsnprintf(&str[0], length + 1, fmt, args);
+  va_end(args);
+
+  return str;
+}
+
+uint32_t millis() { return (uint32_t) (esp_timer_get_time() / 1000); }
+
+}  // namespace esphome
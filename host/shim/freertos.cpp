@@ -0,0 +1,404 @@
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/event_groups.h"
+#include "freertos/ringbuf.h"
+#include "esp_timer.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+struct tskTaskControlBlock {
+  pthread_t thread;
+  TaskFunction_t function;
+  void *parameters;
+  char name[16];
+  std::mutex notifyMutex;
+  std::condition_variable notified;
+  uint32_t notifyValue;
+};
+
+static thread_local TaskHandle_t _currentTask = NULL;
+
+// Waits for pred, forever for portMAX_DELAY, returns the result of pred
+template<typename Predicate>
+static bool _waitFor(std::condition_variable &cond, std::unique_lock<std::mutex> &lock, TickType_t ticks,
+                     Predicate pred) {
+  if (ticks == portMAX_DELAY) {
+    cond.wait(lock, pred);
+    return true;
+  }
+  return cond.wait_for(lock, std::chrono::milliseconds((uint64_t) ticks * portTICK_PERIOD_MS), pred);
+}
+
+static void *_taskEntry(void *parameter) {
+  TaskHandle_t task = (TaskHandle_t) parameter;
+  _currentTask = task;
+  pthread_setname_np(pthread_self(), task->name);
+  task->function(task->parameters);
+  // returning from a task function is not allowed in FreeRTOS, treat it like vTaskDelete(NULL)
+  return NULL;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t pxTaskCode, const char *pcName, uint32_t usStackDepth, void *pvParameters,
+                       UBaseType_t uxPriority, TaskHandle_t *pxCreatedTask) {
+  TaskHandle_t task = new tskTaskControlBlock();
+
+  task->function = pxTaskCode;
+  task->parameters = pvParameters;
+  strncpy(task->name, pcName ? pcName : "task", sizeof(task->name) - 1);
+
+  pthread_attr_t attr;
+  pthread_attr_init(&attr);
+  pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+  int err = pthread_create(&task->thread, &attr, _taskEntry, task);
+  pthread_attr_destroy(&attr);
+
+  if (err) {
+    delete task;
+    return pdFAIL;
+  }
+
+  if (pxCreatedTask)
+    *pxCreatedTask = task;
+  return pdPASS;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t pxTaskCode, const char *pcName, uint32_t usStackDepth,
+                                   void *pvParameters, UBaseType_t uxPriority, TaskHandle_t *pxCreatedTask,
+                                   BaseType_t xCoreID) {
+  return xTaskCreate(pxTaskCode, pcName, usStackDepth, pvParameters, uxPriority, pxCreatedTask);
+}
+
+TaskHandle_t xTaskCreateStatic(TaskFunction_t pxTaskCode, const char *pcName, uint32_t ulStackDepth,
+                               void *pvParameters, UBaseType_t uxPriority, StackType_t *puxStackBuffer,
+                               StaticTask_t *pxTaskBuffer) {
+  // pthreads bring their own stack, the buffers only exist so the caller is built like for the ESP32
+  TaskHandle_t task = NULL;
+  xTaskCreate(pxTaskCode, pcName, ulStackDepth, pvParameters, uxPriority, &task);
+  return task;
+}
+
+TaskHandle_t xTaskCreateStaticPinnedToCore(TaskFunction_t pxTaskCode, const char *pcName, uint32_t ulStackDepth,
+                                          void *pvParameters, UBaseType_t uxPriority, StackType_t *puxStackBuffer,
+                                          StaticTask_t *pxTaskBuffer, BaseType_t xCoreID) {
+  return xTaskCreateStatic(pxTaskCode, pcName, ulStackDepth, pvParameters, uxPriority, puxStackBuffer, pxTaskBuffer);
+}
+
+void vTaskDelete(TaskHandle_t xTaskToDelete) {
+  if (!xTaskToDelete || xTaskToDelete == _currentTask) {
+    pthread_exit(NULL);
+  }
+
+  // the control block is leaked, the thread may still be unwinding
+  pthread_cancel(xTaskToDelete->thread);
+}
+
+void vTaskDelay(TickType_t xTicksToDelay) {
+  struct timespec delay = {
+      .tv_sec = (time_t) (xTicksToDelay * portTICK_PERIOD_MS / 1000),
+      .tv_nsec = (long) (xTicksToDelay * portTICK_PERIOD_MS % 1000) * 1000000L,
+  };
+  nanosleep(&delay, NULL);
+}
+
+TickType_t xTaskGetTickCount(void) { return (TickType_t) (esp_timer_get_time() / 1000 / portTICK_PERIOD_MS); }
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void) { return _currentTask; }
+
+BaseType_t xTaskNotifyGive(TaskHandle_t xTaskToNotify) {
+  std::lock_guard<std::mutex> lock(xTaskToNotify->notifyMutex);
+  xTaskToNotify->notifyValue++;
+  xTaskToNotify->notified.notify_one();
+  return pdPASS;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t xClearCountOnExit, TickType_t xTicksToWait) {
+  TaskHandle_t task = _currentTask;
+  std::unique_lock<std::mutex> lock(task->notifyMutex);
+  if (!_waitFor(task->notified, lock, xTicksToWait, [task] { return task->notifyValue > 0; }))
+    return 0;
+
+  uint32_t value = task->notifyValue;
+  task->notifyValue = xClearCountOnExit ? 0 : value - 1;
+  return value;
+}
+
+struct QueueDefinition {
+  std::mutex mutex;
+  std::condition_variable notEmpty;
+  std::condition_variable notFull;
+  UBaseType_t length;
+  UBaseType_t itemSize;
+  UBaseType_t count;
+  UBaseType_t head;
+  uint8_t *storage;
+  bool staticStorage;
+  QueueDefinition *set;  // container the queue is a member of
+};
+
+QueueHandle_t xQueueGenericCreate(UBaseType_t uxQueueLength, UBaseType_t uxItemSize, UBaseType_t uxInitialCount) {
+  QueueHandle_t queue = new QueueDefinition();
+  queue->length = uxQueueLength;
+  queue->itemSize = uxItemSize;
+  queue->count = uxInitialCount;
+  queue->head = 0;
+  queue->storage = uxItemSize ? (uint8_t *) calloc(uxQueueLength, uxItemSize) : NULL;
+  queue->staticStorage = false;
+  queue->set = NULL;
+  return queue;
+}
+
+QueueHandle_t xQueueGenericCreateStatic(UBaseType_t uxQueueLength, UBaseType_t uxItemSize, uint8_t *pucQueueStorage,
+                                       StaticQueue_t *pxStaticQueue, UBaseType_t uxInitialCount) {
+  QueueHandle_t queue = new QueueDefinition();
+  queue->length = uxQueueLength;
+  queue->itemSize = uxItemSize;
+  queue->count = uxInitialCount;
+  queue->head = 0;
+  queue->storage = uxItemSize ? pucQueueStorage : NULL;
+  queue->staticStorage = true;
+  queue->set = NULL;
+  return queue;
+}
+
+BaseType_t xQueueSend(QueueHandle_t xQueue, const void *pvItemToQueue, TickType_t xTicksToWait) {
+  std::unique_lock<std::mutex> lock(xQueue->mutex);
+  if (!_waitFor(xQueue->notFull, lock, xTicksToWait, [xQueue] { return xQueue->count < xQueue->length; }))
+    return errQUEUE_FULL;
+
+  if (xQueue->itemSize) {
+    UBaseType_t tail = (xQueue->head + xQueue->count) % xQueue->length;
+    memcpy(xQueue->storage + tail * xQueue->itemSize, pvItemToQueue, xQueue->itemSize);
+  }
+  xQueue->count++;
+  xQueue->notEmpty.notify_one();
+  QueueSetHandle_t set = xQueue->set;
+  lock.unlock();
+
+  // the item is in place before the set reports it
+  if (set)
+    xQueueSend(set, &xQueue, 0);
+  return pdPASS;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t xQueue, void *pvBuffer, TickType_t xTicksToWait) {
+  std::unique_lock<std::mutex> lock(xQueue->mutex);
+  if (!_waitFor(xQueue->notEmpty, lock, xTicksToWait, [xQueue] { return xQueue->count > 0; }))
+    return errQUEUE_EMPTY;
+
+  if (xQueue->itemSize) {
+    memcpy(pvBuffer, xQueue->storage + xQueue->head * xQueue->itemSize, xQueue->itemSize);
+    xQueue->head = (xQueue->head + 1) % xQueue->length;
+  }
+  xQueue->count--;
+  xQueue->notFull.notify_one();
+  return pdPASS;
+}
+
+BaseType_t xQueueReset(QueueHandle_t xQueue) {
+  std::lock_guard<std::mutex> lock(xQueue->mutex);
+  xQueue->count = 0;
+  xQueue->head = 0;
+  xQueue->notFull.notify_all();
+  return pdPASS;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t xQueue) {
+  std::lock_guard<std::mutex> lock(xQueue->mutex);
+  return xQueue->count;
+}
+
+UBaseType_t uxQueueSpacesAvailable(QueueHandle_t xQueue) {
+  std::lock_guard<std::mutex> lock(xQueue->mutex);
+  return xQueue->length - xQueue->count;
+}
+
+QueueSetHandle_t xQueueCreateSet(UBaseType_t uxEventQueueLength) {
+  return xQueueCreate(uxEventQueueLength, sizeof(QueueSetMemberHandle_t));
+}
+
+BaseType_t xQueueAddToSet(QueueSetMemberHandle_t xQueueOrSemaphore, QueueSetHandle_t xQueueSet) {
+  std::lock_guard<std::mutex> lock(xQueueOrSemaphore->mutex);
+  // like FreeRTOS, only empty queues can be added so the set does not miss items
+  if (xQueueOrSemaphore->set || xQueueOrSemaphore->count)
+    return pdFAIL;
+  xQueueOrSemaphore->set = xQueueSet;
+  return pdPASS;
+}
+
+BaseType_t xQueueRemoveFromSet(QueueSetMemberHandle_t xQueueOrSemaphore, QueueSetHandle_t xQueueSet) {
+  std::lock_guard<std::mutex> lock(xQueueOrSemaphore->mutex);
+  if (xQueueOrSemaphore->set != xQueueSet || xQueueOrSemaphore->count)
+    return pdFAIL;
+  xQueueOrSemaphore->set = NULL;
+  return pdPASS;
+}
+
+QueueSetMemberHandle_t xQueueSelectFromSet(QueueSetHandle_t xQueueSet, TickType_t xTicksToWait) {
+  QueueSetMemberHandle_t member = NULL;
+  xQueueReceive(xQueueSet, &member, xTicksToWait);
+  return member;
+}
+
+void vQueueDelete(QueueHandle_t xQueue) {
+  if (!xQueue->staticStorage)
+    free(xQueue->storage);
+  delete xQueue;
+}
+
+struct EventGroupDef_t {
+  std::mutex mutex;
+  std::condition_variable changed;
+  EventBits_t bits;
+};
+
+EventGroupHandle_t xEventGroupCreate(void) {
+  EventGroupHandle_t group = new EventGroupDef_t();
+  group->bits = 0;
+  return group;
+}
+
+EventBits_t xEventGroupSetBits(EventGroupHandle_t xEventGroup, const EventBits_t uxBitsToSet) {
+  std::lock_guard<std::mutex> lock(xEventGroup->mutex);
+  xEventGroup->bits |= uxBitsToSet;
+  xEventGroup->changed.notify_all();
+  return xEventGroup->bits;
+}
+
+EventBits_t xEventGroupClearBits(EventGroupHandle_t xEventGroup, const EventBits_t uxBitsToClear) {
+  std::lock_guard<std::mutex> lock(xEventGroup->mutex);
+  EventBits_t bits = xEventGroup->bits;
+  xEventGroup->bits &= ~uxBitsToClear;
+  return bits;
+}
+
+EventBits_t xEventGroupGetBits(EventGroupHandle_t xEventGroup) {
+  std::lock_guard<std::mutex> lock(xEventGroup->mutex);
+  return xEventGroup->bits;
+}
+
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t xEventGroup, const EventBits_t uxBitsToWaitFor,
+                                const BaseType_t xClearOnExit, const BaseType_t xWaitForAllBits,
+                                TickType_t xTicksToWait) {
+  std::unique_lock<std::mutex> lock(xEventGroup->mutex);
+  auto satisfied = [&] {
+    EventBits_t set = xEventGroup->bits & uxBitsToWaitFor;
+    return xWaitForAllBits ? set == uxBitsToWaitFor : set != 0;
+  };
+
+  bool ok = _waitFor(xEventGroup->changed, lock, xTicksToWait, satisfied);
+  EventBits_t bits = xEventGroup->bits;
+  if (ok && xClearOnExit)
+    xEventGroup->bits &= ~uxBitsToWaitFor;
+  return bits;
+}
+
+EventGroupHandle_t xEventGroupCreateStatic(StaticEventGroup_t *pxEventGroupBuffer) { return xEventGroupCreate(); }
+
+void vEventGroupDelete(EventGroupHandle_t xEventGroup) { delete xEventGroup; }
+
+// Items are allocated one by one, the capacity is accounted like the item headers of the ESP-IDF ring buffer
+#define RINGBUF_ITEM_HEADER 8
+#define RINGBUF_ITEM_SIZE(size) ((((size) + 3) & ~3) + RINGBUF_ITEM_HEADER)
+
+typedef struct {
+  size_t size;
+  bool complete;
+} ringbuf_item_t;
+
+struct Ringbuffer_t {
+  std::mutex mutex;
+  std::condition_variable itemComplete;
+  std::condition_variable spaceFreed;
+  size_t capacity;
+  size_t used;
+  std::deque<ringbuf_item_t *> items;
+};
+
+RingbufHandle_t xRingbufferCreate(size_t xBufferSize, RingbufferType_t xBufferType) {
+  if (xBufferType != RINGBUF_TYPE_NOSPLIT)
+    return NULL;
+
+  RingbufHandle_t ringbuf = new Ringbuffer_t();
+  ringbuf->capacity = xBufferSize;
+  ringbuf->used = 0;
+  return ringbuf;
+}
+
+BaseType_t xRingbufferSendAcquire(RingbufHandle_t xRingbuffer, void **ppvItem, size_t xItemSize,
+                                  TickType_t xTicksToWait) {
+  size_t needed = RINGBUF_ITEM_SIZE(xItemSize);
+  std::unique_lock<std::mutex> lock(xRingbuffer->mutex);
+  if (needed > xRingbuffer->capacity ||
+      !_waitFor(xRingbuffer->spaceFreed, lock, xTicksToWait,
+                [xRingbuffer, needed] { return xRingbuffer->used + needed <= xRingbuffer->capacity; }))
+    return pdFALSE;
+
+  ringbuf_item_t *item = (ringbuf_item_t *) malloc(sizeof(ringbuf_item_t) + xItemSize);
+  if (!item)
+    return pdFALSE;
+  item->size = xItemSize;
+  item->complete = false;
+
+  xRingbuffer->used += needed;
+  xRingbuffer->items.push_back(item);
+  *ppvItem = item + 1;
+  return pdTRUE;
+}
+
+BaseType_t xRingbufferSendComplete(RingbufHandle_t xRingbuffer, void *pvItem) {
+  std::lock_guard<std::mutex> lock(xRingbuffer->mutex);
+  ((ringbuf_item_t *) pvItem - 1)->complete = true;
+  xRingbuffer->itemComplete.notify_all();
+  return pdTRUE;
+}
+
+BaseType_t xRingbufferSend(RingbufHandle_t xRingbuffer, const void *pvItem, size_t xItemSize, TickType_t xTicksToWait) {
+  void *item;
+  if (xRingbufferSendAcquire(xRingbuffer, &item, xItemSize, xTicksToWait) != pdTRUE)
+    return pdFALSE;
+  memcpy(item, pvItem, xItemSize);
+  return xRingbufferSendComplete(xRingbuffer, item);
+}
+
+void *xRingbufferReceive(RingbufHandle_t xRingbuffer, size_t *pxItemSize, TickType_t xTicksToWait) {
+  std::unique_lock<std::mutex> lock(xRingbuffer->mutex);
+  // items are received in the order they were acquired, like in the no-split ring buffer
+  if (!_waitFor(xRingbuffer->itemComplete, lock, xTicksToWait,
+                [xRingbuffer] { return !xRingbuffer->items.empty() && xRingbuffer->items.front()->complete; }))
+    return NULL;
+
+  ringbuf_item_t *item = xRingbuffer->items.front();
+  xRingbuffer->items.pop_front();
+  if (pxItemSize)
+    *pxItemSize = item->size;
+  return item + 1;
+}
+
+void vRingbufferReturnItem(RingbufHandle_t xRingbuffer, void *pvItem) {
+  ringbuf_item_t *item = (ringbuf_item_t *) pvItem - 1;
+  std::lock_guard<std::mutex> lock(xRingbuffer->mutex);
+  xRingbuffer->used -= RINGBUF_ITEM_SIZE(item->size);
+  free(item);
+  xRingbuffer->spaceFreed.notify_all();
+}
+
+size_t xRingbufferGetCurFreeSize(RingbufHandle_t xRingbuffer) {
+  std::lock_guard<std::mutex> lock(xRingbuffer->mutex);
+  size_t free = xRingbuffer->capacity - xRingbuffer->used;
+  return free > RINGBUF_ITEM_HEADER ? free - RINGBUF_ITEM_HEADER : 0;
+}
+
+void vRingbufferDelete(RingbufHandle_t xRingbuffer) {
+  for (ringbuf_item_t *item : xRingbuffer->items)
+    free(item);
+  delete xRingbuffer;
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+// Host shim of the ESPHome binary output, the host program decides what a state change does
+
+namespace esphome::output {
+
+class BinaryOutput {
+ public:
+  virtual ~BinaryOutput() = default;
+
+  virtual void set_state(bool state) { state ? turn_on() : turn_off(); }
+  virtual void turn_on() { write_state(true); }
+  virtual void turn_off() { write_state(false); }
+
+ protected:
+  virtual void write_state(bool state) = 0;
+};
+
+}  // namespace esphome::output
@@ -0,0 +1,15 @@
+#pragma once
+
+// Host shim of the ESPHome helpers used by the bridge core
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+
+namespace esphome {
+
+std::string format_hex_pretty(const uint8_t *data, size_t length);
+std::string str_sprintf(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+uint32_t millis();
+
+}  // namespace esphome
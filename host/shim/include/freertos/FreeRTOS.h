@@ -0,0 +1,44 @@
+#pragma once
+
+// Host shim of the FreeRTOS API used by the bridge, see host/shim/freertos.cpp
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint8_t StackType_t;
+
+// Storage of statically created objects, the shim keeps its own state on the heap and only uses the queue storage
+typedef struct {
+  void *reserved;
+} StaticTask_t;
+typedef struct {
+  void *reserved;
+} StaticQueue_t;
+typedef StaticQueue_t StaticSemaphore_t;
+typedef struct {
+  void *reserved;
+} StaticEventGroup_t;
+
+#define pdFALSE ((BaseType_t) 0)
+#define pdTRUE ((BaseType_t) 1)
+#define pdFAIL pdFALSE
+#define pdPASS pdTRUE
+#define errQUEUE_EMPTY pdFALSE
+#define errQUEUE_FULL pdFALSE
+
+#define configTICK_RATE_HZ 1000
+#define portMAX_DELAY ((TickType_t) 0xffffffffUL)
+#define portTICK_PERIOD_MS ((TickType_t) 1000 / configTICK_RATE_HZ)
+#define pdMS_TO_TICKS(xTimeInMs) ((TickType_t) (((uint64_t) (xTimeInMs) * configTICK_RATE_HZ) / 1000U))
+
+#define tskNO_AFFINITY ((BaseType_t) 0x7fffffff)
+#define portNUM_PROCESSORS 2
+
+#define BIT0 0x00000001
+#define BIT1 0x00000002
+#define BIT2 0x00000004
+#define BIT3 0x00000008
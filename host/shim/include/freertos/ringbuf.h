@@ -0,0 +1,30 @@
+#pragma once
+
+#include "FreeRTOS.h"
+
+// Only no-split ring buffers are supported
+typedef struct Ringbuffer_t *RingbufHandle_t;
+
+typedef enum {
+  RINGBUF_TYPE_NOSPLIT = 0,
+  RINGBUF_TYPE_ALLOWSPLIT,
+  RINGBUF_TYPE_BYTEBUF,
+} RingbufferType_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+RingbufHandle_t xRingbufferCreate(size_t xBufferSize, RingbufferType_t xBufferType);
+BaseType_t xRingbufferSend(RingbufHandle_t xRingbuffer, const void *pvItem, size_t xItemSize, TickType_t xTicksToWait);
+BaseType_t xRingbufferSendAcquire(RingbufHandle_t xRingbuffer, void **ppvItem, size_t xItemSize,
+                                  TickType_t xTicksToWait);
+BaseType_t xRingbufferSendComplete(RingbufHandle_t xRingbuffer, void *pvItem);
+void *xRingbufferReceive(RingbufHandle_t xRingbuffer, size_t *pxItemSize, TickType_t xTicksToWait);
+void vRingbufferReturnItem(RingbufHandle_t xRingbuffer, void *pvItem);
+size_t xRingbufferGetCurFreeSize(RingbufHandle_t xRingbuffer);
+void vRingbufferDelete(RingbufHandle_t xRingbuffer);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,15 @@
+#pragma once
+
+#include "queue.h"
+
+// Like in FreeRTOS semaphores are queues without item storage
+typedef QueueHandle_t SemaphoreHandle_t;
+
+#define xSemaphoreCreateBinary() xQueueGenericCreate(1, 0, 0)
+#define xSemaphoreCreateMutex() xQueueGenericCreate(1, 0, 1)
+#define xSemaphoreCreateBinaryStatic(pxSemaphoreBuffer) xQueueGenericCreateStatic(1, 0, NULL, (pxSemaphoreBuffer), 0)
+#define xSemaphoreCreateMutexStatic(pxMutexBuffer) xQueueGenericCreateStatic(1, 0, NULL, (pxMutexBuffer), 1)
+#define xSemaphoreCreateCounting(uxMaxCount, uxInitialCount) xQueueGenericCreate((uxMaxCount), 0, (uxInitialCount))
+#define xSemaphoreTake(xSemaphore, xBlockTime) xQueueReceive((xSemaphore), NULL, (xBlockTime))
+#define xSemaphoreGive(xSemaphore) xQueueSend((xSemaphore), NULL, 0)
+#define vSemaphoreDelete(xSemaphore) vQueueDelete((xSemaphore))
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "opt.h"
+#include <arpa/inet.h>
+
+typedef struct ip4_addr {
+  u32_t addr;
+} ip4_addr_t;
+
+// like an lwIP build without IPv6 ip_addr_t is the IPv4 address
+typedef ip4_addr_t ip_addr_t;
+
+#define IPADDR_TYPE_V4 0U
+#define ip_2_ip4(ipaddr) (ipaddr)
+#define ip4_addr_set_u32(dest_ipaddr, src_u32) ((dest_ipaddr)->addr = (src_u32))
+#define IP_SET_TYPE(ipaddr, iptype)
+
+extern const ip_addr_t ip_addr_any;
+#define IP_ADDR_ANY (&ip_addr_any)
+#define IP4_ADDR_ANY (&ip_addr_any)
+
+#define IP_HLEN 20
+
+struct ip_hdr {
+  u8_t _v_hl;
+  u8_t _tos;
+  u16_t _len;
+  u16_t _id;
+  u16_t _offset;
+  u8_t _ttl;
+  u8_t _proto;
+  u16_t _chksum;
+  ip4_addr_t src;
+  ip4_addr_t dest;
+} __attribute__((packed));
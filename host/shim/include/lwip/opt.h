@@ -0,0 +1,17 @@
+#pragma once
+
+// Host shim of the lwIP raw UDP API used by udphelper.h, IPv4 only, see host/shim/lwip.cpp
+
+#include <stdint.h>
+
+typedef uint8_t u8_t;
+typedef uint16_t u16_t;
+typedef uint32_t u32_t;
+typedef int8_t err_t;
+
+#define ERR_OK 0
+#define ERR_MEM -1
+#define ERR_BUF -2
+#define ERR_RTE -4
+#define ERR_USE -8
+#define ERR_VAL -6
@@ -0,0 +1,24 @@
+#pragma once
+
+#include "../opt.h"
+
+struct tcpip_api_call_data {
+  err_t err;
+};
+
+typedef err_t (*tcpip_api_call_fn)(struct tcpip_api_call_data *call);
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Runs fn with the core lock held, the receive threads of the UDP pcbs call their callbacks with it as well
+err_t tcpip_api_call(tcpip_api_call_fn fn, struct tcpip_api_call_data *call);
+
+// Host only: every tcpip_api_call() additionally takes callTime us, like the round trip to the busy tcpip thread of
+// an ESP32
+void tcpip_host_set_call_time(uint32_t callTime);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,7 @@
+#pragma once
+
+// the BSD socket API of lwIP is the one of the host
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "opt.h"
+#include "inet.h"
+
+typedef enum {
+  PBUF_TRANSPORT,
+  PBUF_IP,
+  PBUF_RAW,
+} pbuf_layer;
+
+typedef enum {
+  PBUF_RAM,
+} pbuf_type;
+
+// Single buffer pbufs, PBUF_TRANSPORT reserves room for the IP and UDP header in front of the payload
+struct pbuf {
+  struct pbuf *next;
+  void *payload;
+  u16_t tot_len;
+  u16_t len;
+};
+
+#define UDP_HLEN 8
+
+struct udp_hdr {
+  u16_t src;
+  u16_t dest;
+  u16_t len;
+  u16_t chksum;
+} __attribute__((packed));
+
+struct udp_pcb;
+
+typedef void (*udp_recv_fn)(void *arg, struct udp_pcb *pcb, struct pbuf *p, const ip_addr_t *addr, u16_t port);
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct pbuf *pbuf_alloc(pbuf_layer layer, u16_t length, pbuf_type type);
+u8_t pbuf_free(struct pbuf *p);
+
+struct udp_pcb *udp_new(void);
+void udp_remove(struct udp_pcb *pcb);
+err_t udp_bind(struct udp_pcb *pcb, const ip_addr_t *ipaddr, u16_t port);
+void udp_disconnect(struct udp_pcb *pcb);
+err_t udp_sendto(struct udp_pcb *pcb, struct pbuf *p, const ip_addr_t *dst_ip, u16_t dst_port);
+void udp_recv(struct udp_pcb *pcb, udp_recv_fn recv, void *recv_arg);
+
+#ifdef __cplusplus
+}
+#endif
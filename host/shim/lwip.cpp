@@ -0,0 +1,189 @@
+#include "lwip/udp.h"
+#include "lwip/priv/tcpip_priv.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <unistd.h>
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+#define PBUF_TRANSPORT_HLEN (IP_HLEN + UDP_HLEN)
+#define UDP_MAX_PAYLOAD 65507
+
+const ip_addr_t ip_addr_any = {.addr = 0};
+
+// stands in for the lwIP core lock of the tcpip thread
+static std::recursive_mutex _coreLock;
+static std::atomic<uint32_t> _callTime{0};
+
+struct udp_pcb {
+  int fd;
+  udp_recv_fn recv;
+  void *recvArg;
+  bool receiving;
+  std::atomic<bool> removed;
+};
+
+err_t tcpip_api_call(tcpip_api_call_fn fn, struct tcpip_api_call_data *call) {
+  std::lock_guard<std::recursive_mutex> lock(_coreLock);
+  err_t err = fn(call);
+  call->err = err;
+  uint32_t callTime = _callTime.load(std::memory_order_relaxed);
+  if (callTime)
+    usleep(callTime);
+  return err;
+}
+
+void tcpip_host_set_call_time(uint32_t callTime) { _callTime.store(callTime, std::memory_order_relaxed); }
+
+struct pbuf *pbuf_alloc(pbuf_layer layer, u16_t length, pbuf_type type) {
+  size_t headroom = layer == PBUF_TRANSPORT ? PBUF_TRANSPORT_HLEN : (layer == PBUF_IP ? IP_HLEN : 0);
+  struct pbuf *p = (struct pbuf *) malloc(sizeof(struct pbuf) + headroom + length);
+  if (!p)
+    return NULL;
+
+  p->next = NULL;
+  p->payload = (uint8_t *) (p + 1) + headroom;
+  p->tot_len = length;
+  p->len = length;
+  return p;
+}
+
+u8_t pbuf_free(struct pbuf *p) {
+  u8_t count = 0;
+  while (p) {
+    struct pbuf *next = p->next;
+    free(p);
+    p = next;
+    count++;
+  }
+  return count;
+}
+
+static void _receiveThread(struct udp_pcb *pcb) {
+  pthread_setname_np(pthread_self(), "tcpip_udp");
+  uint8_t *buffer = (uint8_t *) malloc(UDP_MAX_PAYLOAD);
+
+  while (!pcb->removed) {
+    struct pollfd pfd = {.fd = pcb->fd, .events = POLLIN, .revents = 0};
+    if (poll(&pfd, 1, 100) <= 0)
+      continue;
+
+    struct sockaddr_in from;
+    socklen_t fromLen = sizeof(from);
+    ssize_t len = recvfrom(pcb->fd, buffer, UDP_MAX_PAYLOAD, 0, (struct sockaddr *) &from, &fromLen);
+    if (len < 0)
+      continue;
+
+    struct pbuf *p = pbuf_alloc(PBUF_TRANSPORT, (u16_t) len, PBUF_RAM);
+    if (!p)
+      continue;
+    memcpy(p->payload, buffer, len);
+
+    // receivers may look at the headers in front of the payload like with lwIP
+    struct ip_hdr *iphdr = (struct ip_hdr *) ((uint8_t *) p->payload - UDP_HLEN - IP_HLEN);
+    memset(iphdr, 0, IP_HLEN);
+    iphdr->src.addr = from.sin_addr.s_addr;
+    struct udp_hdr *udphdr = (struct udp_hdr *) ((uint8_t *) p->payload - UDP_HLEN);
+    memset(udphdr, 0, UDP_HLEN);
+    udphdr->src = from.sin_port;
+    udphdr->len = htons((u16_t) (len + UDP_HLEN));
+
+    ip_addr_t addr = {.addr = from.sin_addr.s_addr};
+
+    std::lock_guard<std::recursive_mutex> lock(_coreLock);
+    if (pcb->recv && !pcb->removed)
+      pcb->recv(pcb->recvArg, pcb, p, &addr, ntohs(from.sin_port));
+    else
+      pbuf_free(p);
+  }
+
+  free(buffer);
+  close(pcb->fd);
+  delete pcb;
+}
+
+struct udp_pcb *udp_new(void) {
+  int fd = socket(AF_INET, SOCK_DGRAM, 0);
+  if (fd < 0)
+    return NULL;
+
+  struct udp_pcb *pcb = new udp_pcb();
+  pcb->fd = fd;
+  pcb->recv = NULL;
+  pcb->recvArg = NULL;
+  pcb->receiving = false;
+  pcb->removed = false;
+  return pcb;
+}
+
+void udp_remove(struct udp_pcb *pcb) {
+  if (pcb->receiving) {
+    // the receive thread might wait for the core lock right now, it cleans up on its own
+    pcb->removed = true;
+    return;
+  }
+
+  close(pcb->fd);
+  delete pcb;
+}
+
+err_t udp_bind(struct udp_pcb *pcb, const ip_addr_t *ipaddr, u16_t port) {
+  int reuse = 1;
+  setsockopt(pcb->fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+  struct sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = ipaddr ? ipaddr->addr : INADDR_ANY;
+  addr.sin_port = htons(port);
+  if (bind(pcb->fd, (struct sockaddr *) &addr, sizeof(addr)) < 0)
+    return ERR_USE;
+
+  if (!pcb->receiving) {
+    pcb->receiving = true;
+    std::thread(_receiveThread, pcb).detach();
+  }
+  return ERR_OK;
+}
+
+void udp_disconnect(struct udp_pcb *pcb) {
+  // pcbs are never connected, there is no remote address to clear
+}
+
+err_t udp_sendto(struct udp_pcb *pcb, struct pbuf *p, const ip_addr_t *dst_ip, u16_t dst_port) {
+  struct sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = dst_ip->addr;
+  addr.sin_port = htons(dst_port);
+
+  ssize_t sent;
+  if (!p->next) {
+    sent = sendto(pcb->fd, p->payload, p->len, 0, (struct sockaddr *) &addr, sizeof(addr));
+  } else {
+    uint8_t *buffer = (uint8_t *) malloc(p->tot_len);
+    if (!buffer)
+      return ERR_MEM;
+    size_t pos = 0;
+    for (struct pbuf *q = p; q; q = q->next) {
+      memcpy(buffer + pos, q->payload, q->len);
+      pos += q->len;
+    }
+    sent = sendto(pcb->fd, buffer, pos, 0, (struct sockaddr *) &addr, sizeof(addr));
+    free(buffer);
+  }
+
+  if (sent < 0)
+    return errno == ENOBUFS || errno == ENOMEM ? ERR_MEM : ERR_RTE;
+  return ERR_OK;
+}
+
+void udp_recv(struct udp_pcb *pcb, udp_recv_fn recv, void *recv_arg) {
+  pcb->recv = recv;
+  pcb->recvArg = recv_arg;
+}
@@ -0,0 +1,330 @@
+#include "driver/uart.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#define UART_FIFO_LEN 128
+#define UART_DEFAULT_RX_FULL_THRESHOLD 120
+
+// The reader thread plays the part of the UART FIFO and the ISR: it moves bytes from the tty into the RX ring buffer,
+// tracks pattern positions and posts the same events as the ESP-IDF driver
+typedef struct {
+  int fd;
+  std::thread reader;
+  std::atomic<bool> running;
+  std::mutex mutex;
+  std::condition_variable dataAvailable;
+  std::condition_variable spaceAvailable;
+  std::vector<uint8_t> rxBuffer;
+  size_t rxHead;
+  size_t rxCount;
+  bool bufferFullPosted;
+  QueueHandle_t eventQueue;
+  int rxFullThreshold;
+  bool patternEnabled;
+  char patternChr;
+  size_t patternQueueLength;
+  std::deque<int> patternPositions;  // relative to the read position of the RX ring buffer
+} uart_host_t;
+
+static uart_host_t *_uarts[UART_NUM_MAX];
+
+static uart_host_t *_uart(uart_port_t uart_num) {
+  if (uart_num < 0 || uart_num >= UART_NUM_MAX)
+    return NULL;
+  return _uarts[uart_num];
+}
+
+static void _postEvent(uart_host_t *uart, uart_event_type_t type, size_t size) {
+  if (!uart->eventQueue)
+    return;
+
+  uart_event_t event = {};
+  event.type = type;
+  event.size = size;
+  // from the ISR the driver never blocks, events get lost on a full queue
+  xQueueSend(uart->eventQueue, &event, 0);
+}
+
+static void _readerThread(uart_host_t *uart) {
+  pthread_setname_np(pthread_self(), "uart_rx");
+  uint8_t fifo[UART_FIFO_LEN];
+
+  while (uart->running) {
+    size_t chunk;
+    {
+      std::unique_lock<std::mutex> lock(uart->mutex);
+      size_t space = uart->rxBuffer.size() - uart->rxCount;
+      if (!space) {
+        // like the driver the FIFO is not read anymore until there is room in the ring buffer, the tty buffers
+        if (!uart->bufferFullPosted) {
+          uart->bufferFullPosted = true;
+          _postEvent(uart, UART_BUFFER_FULL, 0);
+        }
+        uart->spaceAvailable.wait_for(lock, std::chrono::milliseconds(100));
+        continue;
+      }
+      chunk = (size_t) uart->rxFullThreshold;
+      if (chunk > space)
+        chunk = space;
+    }
+
+    struct pollfd pfd = {.fd = uart->fd, .events = POLLIN, .revents = 0};
+    if (poll(&pfd, 1, 100) <= 0)
+      continue;
+
+    ssize_t len = read(uart->fd, fifo, chunk);
+    if (len <= 0) {
+      if (len < 0 && errno != EAGAIN && errno != EINTR && errno != EIO)
+        break;
+      // EIO on a pty master while no one has the slave open
+      if (len < 0 && errno == EIO)
+        usleep(100000);
+      continue;
+    }
+
+    std::vector<int> patterns;
+    {
+      std::lock_guard<std::mutex> lock(uart->mutex);
+      size_t size = uart->rxBuffer.size();
+      for (ssize_t i = 0; i < len; i++) {
+        uart->rxBuffer[(uart->rxHead + uart->rxCount) % size] = fifo[i];
+        if (uart->patternEnabled && fifo[i] == (uint8_t) uart->patternChr) {
+          if (uart->patternPositions.size() < uart->patternQueueLength) {
+            uart->patternPositions.push_back((int) uart->rxCount);
+            patterns.push_back((int) uart->rxCount);
+          }
+        }
+        uart->rxCount++;
+      }
+      uart->bufferFullPosted = false;
+      uart->dataAvailable.notify_all();
+    }
+
+    _postEvent(uart, UART_DATA, len);
+    for (size_t i = 0; i < patterns.size(); i++)
+      _postEvent(uart, UART_PATTERN_DET, len);
+  }
+}
+
+static void _configureTty(int fd) {
+  struct termios tty;
+  if (tcgetattr(fd, &tty) != 0)
+    return;  // a socket or pipe
+
+  cfmakeraw(&tty);
+  cfsetispeed(&tty, B115200);
+  cfsetospeed(&tty, B115200);
+  tty.c_cflag |= CLOCAL | CREAD;
+  tty.c_cflag &= ~(CSTOPB | PARENB);
+  tcsetattr(fd, TCSANOW, &tty);
+}
+
+esp_err_t uart_driver_install_host(uart_port_t uart_num, const char *device, int rx_buffer_size, int queue_size,
+                                   QueueHandle_t *uart_queue) {
+  if (uart_num < 0 || uart_num >= UART_NUM_MAX || _uarts[uart_num] || rx_buffer_size <= UART_FIFO_LEN)
+    return ESP_ERR_INVALID_ARG;
+
+  int fd = open(device, O_RDWR | O_NOCTTY);
+  if (fd < 0)
+    return ESP_FAIL;
+  _configureTty(fd);
+
+  uart_host_t *uart = new uart_host_t();
+  uart->fd = fd;
+  uart->rxBuffer.resize(rx_buffer_size);
+  uart->rxHead = 0;
+  uart->rxCount = 0;
+  uart->bufferFullPosted = false;
+  uart->rxFullThreshold = UART_DEFAULT_RX_FULL_THRESHOLD;
+  uart->patternEnabled = false;
+  uart->patternChr = 0;
+  uart->patternQueueLength = 0;
+  uart->eventQueue = queue_size ? xQueueCreate(queue_size, sizeof(uart_event_t)) : NULL;
+  if (uart_queue)
+    *uart_queue = uart->eventQueue;
+
+  uart->running = true;
+  uart->reader = std::thread(_readerThread, uart);
+  _uarts[uart_num] = uart;
+  return ESP_OK;
+}
+
+esp_err_t uart_driver_delete(uart_port_t uart_num) {
+  uart_host_t *uart = _uart(uart_num);
+  if (!uart)
+    return ESP_ERR_INVALID_STATE;
+
+  _uarts[uart_num] = NULL;
+  uart->running = false;
+  uart->spaceAvailable.notify_all();
+  uart->reader.join();
+  close(uart->fd);
+  if (uart->eventQueue)
+    vQueueDelete(uart->eventQueue);
+  delete uart;
+  return ESP_OK;
+}
+
+int uart_read_bytes(uart_port_t uart_num, void *buf, uint32_t length, TickType_t ticks_to_wait) {
+  uart_host_t *uart = _uart(uart_num);
+  if (!uart)
+    return -1;
+
+  uint8_t *dest = (uint8_t *) buf;
+  uint32_t read = 0;
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds((uint64_t) ticks_to_wait * portTICK_PERIOD_MS);
+
+  std::unique_lock<std::mutex> lock(uart->mutex);
+  while (read < length) {
+    if (!uart->rxCount) {
+      if (ticks_to_wait == portMAX_DELAY)
+        uart->dataAvailable.wait(lock);
+      else if (uart->dataAvailable.wait_until(lock, deadline) == std::cv_status::timeout && !uart->rxCount)
+        break;
+      continue;
+    }
+
+    size_t size = uart->rxBuffer.size();
+    uint32_t chunk = 0;
+    while (read < length && uart->rxCount) {
+      dest[read++] = uart->rxBuffer[uart->rxHead];
+      uart->rxHead = (uart->rxHead + 1) % size;
+      uart->rxCount--;
+      chunk++;
+    }
+
+    // pattern positions move with the read position, positions already read are dropped
+    for (int &pos : uart->patternPositions)
+      pos -= chunk;
+    while (!uart->patternPositions.empty() && uart->patternPositions.front() < 0)
+      uart->patternPositions.pop_front();
+
+    uart->spaceAvailable.notify_all();
+  }
+  return read;
+}
+
+int uart_write_bytes(uart_port_t uart_num, const void *src, size_t size) {
+  uart_host_t *uart = _uart(uart_num);
+  if (!uart)
+    return -1;
+
+  const uint8_t *data = (const uint8_t *) src;
+  size_t written = 0;
+  while (written < size) {
+    ssize_t len = write(uart->fd, data + written, size - written);
+    if (len < 0) {
+      if (errno == EINTR || errno == EAGAIN)
+        continue;
+      return -1;
+    }
+    written += len;
+  }
+  return (int) written;
+}
+
+esp_err_t uart_flush_input(uart_port_t uart_num) {
+  uart_host_t *uart = _uart(uart_num);
+  if (!uart)
+    return ESP_ERR_INVALID_STATE;
+
+  std::lock_guard<std::mutex> lock(uart->mutex);
+  uart->rxHead = 0;
+  uart->rxCount = 0;
+  uart->patternPositions.clear();
+  uart->spaceAvailable.notify_all();
+  return ESP_OK;
+}
+
+esp_err_t uart_get_buffered_data_len(uart_port_t uart_num, size_t *size) {
+  uart_host_t *uart = _uart(uart_num);
+  if (!uart)
+    return ESP_ERR_INVALID_STATE;
+
+  std::lock_guard<std::mutex> lock(uart->mutex);
+  *size = uart->rxCount;
+  return ESP_OK;
+}
+
+esp_err_t uart_enable_pattern_det_baud_intr(uart_port_t uart_num, char pattern_chr, uint8_t chr_num, int chr_tout,
+                                            int post_idle, int pre_idle) {
+  uart_host_t *uart = _uart(uart_num);
+  if (!uart || chr_num != 1)
+    return ESP_ERR_INVALID_ARG;
+
+  std::lock_guard<std::mutex> lock(uart->mutex);
+  uart->patternChr = pattern_chr;
+  uart->patternEnabled = true;
+  return ESP_OK;
+}
+
+esp_err_t uart_disable_pattern_det_intr(uart_port_t uart_num) {
+  uart_host_t *uart = _uart(uart_num);
+  if (!uart)
+    return ESP_ERR_INVALID_STATE;
+
+  std::lock_guard<std::mutex> lock(uart->mutex);
+  uart->patternEnabled = false;
+  return ESP_OK;
+}
+
+esp_err_t uart_pattern_queue_reset(uart_port_t uart_num, int queue_length) {
+  uart_host_t *uart = _uart(uart_num);
+  if (!uart)
+    return ESP_ERR_INVALID_STATE;
+
+  std::lock_guard<std::mutex> lock(uart->mutex);
+  uart->patternQueueLength = queue_length;
+  uart->patternPositions.clear();
+  return ESP_OK;
+}
+
+int uart_pattern_pop_pos(uart_port_t uart_num) {
+  uart_host_t *uart = _uart(uart_num);
+  if (!uart)
+    return -1;
+
+  std::lock_guard<std::mutex> lock(uart->mutex);
+  if (uart->patternPositions.empty())
+    return -1;
+  int pos = uart->patternPositions.front();
+  uart->patternPositions.pop_front();
+  return pos;
+}
+
+int uart_pattern_get_pos(uart_port_t uart_num) {
+  uart_host_t *uart = _uart(uart_num);
+  if (!uart)
+    return -1;
+
+  std::lock_guard<std::mutex> lock(uart->mutex);
+  return uart->patternPositions.empty() ? -1 : uart->patternPositions.front();
+}
+
+esp_err_t uart_set_rx_full_threshold(uart_port_t uart_num, int threshold) {
+  uart_host_t *uart = _uart(uart_num);
+  if (!uart || threshold < 1 || threshold >= UART_FIFO_LEN)
+    return ESP_ERR_INVALID_ARG;
+
+  std::lock_guard<std::mutex> lock(uart->mutex);
+  uart->rxFullThreshold = threshold;
+  return ESP_OK;
+}
+
+esp_err_t uart_set_rx_timeout(uart_port_t uart_num, const uint8_t tout_thresh) {
+  // the reader thread hands over whatever the tty delivers, there is no receive timeout to emulate
+  return _uart(uart_num) ? ESP_OK : ESP_ERR_INVALID_STATE;
+}